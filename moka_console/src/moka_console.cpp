@@ -5,6 +5,7 @@
 #include <boost/program_options.hpp>
 #include <boost/signals2.hpp>
 #include <moka/dataset/datasetdispenser.h>
+#include <moka/dataset/multilabeledgraphdataset.h>
 #include <moka/log.h>
 #include <moka/model/model.h>
 #include <moka/model/modeldispenser.h>
@@ -66,6 +67,7 @@ enum Mode
 Mode mode;
 std::string program_name;
 bool verbose;
+bool binary_output;
 std::string config_filename;
 std::string input_filename;
 std::string output_filename;
@@ -140,6 +142,7 @@ int main(int argc, char *argv[])
  *   - config_filename
  *   - input_filename
  *   - output_filename
+ *   - binary_output
  *
  * If there aren't some required options or if an help message is requested,
  * it is printed out the program usage description and eventualy the error
@@ -153,6 +156,7 @@ bool parseProgramOptions(int argc, char *argv[])
 
   // Default values into optional parametrs
   verbose = false;
+  binary_output = false;
 
   bpo::variables_map opt;
   bpo::options_description opt_desc(
@@ -171,6 +175,9 @@ bool parseProgramOptions(int argc, char *argv[])
         ("output,o",
          bpo::value<std::string>(&output_filename),
          "Output file.")
+        ("binary,b",
+         "Write the preprocessed dataset in the binary format (only for "
+         "the multilabeled graph datasets).")
         ("verbose,v",
          "Log out verbose messages.");
 
@@ -188,6 +195,7 @@ bool parseProgramOptions(int argc, char *argv[])
 
     // Inits some values
     verbose = opt.count("verbose");
+    binary_output = opt.count("binary");
 
   } // try
   catch (std::exception& ex)
@@ -260,7 +268,9 @@ bool loadAndFillParameters()
  * Load a dataset specified in the configuration file and write it on the
  * output file using the Dataset::write method. In the loading procedure the
  * Dataset object will do all the necessary preprocessing on data, thus the
- * method write will write on file the dataset preprocessed.
+ * method write will write on file the dataset preprocessed. If binary_output
+ * is true the dataset is written in the binary format (see the method
+ * MultiLabeledGraphDataset::writeBinary), that can be reloaded much faster.
  */
 int datasetPreprocessingProcedure()
 {
@@ -279,7 +289,9 @@ int datasetPreprocessingProcedure()
     return 1;
   }
 
-  std::fstream ofs(output_filename.c_str(), std::fstream::out);
+  std::fstream ofs(
+      output_filename.c_str(),
+      std::fstream::out | std::fstream::binary);
   int return_value = 0;
 
   try
@@ -302,7 +314,18 @@ int datasetPreprocessingProcedure()
       throw std::runtime_error(
           std::string("fail opening the file ") + output_filename);
 
-    dataset->write(ofs);
+    if (binary_output)
+    {
+      mds::MultiLabeledGraphDataset *graph_dataset =
+          dynamic_cast<mds::MultiLabeledGraphDataset*>(dataset);
+      if (!graph_dataset)
+        throw std::runtime_error(
+            "the binary format is available only for the multilabeled graph "
+            "datasets");
+      graph_dataset->writeBinary(ofs);
+    }
+    else
+      dataset->write(ofs);
 
   } // try
   catch (std::exception& ex)
@@ -0,0 +1,563 @@
+#include "binarygraphfile.h"
+
+#include <cstring>
+#include <map>
+#include <utility>
+#include <moka/exception.h>
+#include <moka/util/math.h>
+
+namespace moka {
+namespace dataset {
+
+namespace mst = ::moka::structure;
+
+namespace {
+
+//! Identifies a label set of a dataset (its id is unique only in its pool)
+typedef std::pair<const mst::LabelSet::Pool*, mst::LabelSet::Uint>
+    LabelSetKey;
+
+//! Rounds up the passed offset to a multiple of 8
+boost::uint64_t align8(boost::uint64_t offset)
+{
+  return (offset + 7) & ~static_cast<boost::uint64_t>(7);
+}
+
+//! Returns the index of the label in the table of the labels (LABEL_OFFSETS
+//! and LABEL_CHARS), adding it in the table if not present
+boost::uint32_t internLabel
+(
+    const std::string& label,
+    std::map<std::string, boost::uint32_t>& labels_index,
+    std::vector<boost::uint64_t>& label_offsets,
+    std::string& label_chars
+)
+{
+  std::map<std::string, boost::uint32_t>::const_iterator it =
+      labels_index.find(label);
+  if (it != labels_index.end())
+    return it->second;
+
+  boost::uint32_t index = label_offsets.size() - 1;
+  labels_index[label] = index;
+  label_chars += label;
+  label_offsets.push_back(label_chars.size());
+  return index;
+} // function internLabel
+
+} // namespace
+
+/**
+ * Struct BinaryGraphFile::Header
+ *
+ * The header of the file: the counts of the dataset objects and the position
+ * (offset from the file start) and size (in bytes) of each block.
+ */
+struct BinaryGraphFile::Header
+{
+  char magic[8];
+  boost::uint32_t version;
+  boost::uint32_t byte_order_mark;
+  Offset n_instances;
+  Offset n_vertices;
+  Offset n_neighbors;
+  Offset elements_size;
+  Offset n_outputs;
+  Offset n_id_chars;
+  Offset n_labels;
+  Offset n_label_chars;
+  Offset n_label_sets;
+  Offset n_label_set_labels;
+  Offset n_label_names;
+  Offset blocks[n_blocks][2];
+};
+
+const char BinaryGraphFile::m_magic[8] =
+    {'M', 'O', 'K', 'A', 'M', 'L', 'G', 'D'};
+const boost::uint32_t BinaryGraphFile::m_version = 1;
+const boost::uint32_t BinaryGraphFile::m_byte_order_mark = 0x01020304;
+
+// ==============
+// PUBLIC METHODS
+// ==============
+
+/**
+ * Constructor
+ *
+ * Builds the object on the buffer DATA of SIZE bytes holding a whole file,
+ * interning its label sets in LABEL_POOL (a new pool if null).
+ * Throws an exception of type moka::GenericException if the buffer doesn't
+ * hold a valid file (of the current version, written by a machine with the
+ * same byte order).
+ */
+BinaryGraphFile::BinaryGraphFile
+(
+    const char *data,
+    size_t size,
+    const boost::shared_ptr<mst::LabelSet::Pool>& label_pool
+) :
+  m_data(data),
+  m_size(size)
+{
+  Header header;
+  if (m_size < sizeof(Header))
+    throw moka::GenericException(
+        "BinaryGraphFile: the file is too short to be a binary dataset file");
+  std::memcpy(&header, m_data, sizeof(Header));
+
+  if (std::memcmp(header.magic, m_magic, sizeof(m_magic)) != 0)
+    throw moka::GenericException(
+        "BinaryGraphFile: the file is not a binary dataset file");
+  if (header.version != m_version)
+    throw moka::GenericException(
+        "BinaryGraphFile: unsupported file version " +
+        Global::toString(header.version));
+  if (header.byte_order_mark != m_byte_order_mark)
+    throw moka::GenericException(
+        "BinaryGraphFile: the file was written with a different byte order");
+
+  m_n_instances = header.n_instances;
+  m_elements_size = header.elements_size;
+  Offset n = header.n_instances;
+  Offset n_vertices = header.n_vertices;
+
+  m_instance_vertices = block<Offset>(header, instance_vertices_block, n + 1);
+  m_instance_outputs = block<Offset>(header, instance_outputs_block, n + 1);
+  m_instance_ids = block<Offset>(header, instance_ids_block, n + 1);
+  m_instance_label_names =
+      block<Offset>(header, instance_label_names_block, n + 1);
+  m_id_chars = block<char>(header, id_chars_block, header.n_id_chars);
+  m_outputs = block<Real>(header, outputs_block, header.n_outputs);
+  m_neighbors_offsets =
+      block<Offset>(header, neighbors_offsets_block, n_vertices + 1);
+  m_neighbors = block<Index>(header, neighbors_block, header.n_neighbors);
+  m_elements =
+      block<Real>(header, elements_block, n_vertices * m_elements_size);
+  m_vertex_label_sets =
+      block<Index>(header, vertex_label_sets_block, n_vertices);
+  const Offset *label_set_offsets = block<Offset>(
+      header, label_set_offsets_block, header.n_label_sets + 1);
+  const Index *label_set_labels = block<Index>(
+      header, label_set_labels_block, header.n_label_set_labels);
+  const Offset *label_offsets =
+      block<Offset>(header, label_offsets_block, header.n_labels + 1);
+  const char *label_chars =
+      block<char>(header, label_chars_block, header.n_label_chars);
+  m_label_names =
+      block<Index>(header, label_names_block, header.n_label_names);
+
+  // Check the offsets tables: each one must be non-decreasing, starting from
+  // 0 and ending with the size of the array it refers to
+  if (!checkOffsets(m_instance_vertices, n, n_vertices) ||
+      !checkOffsets(m_instance_outputs, n, header.n_outputs) ||
+      !checkOffsets(m_instance_ids, n, header.n_id_chars) ||
+      !checkOffsets(m_instance_label_names, n, header.n_label_names) ||
+      !checkOffsets(m_neighbors_offsets, n_vertices, header.n_neighbors) ||
+      !checkOffsets(
+          label_set_offsets, header.n_label_sets, header.n_label_set_labels) ||
+      !checkOffsets(label_offsets, header.n_labels, header.n_label_chars))
+    throw moka::GenericException(
+        "BinaryGraphFile: inconsistent offsets in the file");
+
+  // Labels table: each label set is interned only once
+  m_labels.reserve(header.n_labels);
+  for (Offset l = 0; l < header.n_labels; ++l)
+    m_labels.push_back(std::string(
+        label_chars + label_offsets[l],
+        label_chars + label_offsets[l + 1]));
+
+  const boost::shared_ptr<mst::LabelSet::Pool> pool =
+      label_pool ? label_pool
+                 : boost::shared_ptr<mst::LabelSet::Pool>(
+                       new mst::LabelSet::Pool());
+  m_label_sets.reserve(header.n_label_sets);
+  std::vector<std::string> labels;
+  for (Offset s = 0; s < header.n_label_sets; ++s)
+  {
+    labels.clear();
+    for (Offset j = label_set_offsets[s]; j < label_set_offsets[s + 1]; ++j)
+      labels.push_back(m_labels.at(label_set_labels[j]));
+    m_label_sets.push_back(mst::LabelSet(labels, pool));
+  } // for s
+}
+
+/**
+ * Destructor
+ */
+BinaryGraphFile::~BinaryGraphFile()
+{ }
+
+/**
+ * Method getElementsSize
+ *
+ * Returns the size of the elements of the verteces.
+ */
+BinaryGraphFile::Uint BinaryGraphFile::getElementsSize() const
+{
+  return m_elements_size;
+} // method getElementsSize
+
+/**
+ * Method getId
+ *
+ * Returns the id of the i-th instance (not checked).
+ */
+std::string BinaryGraphFile::getId(Uint i) const
+{
+  return std::string(
+      m_id_chars + m_instance_ids[i],
+      m_id_chars + m_instance_ids[i + 1]);
+} // method getId
+
+/**
+ * Method getInput
+ *
+ * Builds in G the graph of the i-th instance (i not checked). Throws an
+ * exception of type moka::GenericException if the graph in the file is not
+ * consistent.
+ */
+void BinaryGraphFile::getInput(Uint i, mst::MultiLabeledGraph& g) const
+{
+  mst::MultiLabeledGraph empty_graph;
+  g.swap(empty_graph);
+
+  Offset first = m_instance_vertices[i];
+  Offset last = m_instance_vertices[i + 1];
+
+  util::Math::Vector *element = NULL;
+  std::vector<Uint> *neighs = NULL;
+  try
+  {
+    for (Offset v = first; v < last; ++v)
+    {
+      if (m_vertex_label_sets[v] >= m_label_sets.size())
+        throw moka::GenericException(
+            "BinaryGraphFile::getInput: inconsistent graph in the file");
+
+      element = new util::Math::Vector(m_elements_size);
+      std::copy(
+          m_elements + v * m_elements_size,
+          m_elements + (v + 1) * m_elements_size,
+          element->memptr());
+
+      neighs = new std::vector<Uint>(
+          m_neighbors + m_neighbors_offsets[v],
+          m_neighbors + m_neighbors_offsets[v + 1]);
+      for (size_t j = 0; j < neighs->size(); ++j)
+        if ((*neighs)[j] >= last - first)
+          throw moka::GenericException(
+              "BinaryGraphFile::getInput: inconsistent graph in the file");
+
+      g.pushBack(m_label_sets[m_vertex_label_sets[v]], element, neighs);
+      element = NULL;
+      neighs = NULL;
+    } // for v
+  } // try
+  catch (...)
+  {
+    delete element;
+    delete neighs;
+    g.clear();
+    throw;
+  } // try-catch
+
+  for (Offset l = m_instance_label_names[i];
+       l < m_instance_label_names[i + 1];
+       ++l)
+    g.addLabelName(m_labels.at(m_label_names[l]));
+
+  return;
+} // method getInput
+
+/**
+ * Method getOutput
+ *
+ * Copies in OUTPUT the outputs of the i-th instance (i not checked).
+ */
+void BinaryGraphFile::getOutput(Uint i, std::vector<Real>& output) const
+{
+  output.assign(
+      m_outputs + m_instance_outputs[i],
+      m_outputs + m_instance_outputs[i + 1]);
+  return;
+} // method getOutput
+
+/**
+ * Method getSize
+ *
+ * Returns the number of instances in the file.
+ */
+BinaryGraphFile::Uint BinaryGraphFile::getSize() const
+{
+  return m_n_instances;
+} // method getSize
+
+/**
+ * Method isBinaryGraphFile
+ *
+ * Returns true if the stream IS starts (from its current position) with the
+ * magic string of the binary dataset files. The position of the stream is
+ * left unchanged.
+ */
+bool BinaryGraphFile::isBinaryGraphFile(std::istream& is)
+{
+  std::istream::pos_type pos = is.tellg();
+
+  char magic[sizeof(m_magic)];
+  is.read(magic, sizeof(magic));
+  bool binary = is.gcount() == static_cast<std::streamsize>(sizeof(magic)) &&
+                std::memcmp(magic, m_magic, sizeof(m_magic)) == 0;
+
+  is.clear();
+  is.seekg(pos);
+  return binary;
+} // method isBinaryGraphFile
+
+/**
+ * Method write
+ *
+ * Writes the instances of DATASET (in the order given by DatasetType::at) on
+ * the stream OS in the binary format. All the verteces elements in the
+ * dataset must have the same size, otherwise an exception of type
+ * moka::GenericException is thrown.
+ */
+void BinaryGraphFile::write(std::ostream& os, const DatasetType& dataset)
+{
+  std::vector<Offset> instance_vertices(1, 0);
+  std::vector<Offset> instance_outputs(1, 0);
+  std::vector<Offset> instance_ids(1, 0);
+  std::vector<Offset> instance_label_names(1, 0);
+  std::string id_chars;
+  std::vector<Real> outputs;
+  std::vector<Offset> neighbors_offsets(1, 0);
+  std::vector<Index> neighbors;
+  std::vector<Real> elements;
+  std::vector<Index> vertex_label_sets;
+  std::vector<Offset> label_set_offsets(1, 0);
+  std::vector<Index> label_set_labels;
+  std::vector<Offset> label_offsets(1, 0);
+  std::string label_chars;
+  std::vector<Index> label_names;
+
+  std::map<std::string, Index> labels_index;
+  // (LabelSet::getPool, LabelSet::getId) -> label set
+  std::map<LabelSetKey, Index> label_sets_index;
+  Offset elements_size = 0;
+  bool elements_size_set = false;
+
+  for (Uint i = 0; i < dataset.getSize(); ++i)
+  {
+    const DatasetType::Instance& instance = dataset.at(i);
+    const mst::MultiLabeledGraph& g = instance.getInput();
+    const mst::MultiLabeledGraph::View view(g);
+
+    for (Uint v = 0; v < view.getSize(); ++v)
+    {
+      // Element
+      const util::Math::Vector& element = view.getVertexElement(v);
+      if (!elements_size_set)
+      {
+        elements_size = element.n_elem;
+        elements_size_set = true;
+      }
+      if (element.n_elem != elements_size)
+        throw moka::GenericException(
+            "BinaryGraphFile::write: the verteces elements have different "
+            "sizes");
+      elements.insert(elements.end(), element.begin(), element.end());
+
+      // Neighbors
+      neighbors.insert(
+          neighbors.end(),
+          view.getNeighborsBegin(v),
+          view.getNeighborsEnd(v));
+      neighbors_offsets.push_back(neighbors.size());
+
+      // Label set
+      const mst::LabelSet& item = view.getVertexItem(v);
+      const LabelSetKey key(item.getPool(), item.getId());
+      std::map<LabelSetKey, Index>::const_iterator it =
+          label_sets_index.find(key);
+      if (it == label_sets_index.end())
+      {
+        Index index = label_set_offsets.size() - 1;
+        it = label_sets_index.insert(std::make_pair(key, index)).first;
+        for (size_t l = 0; l < item.size(); ++l)
+          label_set_labels.push_back(internLabel(
+              item[l], labels_index, label_offsets, label_chars));
+        label_set_offsets.push_back(label_set_labels.size());
+      }
+      vertex_label_sets.push_back(it->second);
+    } // for v
+    instance_vertices.push_back(vertex_label_sets.size());
+
+    for (Uint l = 0; l < g.getLabelNameSize(); ++l)
+      label_names.push_back(internLabel(
+          g.getLabelName(l), labels_index, label_offsets, label_chars));
+    instance_label_names.push_back(label_names.size());
+
+    id_chars += instance.getId();
+    instance_ids.push_back(id_chars.size());
+
+    outputs.insert(
+        outputs.end(),
+        instance.getOutput().begin(),
+        instance.getOutput().end());
+    instance_outputs.push_back(outputs.size());
+  } // for i
+
+  // Header
+  Header header;
+  std::memset(&header, 0, sizeof(Header));
+  std::memcpy(header.magic, m_magic, sizeof(m_magic));
+  header.version = m_version;
+  header.byte_order_mark = m_byte_order_mark;
+  header.n_instances = dataset.getSize();
+  header.n_vertices = vertex_label_sets.size();
+  header.n_neighbors = neighbors.size();
+  header.elements_size = elements_size;
+  header.n_outputs = outputs.size();
+  header.n_id_chars = id_chars.size();
+  header.n_labels = label_offsets.size() - 1;
+  header.n_label_chars = label_chars.size();
+  header.n_label_sets = label_set_offsets.size() - 1;
+  header.n_label_set_labels = label_set_labels.size();
+  header.n_label_names = label_names.size();
+
+  // Blocks data and sizes
+  const char *blocks[n_blocks];
+  blocks[instance_vertices_block] =
+      reinterpret_cast<const char*>(&instance_vertices[0]);
+  blocks[instance_outputs_block] =
+      reinterpret_cast<const char*>(&instance_outputs[0]);
+  blocks[instance_ids_block] =
+      reinterpret_cast<const char*>(&instance_ids[0]);
+  blocks[instance_label_names_block] =
+      reinterpret_cast<const char*>(&instance_label_names[0]);
+  blocks[id_chars_block] = id_chars.data();
+  blocks[outputs_block] = reinterpret_cast<const char*>(
+      outputs.empty() ? NULL : &outputs[0]);
+  blocks[neighbors_offsets_block] =
+      reinterpret_cast<const char*>(&neighbors_offsets[0]);
+  blocks[neighbors_block] = reinterpret_cast<const char*>(
+      neighbors.empty() ? NULL : &neighbors[0]);
+  blocks[elements_block] = reinterpret_cast<const char*>(
+      elements.empty() ? NULL : &elements[0]);
+  blocks[vertex_label_sets_block] = reinterpret_cast<const char*>(
+      vertex_label_sets.empty() ? NULL : &vertex_label_sets[0]);
+  blocks[label_set_offsets_block] =
+      reinterpret_cast<const char*>(&label_set_offsets[0]);
+  blocks[label_set_labels_block] = reinterpret_cast<const char*>(
+      label_set_labels.empty() ? NULL : &label_set_labels[0]);
+  blocks[label_offsets_block] =
+      reinterpret_cast<const char*>(&label_offsets[0]);
+  blocks[label_chars_block] = label_chars.data();
+  blocks[label_names_block] = reinterpret_cast<const char*>(
+      label_names.empty() ? NULL : &label_names[0]);
+
+  header.blocks[instance_vertices_block][1] =
+      instance_vertices.size() * sizeof(Offset);
+  header.blocks[instance_outputs_block][1] =
+      instance_outputs.size() * sizeof(Offset);
+  header.blocks[instance_ids_block][1] = instance_ids.size() * sizeof(Offset);
+  header.blocks[instance_label_names_block][1] =
+      instance_label_names.size() * sizeof(Offset);
+  header.blocks[id_chars_block][1] = id_chars.size();
+  header.blocks[outputs_block][1] = outputs.size() * sizeof(Real);
+  header.blocks[neighbors_offsets_block][1] =
+      neighbors_offsets.size() * sizeof(Offset);
+  header.blocks[neighbors_block][1] = neighbors.size() * sizeof(Index);
+  header.blocks[elements_block][1] = elements.size() * sizeof(Real);
+  header.blocks[vertex_label_sets_block][1] =
+      vertex_label_sets.size() * sizeof(Index);
+  header.blocks[label_set_offsets_block][1] =
+      label_set_offsets.size() * sizeof(Offset);
+  header.blocks[label_set_labels_block][1] =
+      label_set_labels.size() * sizeof(Index);
+  header.blocks[label_offsets_block][1] =
+      label_offsets.size() * sizeof(Offset);
+  header.blocks[label_chars_block][1] = label_chars.size();
+  header.blocks[label_names_block][1] = label_names.size() * sizeof(Index);
+
+  // Blocks positions: each one aligned at 8 bytes
+  Offset position = align8(sizeof(Header));
+  for (int b = 0; b < n_blocks; ++b)
+  {
+    header.blocks[b][0] = position;
+    position = align8(position + header.blocks[b][1]);
+  }
+
+  // Write header and blocks
+  const char padding[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  os.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+  position = sizeof(Header);
+  for (int b = 0; b < n_blocks; ++b)
+  {
+    os.write(padding, header.blocks[b][0] - position);
+    os.write(blocks[b], header.blocks[b][1]);
+    position = header.blocks[b][0] + header.blocks[b][1];
+  }
+  os.write(padding, align8(position) - position);
+
+  if (!os.good())
+    throw moka::GenericException(
+        "BinaryGraphFile::write: error writing on the stream");
+
+  return;
+} // method write
+
+// ===============
+// PRIVATE METHODS
+// ===============
+
+/**
+ * Method block
+ *
+ * Returns the pointer to the array of the block B (of N_ELEMENTS elements of
+ * type Type), checking that the block is within the file, that its size is
+ * the one expected and that its position is suitably aligned.
+ */
+template <typename Type>
+const Type* BinaryGraphFile::block
+(
+    const Header& header,
+    Block b,
+    Offset n_elements
+) const
+{
+  Offset offset = header.blocks[b][0];
+  Offset size = header.blocks[b][1];
+
+  if (n_elements > m_size || size != n_elements * sizeof(Type) ||
+      offset > m_size || size > m_size - offset ||
+      reinterpret_cast<size_t>(m_data + offset) % sizeof(Type) != 0)
+    throw moka::GenericException(
+        "BinaryGraphFile: invalid block " + Global::toString(b) +
+        " in the file");
+
+  return reinterpret_cast<const Type*>(m_data + offset);
+} // method block
+
+/**
+ * Method checkOffsets
+ *
+ * Returns true if the N + 1 OFFSETS are non-decreasing, starting from 0 and
+ * ending with SIZE.
+ */
+bool BinaryGraphFile::checkOffsets
+(
+    const Offset *offsets,
+    Offset n,
+    Offset size
+)
+{
+  if (offsets[0] != 0 || offsets[n] != size)
+    return false;
+  for (Offset i = 0; i < n; ++i)
+    if (offsets[i] > offsets[i + 1])
+      return false;
+  return true;
+} // method checkOffsets
+
+} // namespace dataset
+} // namespace moka
@@ -0,0 +1,137 @@
+#ifndef MOKA_DATASET_BINARYGRAPHFILE_H
+#define MOKA_DATASET_BINARYGRAPHFILE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <moka/global.h>
+#include <moka/dataset/genericdataset.h>
+#include <moka/structure/labelset.h>
+#include <moka/structure/multilabeledgraph.h>
+
+namespace moka {
+namespace dataset {
+
+/**
+ * Class BinaryGraphFile
+ *
+ * Binary (versioned) file format of a dataset of multilabeled graphs, an
+ * alternative to the text format of MultiLabeledGraphDataset::write which
+ * can be loaded without parsing: the file is a fixed size header followed by
+ * blocks of plain arrays (integers and reals in the byte order of the machine
+ * that wrote the file), namely:
+ *   - for each instance the offsets of its verteces, of its outputs, of its id
+ *     and of its label names in the following blocks;
+ *   - the ids (chars) and the outputs (reals) of all the instances;
+ *   - the adjacency of all the graphs as a CSR matrix (neighbors offsets of
+ *     each vertex and neighbors indexes, local to the graph of the vertex);
+ *   - the elements of all the verteces, as an elements_size x V matrix
+ *     (column major);
+ *   - the interned label table: the distinct labels (chars and offsets), the
+ *     distinct label sets (as labels indexes) and for each vertex the index
+ *     of its label set;
+ *   - the label names of the graphs (as labels indexes).
+ * The header contains the magic string, the version, a byte order mark and
+ * the position and size of each block. Each block starts at an offset
+ * multiple of 8, so a BinaryGraphFile can read the arrays in place on a
+ * buffer holding the whole file (e.g. loaded with a single read, or mapped
+ * in memory), without copying them.
+ *
+ * A BinaryGraphFile object is built on such buffer (that must remain valid
+ * for the lifetime of the object, and is not owned by it): the constructor
+ * checks the header and the blocks sizes and interns the label sets of the
+ * file in the passed pool, then each instance can be read
+ * through the methods getId, getOutput and getInput. The method write writes
+ * a whole dataset in this format.
+ */
+class BinaryGraphFile
+{
+  public:
+    typedef Global::Uint Uint;
+    typedef Global::Real Real;
+    typedef GenericDataset<structure::MultiLabeledGraph> DatasetType;
+
+    BinaryGraphFile(
+        const char *data,
+        size_t size,
+        const boost::shared_ptr<structure::LabelSet::Pool>& label_pool);
+    ~BinaryGraphFile();
+
+    Uint getElementsSize() const;
+    std::string getId(Uint i) const;
+    void getInput(Uint i, structure::MultiLabeledGraph& g) const;
+    void getOutput(Uint i, std::vector<Real>& output) const;
+    Uint getSize() const;
+
+    static bool isBinaryGraphFile(std::istream& is);
+    static void write(std::ostream& os, const DatasetType& dataset);
+
+  private:
+    typedef boost::uint32_t Index;
+    typedef boost::uint64_t Offset;
+
+    // Blocks of the file (in the order they are written)
+    enum Block
+    {
+      instance_vertices_block,
+      instance_outputs_block,
+      instance_ids_block,
+      instance_label_names_block,
+      id_chars_block,
+      outputs_block,
+      neighbors_offsets_block,
+      neighbors_block,
+      elements_block,
+      vertex_label_sets_block,
+      label_set_offsets_block,
+      label_set_labels_block,
+      label_offsets_block,
+      label_chars_block,
+      label_names_block,
+      n_blocks
+    };
+
+    struct Header;
+
+    static const char m_magic[8];
+    static const boost::uint32_t m_version;
+    static const boost::uint32_t m_byte_order_mark;
+
+    const char *m_data;
+    Offset m_size;
+    Offset m_n_instances;
+    Offset m_elements_size;
+    const Offset *m_instance_vertices;
+    const Offset *m_instance_outputs;
+    const Offset *m_instance_ids;
+    const Offset *m_instance_label_names;
+    const char *m_id_chars;
+    const Real *m_outputs;
+    const Offset *m_neighbors_offsets;
+    const Index *m_neighbors;
+    const Real *m_elements;
+    const Index *m_vertex_label_sets;
+    const Index *m_label_names;
+    std::vector<std::string> m_labels;
+    std::vector<structure::LabelSet> m_label_sets;
+
+    template <typename Type>
+    const Type* block(
+        const Header& header,
+        Block b,
+        Offset n_elements) const;
+
+    static bool checkOffsets(const Offset *offsets, Offset n, Offset size);
+
+    // Copy constructor and the assignment operator are turned off.
+    BinaryGraphFile(const BinaryGraphFile&);
+    BinaryGraphFile& operator=(const BinaryGraphFile&);
+
+}; // class BinaryGraphFile
+
+} // namespace dataset
+} // namespace moka
+
+#endif // MOKA_DATASET_BINARYGRAPHFILE_H
@@ -1 +1,45 @@
 #include "dataset.h"
+
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace moka {
+namespace dataset {
+
+typedef Dataset::Uint Uint;
+
+namespace {
+
+// Last generation given to a dataset (see Dataset::getGeneration)
+Uint last_generation = 0;
+boost::mutex last_generation_mutex;
+
+} // namespace
+
+/**
+ * Constructor
+ */
+Dataset::Dataset()
+{
+  newGeneration();
+}
+
+// =================
+// PROTECTED METHODS
+// =================
+
+/**
+ * Method newGeneration
+ *
+ * Gives a new generation to the dataset (see getGeneration). Must be called
+ * by the derived classes each time the dataset is emptied.
+ */
+void Dataset::newGeneration()
+{
+  boost::lock_guard<boost::mutex> lock(last_generation_mutex);
+  m_generation = ++last_generation;
+  return;
+} // method newGeneration
+
+} // namespace dataset
+} // namespace moka
@@ -20,7 +20,7 @@ class Dataset
   public:
     typedef Global::Uint Uint;
 
-    Dataset() { }
+    Dataset();
     virtual ~Dataset() { }
 
     /**
@@ -50,6 +50,20 @@ class Dataset
      */
     virtual Dataset* cloneTrSet() = 0;
 
+    /**
+     * Method getGeneration
+     *
+     * Returns an id of the current content of the dataset, unique among all
+     * the datasets of the process: a new id is taken each time the dataset is
+     * emptied (e.g. when it is cleared or loaded). Unlike the address of the
+     * dataset, that can be reused by another dataset, it can be used to tag
+     * data computed from the instances (e.g. a cache of results).
+     */
+    Uint getGeneration() const
+    {
+      return m_generation;
+    }
+
     /**
      * Method getNumberOfFolds
      *
@@ -280,6 +294,12 @@ class Dataset
 
 #endif // MOKA_TMP_CODE
 
+  protected:
+    void newGeneration();
+
+  private:
+    Uint m_generation;
+
 }; // class Dataset
 
 } // namespace dataset
@@ -97,9 +97,10 @@ class GenericDataset : public Dataset
 #endif // MOKA_TMP_CODE
 
   protected:
-    void clearDataset();
+    virtual void clearDataset();
     void endLoadInstances(bool sortbyid = false);
     void fillWithTrInstances(GenericDataset& ds);
+    virtual const Instance& instanceAt(Uint k) const;
     void pushBackInstance(Instance* inst);
 
   private:
@@ -58,7 +58,7 @@ const typename GenericDataset<T>::Instance& GenericDataset<T>::at(Uint i) const
 {
   if (i >= m_av.size())
     throw std::out_of_range("GenericDataset::at: argument is out of range");
-  return *(m_instcontainer[m_av[i]]);
+  return instanceAt(m_av[i]);
 } // method at
 
 /**
@@ -464,7 +464,8 @@ const typename GenericDataset<T>::Instance& GenericDataset<T>::tsAt(
 /**
  * Method clearDataset
  *
- * The dataset is restored to its initial state (no elements, no splitting).
+ * The dataset is restored to its initial state (no elements, no splitting),
+ * with a new generation (see Dataset::getGeneration).
  */
 template <typename T>
 void GenericDataset<T>::clearDataset()
@@ -475,6 +476,7 @@ void GenericDataset<T>::clearDataset()
   m_trav.clear();
   m_tsav.clear();
   initMembers();
+  newGeneration();
   return;
 } // method clearDataset
 
@@ -519,6 +521,22 @@ void GenericDataset<T>::fillWithTrInstances(GenericDataset& ds)
   return;
 } // method fillWithTrInstances
 
+/**
+ * Method instanceAt
+ *
+ * Returns the k-th instance in the order in which the instances have been
+ * pushed back (k not checked). All the accesses to the instances pass
+ * through this method, so a derived class can override it in order to
+ * complete its instances lazily, at their first access (see
+ * MultiLabeledGraphDataset).
+ */
+template <typename T>
+const typename GenericDataset<T>::Instance& GenericDataset<T>::instanceAt(
+    Uint k) const
+{
+  return *(m_instcontainer[k]);
+} // method instanceAt
+
 /**
  * Method pushBackInstance
  *
@@ -11,13 +11,16 @@
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/lambda/bind.hpp>
 #include <boost/lambda/lambda.hpp>
 #include <boost/lambda/construct.hpp>
+#include <boost/thread/locks.hpp>
 #include <boost/tokenizer.hpp>
 #include <moka/exception.h>
 #include <moka/global.h>
 #include <moka/log.h>
+#include <moka/dataset/binarygraphfile.h>
 #include <moka/util/math.h>
 
 namespace moka {
@@ -34,6 +37,15 @@ using namespace ::moka::structure;
 
 typedef MultiLabeledGraphDataset::Uint Uint;
 
+namespace {
+
+// States of the graphs of a mapped dataset (see instanceAt)
+const char input_not_loaded = 0;
+const char input_loading = 1;
+const char input_loaded = 2;
+
+} // namespace
+
 /**
  * Default constructor
  *
@@ -41,7 +53,8 @@ typedef MultiLabeledGraphDataset::Uint Uint;
  */
 MultiLabeledGraphDataset::MultiLabeledGraphDataset() :
   BaseClass(),
-  m_skipped_instances(0)
+  m_skipped_instances(0),
+  m_label_pool(new LabelSet::Pool())
 { }
 
 /**
@@ -64,6 +77,7 @@ Dataset* MultiLabeledGraphDataset::cloneTrSet()
 {
   MultiLabeledGraphDataset *lblg_ds = new MultiLabeledGraphDataset();
   fillWithTrInstances(*lblg_ds);
+  lblg_ds->m_label_pool = m_label_pool; // shared with the copied graphs
   return lblg_ds;
 } // method cloneTrSet
 
@@ -90,6 +104,10 @@ util::Info<std::string> MultiLabeledGraphDataset::info() const
       "skipped_instances",
       "Skipped instances",
       Global::toString(getSkippedInstances()));
+  inf.pushBack(
+      "label_sets",
+      "Distinct label sets",
+      Global::toString(m_label_pool->getSize()));
   return inf;
 } // method info
 
@@ -101,7 +119,10 @@ util::Info<std::string> MultiLabeledGraphDataset::info() const
  * Depending on the parameter <load-from> you can load the dataset from
  * different sources:
  *   "sdf-file": loads the dataset from a standard SDF (see loadFromSdf).
- *   "dataset-file": loads the dataset previous saved using the method write.
+ *   "dataset-file": loads the dataset previous saved using the method write
+ *     or the method writeBinary.
+ *   "mapped-dataset-file": maps in memory a dataset previous saved using the
+ *     method writeBinary (see loadFromMappedDatasetFile).
  */
 void MultiLabeledGraphDataset::load(const util::Parameters& params)
 {
@@ -110,6 +131,8 @@ void MultiLabeledGraphDataset::load(const util::Parameters& params)
     loadFromSdf(params);
   else if (load_from == "dataset-file")
     loadFromDatasetFile(params);
+  else if (load_from == "mapped-dataset-file")
+    loadFromMappedDatasetFile(params);
   else
     throw moka::GenericException(
         "MultiLabeledGraphDataset::load: invalid source (within parameter "
@@ -212,7 +235,7 @@ void MultiLabeledGraphDataset::read(std::istream& is)
       output = new std::vector<Real>();
 
       Global::readLine(is, *id);
-      input->read(is);
+      input->read(is, m_label_pool);
       Global::readLines(is, *output);
 
       // adds the new instance in the dataset
@@ -241,6 +264,66 @@ void MultiLabeledGraphDataset::read(std::istream& is)
   return;
 } // method read
 
+/**
+ * Method readBinary
+ *
+ * Read from the input stream a dataset previously written using the method
+ * writeBinary (see BinaryGraphFile). The whole stream, from its current
+ * position, is loaded in memory with a single read and the instances are
+ * built from it.
+ */
+void MultiLabeledGraphDataset::readBinary(std::istream& is)
+{
+  // Clears the dataset and loads the entries.
+  this->clearDataset();
+
+  Instance *instance = NULL;
+
+  try
+  {
+    // Read the whole stream
+    std::istream::pos_type begin = is.tellg();
+    is.seekg(0, std::istream::end);
+    std::istream::pos_type end = is.tellg();
+    is.seekg(begin);
+
+    std::vector<char> data(static_cast<size_t>(end - begin));
+    if (!data.empty())
+      is.read(&data[0], data.size());
+    if (!is.good() || is.gcount() != static_cast<std::streamsize>(data.size()))
+      throw moka::GenericException("fail reading the stream");
+
+    BinaryGraphFile file(
+        data.empty() ? NULL : &data[0], data.size(), m_label_pool);
+
+    for (Uint i = 0; i < file.getSize(); ++i)
+    {
+      instance = new Instance();
+      instance->getId() = file.getId(i);
+      file.getInput(i, instance->getInput());
+      file.getOutput(i, instance->getOutput());
+
+      // adds the new instance in the dataset
+      this->pushBackInstance(instance);
+      instance = NULL;
+    } // for i
+
+  } // try
+  catch (std::exception& ex)
+  {
+    Log::err << "MultiLabeledGraphDataset::readBinary: error: "
+        << "dataset is left empty (" << ex.what() << ")" << Log::endl;
+    delete instance;
+    this->clear();
+    return;
+  } // try-catch
+
+  // The dataset is successfully loaded.
+  this->endLoadInstances();
+
+  return;
+} // method readBinary
+
 #ifndef MOKA_TMP_CODE
 
 /**
@@ -270,6 +353,20 @@ void MultiLabeledGraphDataset::write(std::ostream& os) const
 
 #endif // MOKA_TMP_CODE
 
+/**
+ * Method writeBinary
+ *
+ * Writes dataset entries on the output stream (that should be opened in
+ * binary mode) in the binary format described in the class BinaryGraphFile.
+ * You can reload the dataset through the method load and the parameter from
+ * "dataset-file", as the ones written by the method write, but much faster.
+ */
+void MultiLabeledGraphDataset::writeBinary(std::ostream& os) const
+{
+  BinaryGraphFile::write(os, *this);
+  return;
+} // method writeBinary
+
 // =================
 // PROTECTED METHODS
 // =================
@@ -283,9 +380,62 @@ void MultiLabeledGraphDataset::clearDataset()
 {
   BaseClass::clearDataset();
   m_skipped_instances = 0;
+  m_binary_file.reset();
+  m_mapped_file.reset();
+  m_loaded_inputs.clear();
+  m_label_pool.reset(new LabelSet::Pool());
   return;
 } // method clearDataset
 
+/**
+ * Method instanceAt
+ *
+ * See GenericDataset::instanceAt.
+ *
+ * If the dataset is mapped from a binary file (see loadFromMappedDatasetFile)
+ * the graph of the instance is built the first time the instance is accessed.
+ * The lock is held only to claim the graph, so different graphs can be built
+ * by different threads at the same time, while a thread accessing a graph
+ * being built by another thread waits for it.
+ */
+const MultiLabeledGraphDataset::Instance& MultiLabeledGraphDataset::instanceAt
+(
+    Uint k
+) const
+{
+  const Instance& instance = BaseClass::instanceAt(k);
+
+  if (!m_binary_file)
+    return instance;
+
+  {
+    boost::unique_lock<boost::mutex> lock(m_loaded_inputs_mutex);
+    while (m_loaded_inputs[k] == input_loading)
+      m_loaded_inputs_cond.wait(lock);
+    if (m_loaded_inputs[k] == input_loaded)
+      return instance;
+    m_loaded_inputs[k] = input_loading;
+  }
+
+  try
+  {
+    m_binary_file->getInput(k, const_cast<Instance&>(instance).getInput());
+  }
+  catch (...)
+  {
+    boost::lock_guard<boost::mutex> lock(m_loaded_inputs_mutex);
+    m_loaded_inputs[k] = input_not_loaded;
+    m_loaded_inputs_cond.notify_all();
+    throw;
+  } // try-catch
+
+  boost::lock_guard<boost::mutex> lock(m_loaded_inputs_mutex);
+  m_loaded_inputs[k] = input_loaded;
+  m_loaded_inputs_cond.notify_all();
+
+  return instance;
+} // method instanceAt
+
 // ===============
 // PRIVATE METHODS
 // ===============
@@ -717,7 +867,8 @@ void MultiLabeledGraphDataset::fillDataset
           );
 
       // Adds the vertex to the last dataset instance
-      newinstance->getInput().pushBack(multilabel, vertex, neighbors);
+      newinstance->getInput().pushBack(
+          LabelSet(multilabel, m_label_pool), vertex, neighbors);
 
     } // for atom_it
 
@@ -896,8 +1047,8 @@ void MultiLabeledGraphDataset::fillMultilabel
 /**
  * Method loadFromDatasetFile
  *
- * Loads the dataset entries from a file written using the method write (see
- * also the method read).
+ * Loads the dataset entries from a file written using the method write or the
+ * method writeBinary (see also the methods read and readBinary).
  *
  * The method takes the following parameters:
  *   - <file-path>: path of the file containing dataset entries.
@@ -909,7 +1060,9 @@ void MultiLabeledGraphDataset::loadFromDatasetFile
 {
   std::string filename = params.get("file-path");
 
-  std::ifstream ifs(filename.c_str(), std::ifstream::in);
+  std::ifstream ifs(
+      filename.c_str(),
+      std::ifstream::in | std::ifstream::binary);
   if (ifs.fail())
     throw moka::GenericException(
         "MultiLabeledGraphDataset::loadFromDatasetFile: fail opening the "
@@ -920,13 +1073,74 @@ void MultiLabeledGraphDataset::loadFromDatasetFile
         "MultiLabeledGraphDataset::loadFromDatasetFile: error reading file " +
         filename);
 
-  read(ifs);
+  // The format of the file (text or binary) is detected from its beginning
+  if (BinaryGraphFile::isBinaryGraphFile(ifs))
+    readBinary(ifs);
+  else
+    read(ifs);
 
   ifs.close();
 
   return;
 } // method loadFromDatasetFile
 
+/**
+ * Method loadFromMappedDatasetFile
+ *
+ * Maps in memory a file written using the method writeBinary and loads the
+ * ids and the outputs of its instances, while the graphs are left empty and
+ * built from the mapped file at their first access (see instanceAt). The file
+ * stays mapped until the dataset is cleared or loaded again.
+ *
+ * The method takes the following parameters:
+ *   - <file-path>: path of the file containing dataset entries.
+ */
+void MultiLabeledGraphDataset::loadFromMappedDatasetFile
+(
+    const util::Parameters& params
+)
+{
+  std::string filename = params.get("file-path");
+
+  this->clearDataset();
+
+  Instance *instance = NULL;
+
+  try
+  {
+    m_mapped_file.reset(new boost::iostreams::mapped_file_source(filename));
+    m_binary_file.reset(
+        new BinaryGraphFile(
+            m_mapped_file->data(), m_mapped_file->size(), m_label_pool));
+
+    for (Uint i = 0; i < m_binary_file->getSize(); ++i)
+    {
+      instance = new Instance();
+      instance->getId() = m_binary_file->getId(i);
+      m_binary_file->getOutput(i, instance->getOutput());
+
+      // adds the new instance in the dataset (with an empty graph)
+      this->pushBackInstance(instance);
+      instance = NULL;
+    } // for i
+
+    m_loaded_inputs.assign(m_binary_file->getSize(), input_not_loaded);
+
+  } // try
+  catch (std::exception& ex)
+  {
+    delete instance;
+    this->clearDataset();
+    throw moka::GenericException(
+        "MultiLabeledGraphDataset::loadFromMappedDatasetFile: error loading "
+        "the file " + filename + " (" + ex.what() + ")");
+  } // try-catch
+
+  // The dataset is successfully loaded.
+  this->endLoadInstances();
+
+  return;
+} // method loadFromMappedDatasetFile
 
 /**
  * Method loadFromSdf
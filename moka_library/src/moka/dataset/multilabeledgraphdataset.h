@@ -8,12 +8,23 @@
 #include <utility>
 #include <openbabel/mol.h>
 #include <openbabel/shared_ptr.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
 #include <moka/dataset/genericdataset.h>
 #include <moka/structure/multilabeledgraph.h>
 
+namespace boost {
+namespace iostreams {
+class mapped_file_source;
+} // namespace iostreams
+} // namespace boost
+
 namespace moka {
 namespace dataset {
 
+class BinaryGraphFile;
+
 /**
  * Class MultiLabeledGraphDataset
  *
@@ -24,6 +35,17 @@ namespace dataset {
  *
  * You can load a dataset from an SDF file by passing suitable parameters on
  * the method load.
+ *
+ * A dataset written in the binary format (see writeBinary) can also be
+ * mapped in memory instead of being read (see the method load): in this case
+ * only the ids and the outputs of the instances are loaded, while the graph
+ * of each instance is built from the mapped file at its first access, so
+ * only the graphs actually used (e.g. the ones of the training set and of
+ * the test fold) are paged in and built.
+ *
+ * The label sets of the graphs of the dataset are interned in a pool of the
+ * dataset (see LabelSet), so the equal label sets of its graphs share the
+ * same id.
  */
 class MultiLabeledGraphDataset :
     public GenericDataset< ::moka::structure::MultiLabeledGraph >
@@ -44,13 +66,17 @@ class MultiLabeledGraphDataset :
         bool split = true,
         bool input = true) const;
     virtual void read(std::istream& is);
+    virtual void readBinary(std::istream& is);
 
 #ifndef MOKA_TMP_CODE
     virtual void write(std::ostream& os) const;
 #endif // MOKA_TMP_CODE
 
+    virtual void writeBinary(std::ostream& os) const;
+
   protected:
     virtual void clearDataset();
+    virtual const Instance& instanceAt(Uint k) const;
 
   private:
     typedef std::vector< std::vector< std::string > > SmartsQueriesList;
@@ -58,6 +84,18 @@ class MultiLabeledGraphDataset :
 
     Uint m_skipped_instances;
 
+    // Pool of the label sets of the graphs of the dataset (renewed on each
+    // load, the graphs loaded before keep the old one alive)
+    boost::shared_ptr<structure::LabelSet::Pool> m_label_pool;
+
+    // Mapped binary dataset file (see loadFromMappedDatasetFile), with the
+    // state of the graph of each instance (not built, being built or built)
+    boost::shared_ptr<boost::iostreams::mapped_file_source> m_mapped_file;
+    boost::shared_ptr<BinaryGraphFile> m_binary_file;
+    mutable std::vector<char> m_loaded_inputs;
+    mutable boost::mutex m_loaded_inputs_mutex;
+    mutable boost::condition_variable m_loaded_inputs_cond;
+
     void buildAtomRound(
         OpenBabel::OBMol& mol,
         OpenBabel::OBAtom *mol_atom,
@@ -101,6 +139,8 @@ class MultiLabeledGraphDataset :
 
     void loadFromDatasetFile(const util::Parameters& params);
 
+    void loadFromMappedDatasetFile(const util::Parameters& params);
+
     void loadFromSdf(const util::Parameters& params);
 
     void printInstance(
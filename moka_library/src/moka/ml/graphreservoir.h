@@ -3,10 +3,14 @@
 
 #include <istream>
 #include <ostream>
+#include <string>
+#include <vector>
 #include <moka/exception.h>
 #include <moka/global.h>
 #include <moka/structure/graph.h>
+#include <moka/util/fasttanh.h>
 #include <moka/util/math.h>
+#include <moka/util/sparsematrix.h>
 
 namespace moka {
 namespace ml {
@@ -19,6 +23,110 @@ namespace ml {
  * The template type must be a graph derived or specilized from the structure
  * moka::structure::Graph.
  *
+ * The encoding process can be computed in several ways (see EncodingMode),
+ * that reach the same fixed point (up to the floating point rounding, or
+ * within the threshold epsilon for active_set_encoding):
+ *   - vertex_encoding: the state of each vertex is computed separately, with
+ *       a product W_hat * x(n') for each neighbor n' of the vertex.
+ *   - batched_encoding: the states of all the vertices of the graph are kept
+ *       as columns of a single N_r x V matrix X, then at each iteration are
+ *       computed the single product W_hat * X and the neighbors sum through
+ *       the (sparse) adjacency matrix of the graph. Since
+ *         Sum_{n'}(W_hat * x(n')) = (W_hat * X) * trans(A)(:, n)
+ *       each iteration costs one matrix-matrix product instead of one
+ *       matrix-vector product for each edge.
+ *   - active_set_encoding: as vertex_encoding, but the state of a vertex is
+ *       recomputed only while some of its neighbors is still changing by
+ *       more than epsilon; the converged vertices are frozen and reactivated
+ *       as soon as a neighbor moves again. The process ends with a full
+ *       sweep over all the vertices, and stops only if no vertex changes by
+ *       more than epsilon in it (the stop condition of vertex_encoding), so
+ *       the fixed point is the same within the threshold epsilon, and on
+ *       graphs where some regions converge earlier (e.g. long chains) most of
+ *       the products are skipped.
+ *   - fixed_size_encoding: as vertex_encoding, through a kernel specialized
+ *       on the reservoir size (see below).
+ *
+ * All the ways compute the fixed point through the Picard iteration
+ * x_{t} = F(x_{t-1}). Other solvers can be selected (see Solver), that reach
+ * the same fixed point (within the threshold epsilon) in fewer iterations:
+ *   - anderson_solver: Anderson acceleration, the next iterate is the
+ *       combination of the last m (the Anderson depth) iterates that
+ *       minimizes the residual G(x) - x in the least squares sense.
+ *   - gauss_seidel_solver: the vertices are updated in place, so each vertex
+ *       state uses the states of its neighbors already updated in the
+ *       current sweep.
+ *
+ * With fixed_size_encoding, for the common small reservoir sizes (N_r equal
+ * to 10, 16, 20, 25, 30, 32, 40, 48, 50 or 64) the vertex encoding (with the
+ * Picard iteration in double precision) is computed by a kernel specialized
+ * at compile time on N_r (see fixedVertexEncoding): the states are kept in
+ * buffers that are reused by the following encodings, the accumulators are
+ * fixed size arrays on the stack and the loops on N_r have constant bounds,
+ * so the iterations don't allocate memory and the products can be unrolled
+ * by the compiler. The kernel computes W_hat * Sum_{n'}(x(n')) with the dense
+ * W_hat, so the result is the same of vertex_encoding only up to the
+ * floating point rounding. With the other sizes, or with the sparse version
+ * of W_hat (see below), vertex_encoding is used instead.
+ *
+ * With the single precision (see setPrecision) the Picard iteration of the
+ * vertex and batched encodings is computed as the batched one, but on single
+ * precision copies of W_hat, of the input drive and of the states, halving
+ * the memory traffic of the products; the resulting states are converted back
+ * to double precision. The other solvers and the active set encoding always
+ * use the double precision. Since the states change by steps larger than the
+ * single precision rounding only while they are far from the fixed point,
+ * epsilon should be much larger than 1e-6 in single precision.
+ *
+ * The tanh of the state transition function is computed exactly (through
+ * std::tanh) by default. With the fast tanh (see setFastTanh) the double
+ * precision encodings use instead the vectorised approximation of
+ * util::FastTanh, fused with the sum of the input drive and of the neighbors
+ * contribution: the absolute error on each state component is lower than
+ * FastTanh::errorBound() (1e-15), then negligible with respect to epsilon.
+ *
+ * The init method scales W_hat by sigma / (k * ||W_hat||_2). By default the
+ * 2-norm is computed exactly (by a SVD, that costs O(N_r^3)); with a norm
+ * tolerance greater than 0 (see setNormTolerance) it is replaced by an upper
+ * bound within sqrt(1 + tolerance) of it (see util::Math::norm2Bound): the
+ * Lanczos estimate increased by its error bound, certified by a Cholesky
+ * factorization (about a tenth of the cost of the SVD), or the exact norm in
+ * the rare cases where the estimate can't be certified. So the scaled W_hat
+ * holds the contraction coefficient as with the exact norm, and it is at
+ * most more contractive by the tolerance.
+ *
+ * When the reservoir connectivity is lower than the sparse threshold (see
+ * setSparseThreshold) the reservoir matrix W_hat is also stored in a sparse
+ * format, and the products with W_hat in the encoding process access only its
+ * non-zero elements.
+ *
+ * With an ensemble size K greater than 1 (see setEnsembleSize) this object
+ * holds K reservoirs of size N_r, the member m initialized as a single
+ * reservoir with random seed equal to the random seed of this object plus m.
+ * Their input matrices are stacked into a single K*N_r x (N_u + 1) matrix
+ * W_in and their reservoir matrices are the blocks of a block diagonal
+ * K*N_r x K*N_r matrix W_hat, so the states of the K members are encoded
+ * together as a single state of size K*N_r (see getStateSize) in one pass
+ * over the graph: the input elements and the neighbors of each vertex are
+ * accessed once for all the members. The method splitStateGraph extracts the
+ * state graph of a member from the resulting state graph. Since the fixed
+ * point is reached when the change of the stacked states is within epsilon,
+ * each member reaches its fixed point within epsilon (with at most the
+ * iterations of the slowest member). With the density of W_hat lowered to
+ * c / K, a large ensemble is usually encoded with the sparse W_hat (see
+ * setSparseThreshold).
+ *
+ * The iterative process starts from null states, or from the states of an
+ * initial graph passed to the warm start versions of the method encoding
+ * (e.g. the states of a previous encoding of the same graph).
+ *
+ * The method encoding(const GraphType&) stores the resulting state graph and
+ * the number of iterations into this object. The const method
+ * encoding(const GraphType&, EncodingBuffer&, Uint&) instead uses only the
+ * buffer and the iterations counter passed by the caller, and then can be
+ * called by several threads at the same time on the same (initialized)
+ * reservoir, each thread with its own buffer.
+ *
  * References:
  *   [1] C. Gallicchio, A. Micheli. Supervised State Mapping of Clustered
  *       GraphESN States.
@@ -32,6 +140,105 @@ class GraphReservoir
     typedef ::moka::Global::Real Real;
     typedef ::moka::util::Math::Matrix Matrix;
     typedef ::moka::util::Math::Vector Vector;
+    typedef ::moka::util::Math::SingleReal SingleReal;
+    typedef ::moka::util::Math::SingleMatrix SingleMatrix;
+    typedef ::moka::util::Math::Precision Precision;
+    typedef ::moka::util::SparseMatrix SparseMatrix;
+
+    enum EncodingMode
+    {
+      vertex_encoding,
+      batched_encoding,
+      active_set_encoding,
+      fixed_size_encoding
+    };
+
+    enum Solver { picard_solver, anderson_solver, gauss_seidel_solver };
+
+    /**
+     * Class EncodingBuffer
+     *
+     * Working memory used by an encoding process: the states of the
+     * vertices (at the current and at the previous iteration) and the other
+     * matrices used by the computation. The buffer is owned by the caller of
+     * the reentrant method GraphReservoir::encoding and can be reused for
+     * several encodings, after each of them getStateGraph returns the
+     * resulting state graph, that can be also taken without copying it by
+     * swapStateGraph.
+     */
+    class EncodingBuffer
+    {
+      public:
+        //! Default constructor
+        EncodingBuffer() :
+          m_current(0)
+        { }
+
+        //! Clears the buffer
+        void clear()
+        {
+          m_graph1.clear();
+          m_graph2.clear();
+          m_states1.clear();
+          m_states2.clear();
+          m_states3.clear();
+          m_input_drive.clear();
+          m_what_states.clear();
+          m_neighbors_sum.clear();
+          m_vsum.clear();
+          m_residual.clear();
+          m_residual_prev.clear();
+          m_delta_f.clear();
+          m_delta_g.clear();
+          m_changes.clear();
+          m_active.clear();
+          m_single_states1.clear();
+          m_single_states2.clear();
+          m_single_input_drive.clear();
+          m_single_what_states.clear();
+          m_single_neighbors_sum.clear();
+          std::vector<Real>().swap(m_fixed_states1);
+          std::vector<Real>().swap(m_fixed_states2);
+          std::vector<Real>().swap(m_fixed_input_drive);
+          m_adjacency.clear();
+          m_current = 0;
+        }
+
+        //! State graph resulting from the last encoding that used this buffer
+        const GraphType& getStateGraph() const
+        {
+          return m_current == 0 ? m_graph1 : m_graph2;
+        }
+
+        //! Swaps the state graph resulting from the last encoding with the
+        //! passed graph, without copying it (the buffer then reuses the
+        //! passed graph and getStateGraph returns it)
+        void swapStateGraph(GraphType& graph)
+        {
+          (m_current == 0 ? m_graph1 : m_graph2).swap(graph);
+        }
+
+      private:
+        friend class GraphReservoir;
+
+        GraphType m_graph1, m_graph2;
+        Matrix m_states1, m_states2, m_states3;
+        Matrix m_input_drive;
+        Matrix m_what_states, m_neighbors_sum;
+        Vector m_vsum;
+        Vector m_residual, m_residual_prev;
+        Matrix m_delta_f, m_delta_g;
+        Vector m_changes;
+        std::vector<char> m_active;
+        SingleMatrix m_single_states1, m_single_states2;
+        SingleMatrix m_single_input_drive;
+        SingleMatrix m_single_what_states, m_single_neighbors_sum;
+        std::vector<Real> m_fixed_states1, m_fixed_states2;
+        std::vector<Real> m_fixed_input_drive;
+        SparseMatrix m_adjacency;
+        Uint m_current;
+
+    }; // class EncodingBuffer
 
     //! Default constructor
     GraphReservoir();
@@ -51,9 +258,48 @@ class GraphReservoir
     //! Encoding proccess using this reservoir
     const GraphType& encoding(const GraphType& input_graph, bool& fail);
 
+    //! Encoding proccess using this reservoir (reentrant version)
+    bool encoding(
+        const GraphType& input_graph,
+        EncodingBuffer& buffer,
+        Uint& iterations) const;
+
+    //! Encoding proccess starting from the states of an initial graph
+    bool encoding(
+        const GraphType& input_graph,
+        const GraphType& initial_graph);
+
+    //! Encoding proccess starting from the states of an initial graph
+    //! (reentrant version)
+    bool encoding(
+        const GraphType& input_graph,
+        const GraphType& initial_graph,
+        EncodingBuffer& buffer,
+        Uint& iterations) const;
     //! Encoding proccess using this reservoir (ignoring fails)
     const GraphType& encodingAnyway(const GraphType& input_graph);
 
+    //! EncodingMode to std::string conversion
+    static std::string encmToStr(const EncodingMode& encoding_mode);
+
+    //! Anderson depth (number of previous iterates used by anderson_solver)
+    const Uint& getAndersonDepth() const
+    {
+      return m_anderson_depth;
+    }
+
+    //! Encoding mode
+    EncodingMode getEncodingMode() const
+    {
+      return m_encoding_mode;
+    }
+
+    //! Ensemble size (number of reservoirs encoded together, K)
+    const Uint& getEnsembleSize() const
+    {
+      return m_ensemble_size;
+    }
+
     //! Epsilon (threshold for the encoding process)
     const Real& getEpsilon() const
     {
@@ -81,7 +327,7 @@ class GraphReservoir
     //! State graph resulting from the last call of the method encoding
     const GraphType& getLastStateGraph() const
     {
-      return m_state_graph;
+      return m_buffer.getStateGraph();
     }
 
     //! Iterations computed to reach the fixed point during the last encoding
@@ -102,6 +348,12 @@ class GraphReservoir
       return m_max_iterations;
     }
 
+    //! Tolerance of the 2-norm bound used by init (0 for the exact norm)
+    const Real& getNormTolerance() const
+    {
+      return m_norm_tolerance;
+    }
+
     //! Reservoir connectivity
     const Real& getReservoirConnectivity() const
     {
@@ -114,12 +366,36 @@ class GraphReservoir
       return m_What;
     }
 
+    //! 2-norm of W_hat before the rescaling, as used by init (0 if unknown)
+    const Real& getReservoirMatrixNorm() const
+    {
+      return m_what_norm;
+    }
+
     //! Reservoir size (N_r)
     const Uint& getReservoirSize() const
     {
       return m_N_r;
     }
 
+    //! Size of the vertices states (K * N_r, the sizes of all the members)
+    const Uint& getStateSize() const
+    {
+      return m_N_s;
+    }
+
+    //! Connectivity threshold under which W_hat is stored as sparse matrix
+    const Real& getSparseThreshold() const
+    {
+      return m_sparse_threshold;
+    }
+
+    //! Floating point precision of the encoding process
+    Precision getPrecision() const
+    {
+      return m_precision;
+    }
+
     //! Random seed
     Uint getRandomSeed() const
     {
@@ -132,24 +408,72 @@ class GraphReservoir
       return m_sigma;
     }
 
+    //! Solver used to compute the fixed point
+    Solver getSolver() const
+    {
+      return m_solver;
+    }
+
     //! Reservoir initialization (to call after setted reservoir parameters)
     void init();
 
+    //! Is the tanh approximated in the encoding process? (see setFastTanh)
+    bool isFastTanh() const
+    {
+      return m_fast_tanh;
+    }
+
     //! Is this class initialized and then usable?
     bool isInitialized() const
     {
       return m_is_initialized;
     }
 
+    //! Is the reservoir matrix W_hat used in the sparse format?
+    bool isReservoirMatrixSparse() const
+    {
+      return m_is_what_sparse;
+    }
+
     //! Read this object from input stream
     virtual void read(std::istream& is);
 
+    //! Anderson depth (number of previous iterates used by anderson_solver)
+    void setAndersonDepth(const Uint& depth)
+    {
+      m_anderson_depth = depth;
+    }
+
+    //! Encoding mode
+    void setEncodingMode(EncodingMode encoding_mode)
+    {
+      m_encoding_mode = encoding_mode;
+    }
+
+    //! Ensemble size (number of reservoirs encoded together, K)
+    void setEnsembleSize(const Uint& size)
+    {
+      if (size == 0)
+        throw std::out_of_range(
+            "GraphReservoir::setEnsembleSize: the ensemble size must be "
+            "greater than 0.");
+      m_ensemble_size = size;
+      m_N_s = m_ensemble_size * m_N_r;
+      setInitialized(false);
+    }
+
     //! Epsilon (threshold for the encoding process)
     void setEpsilon(const Real& epsilon)
     {
       m_epsilon = epsilon;
     }
 
+    //! Uses the approximated (vectorised) tanh in the encoding process
+    void setFastTanh(bool fast_tanh)
+    {
+      m_fast_tanh = fast_tanh;
+    }
+
     //! Input scaling
     void setInputScaling(const Real& scaling)
     {
@@ -177,6 +501,20 @@ class GraphReservoir
       m_max_iterations = max_iterations;
     }
 
+    //! Tolerance of the 2-norm bound used by init (0 for the exact norm)
+    void setNormTolerance(const Real& tolerance)
+    {
+      m_norm_tolerance = tolerance;
+      setInitialized(false);
+    }
+
+    //! Floating point precision of the encoding process
+    void setPrecision(Precision precision)
+    {
+      m_precision = precision;
+      updateSingleReservoirMatrix();
+    }
+
     //! Reservoir connectivity
     void setReservoirConnectivity(const Real& connectivity)
     {
@@ -192,6 +530,7 @@ class GraphReservoir
     void setReservoirSize(const Uint& size)
     {
       m_N_r = size;
+      m_N_s = m_ensemble_size * m_N_r;
       setInitialized(false);
     }
 
@@ -202,6 +541,17 @@ class GraphReservoir
       setInitialized(false);
     }
 
+    //! Connectivity threshold under which W_hat is stored as sparse matrix
+    void setSparseThreshold(const Real& threshold)
+    {
+      m_sparse_threshold = threshold;
+      if (isInitialized())
+      {
+        updateSparseReservoirMatrix();
+        updateSingleReservoirMatrix();
+      }
+    }
+
     //! Sigma (for reservoir scaling)
     void setSigma(const Real& sigma)
     {
@@ -209,6 +559,27 @@ class GraphReservoir
       setInitialized(false);
     }
 
+    //! Solver used to compute the fixed point
+    void setSolver(Solver solver)
+    {
+      m_solver = solver;
+    }
+
+    //! Solver to std::string conversion
+    static std::string solvToStr(const Solver& solver);
+
+    //! State graph of an ensemble member from a state graph of this object
+    void splitStateGraph(
+        const GraphType& state_graph,
+        Uint member,
+        GraphType& member_graph) const;
+
+    //! std::string to EncodingMode conversion
+    static EncodingMode strToEncm(const std::string& str);
+
+    //! std::string to Solver conversion
+    static Solver strToSolv(const std::string& str);
+
     //! Write this object on output stream
     virtual void write(std::ostream& os) const;
 
@@ -218,20 +589,102 @@ class GraphReservoir
     // Reservoir parameters
     Matrix m_W_in, m_What;
     Uint m_N_u, m_N_r;
+    Uint m_ensemble_size, m_N_s;
     Real m_epsilon, m_sigma;
     Real m_input_scaling;
     Real m_connectivity;
+    Real m_norm_tolerance;
+    Real m_what_norm;
+    Real m_sparse_threshold;
+    bool m_is_what_sparse;
+    SparseMatrix m_What_sparse;
+    Precision m_precision;
+    SingleMatrix m_What_single;
     Uint m_max_degree;
     Uint m_max_iterations;
     Uint m_iterations;
-    GraphType m_state_graph;
+    EncodingMode m_encoding_mode;
+    Solver m_solver;
+    Uint m_anderson_depth;
+    bool m_fast_tanh;
+    EncodingBuffer m_buffer;
 
     // Random number generator
     Global::UniformRandomGenerator m_rand;
 
     // Private methods
+    void activation(
+        const Real *input_drive,
+        const Real *neighbors_sum,
+        Real *states,
+        Uint size) const;
+    void activeSetEncoding(
+        const GraphType& input_graph,
+        const GraphType* initial_graph,
+        EncodingBuffer& buffer,
+        Uint& iterations) const;
+    void andersonEncoding(
+        const GraphType& input_graph,
+        const GraphType* initial_graph,
+        EncodingBuffer& buffer,
+        Uint& iterations) const;
+    void batchedEncoding(
+        const GraphType& input_graph,
+        const GraphType* initial_graph,
+        EncodingBuffer& buffer,
+        Uint& iterations) const;
+    void buildAdjacency(
+        const GraphType& input_graph, SparseMatrix& adjacency) const;
     void clearObject();
+    bool computeEncoding(
+        const GraphType& input_graph,
+        const GraphType* initial_graph,
+        EncodingBuffer& buffer,
+        Uint& iterations) const;
+    void computeInputDrive(
+        const GraphType& input_graph, Matrix& input_drive) const;
+    bool fixedSizeEncoding(
+        const GraphType& input_graph,
+        const GraphType* initial_graph,
+        EncodingBuffer& buffer,
+        Uint& iterations) const;
+    template <Uint N>
+    void fixedVertexEncoding(
+        const GraphType& input_graph,
+        const GraphType* initial_graph,
+        EncodingBuffer& buffer,
+        Uint& iterations) const;
+    void gaussSeidelEncoding(
+        const GraphType& input_graph,
+        const GraphType* initial_graph,
+        EncodingBuffer& buffer,
+        Uint& iterations) const;
+    void initialStates(
+        const GraphType& input_graph,
+        const GraphType* initial_graph,
+        Matrix& states) const;
     void setInitialized(bool initialized = false);
+    void singleBatchedEncoding(
+        const GraphType& input_graph,
+        const GraphType* initial_graph,
+        EncodingBuffer& buffer,
+        Uint& iterations) const;
+    static Real squaredChange(const Real *x, const Real *y, Uint size);
+    Real stateTransition(
+        const Matrix& states,
+        Matrix& next_states,
+        EncodingBuffer& buffer) const;
+    void storeStateGraph(
+        const GraphType& input_graph,
+        const Matrix& states,
+        EncodingBuffer& buffer) const;
+    void updateSingleReservoirMatrix();
+    void updateSparseReservoirMatrix();
+    void vertexEncoding(
+        const GraphType& input_graph,
+        const GraphType* initial_graph,
+        EncodingBuffer& buffer,
+        Uint& iterations) const;
 
 }; // class GraphReservoir
 
@@ -3,6 +3,8 @@
 
 #include "graphreservoir.h"
 
+#include <algorithm>
+#include <cmath>
 #include <boost/lambda/bind.hpp>
 #include <boost/lambda/lambda.hpp>
 #include <moka/log.h>
@@ -51,96 +53,22 @@ GraphReservoir<T>::~GraphReservoir()
  * The object must be initialized before you can use this method (see method
  * init).
  *
+ * The fixed point is computed by the solver setted (see setSolver) and, for the
+ * Picard solver, according to the encoding mode and the precision setted (see
+ * setEncodingMode and setPrecision).
+ *
  * A moka::GenericException exception will be thrown if the input graph doesn't
  * match parameters of this reservoir, or if the object is not initialized.
  */
 template <typename Graph>
 bool GraphReservoir<Graph>::encoding(const Graph& input_graph)
 {
-  // Checks the initialization
-  if (!isInitialized())
-    throw moka::GenericException(
-        "GraphReservoir::encoding: the object is not initialized");
-
-  // Checks the input graph
-  if (input_graph.getElementsSize() != m_N_u)
-    throw moka::GenericException(
-        "GraphReservoir::encoding: wrong elements size in the input graph");
-
-  // Builds two states graphs with the same structure of the input graph and
-  // elements of size Nr initialized as null vectors (vectors of all 0).
-  Graph graph1, graph2;
-  graph1.buildFrom(input_graph, arma::zeros(m_N_r));
-  graph2.buildFrom(input_graph, arma::zeros(m_N_r));
-
-  // Makes two pointers that will be swapped
-  Graph *current = &graph1;
-  Graph *previous = &graph2;
-
-  // Starts the iterative encoding process
-  m_iterations = 0;
-  while (m_iterations < m_max_iterations)
-  {
-    // The current state graph becomes the state graph at the previous step.
-    std::swap(current, previous);
-
-    // Computes the states of the current state graph according to the state
-    // transition function for each vertex n:
-    //    x_{t}(n) = tanh(W_in * u(n) + Sum_{n'}(What * x_{t-1}(n'))
-    // where n' are the neighbors of the vertex n
-    for (size_t n = 0; n < current->getSize(); ++n)
-    {
-      Vector vsum(m_N_r);
-      vsum.zeros();
-
-      // Note: also if the graph degree is greater than k (i.e. m_max_degree)
-      // the state is computed
-      for (Uint i = 0; i < previous->getNeighborsSize(n); ++i)
-        vsum += m_What * previous->getNeighbor(n, i);
+  bool return_value = encoding(input_graph, m_buffer, m_iterations);
 
-      Vector vin = input_graph.getVertexElement(n);
-
-      // Adds the fixed input for the bias
-      vin.insert_rows(0, 1);
-      vin[0] = 1;
-
-      // Computes the n-th state
-      current->setVertexElement(n, arma::tanh(m_W_in * vin + vsum));
-
-    } // for n
-
-    // Computes max_{n} || x_{t}(n) - x_{t-1}(n) || in order to check the
-    // fixed point reaching
-    Real max_n_norm = 0;
-    for (Uint n = 0; n < current->getSize(); ++n)
-    {
-      Real n_norm =
-          arma::norm(
-            current->getVertexElement(n) - previous->getVertexElement(n), 2);
-      if (n_norm > max_n_norm)
-        max_n_norm = n_norm;
-    } // for n
-
-    // Iterates until the fixed point is reached (approssimated by the
-    // threshold epsilon)
-    m_iterations++;
-    if (max_n_norm <= m_epsilon)
-      break;
-
-  } // while m_iterations
-
-  bool return_value = true;
-  if (m_iterations == m_max_iterations)
-  {
+  if (!return_value)
     Log::vrb << "GraphReservoir::encoding: reached the maximum number of "
              << "iterations (the fixed point has not been reached)."
              << Log::endl;
-    return_value = false;
-  }
-
-  // Copy result graph in the state graph (note that the pointers must not be
-  // deleted)
-  m_state_graph = (*current);
 
   return return_value;
 } // method encoding
@@ -164,6 +92,86 @@ const Graph& GraphReservoir<Graph>::encoding
   return getLastStateGraph();
 } // method encoding
 
+/**
+ * Method encoding
+ *
+ * Reentrant version of encoding(const GraphType&): the encoding process is
+ * computed using only the buffer passed (see EncodingBuffer), where the
+ * resulting state graph is stored, and the number of iterations computed is
+ * stored in the "iterations" argument. This object is not modified, so any
+ * number of threads can call this method at the same time, each one with its
+ * own buffer. Returns true if the fixed point is reached, false otherwise
+ * (unlike encoding(const GraphType&) nothing is logged).
+ *
+ * The buffer can be reused for several calls: its memory is reused when the
+ * dimensions of the input graph allow it.
+ *
+ * A moka::GenericException exception will be thrown if the input graph doesn't
+ * match parameters of this reservoir, or if the object is not initialized.
+ */
+template <typename Graph>
+bool GraphReservoir<Graph>::encoding
+(
+    const Graph& input_graph,
+    EncodingBuffer& buffer,
+    Uint& iterations
+) const
+{
+  return computeEncoding(input_graph, NULL, buffer, iterations);
+} // method encoding
+
+/**
+ * Method encoding
+ *
+ * Warm start version of encoding(const GraphType&): the iterative process
+ * starts from the states of the vertices of "initial_graph" instead of the
+ * null states. The initial graph must have the same number of vertices of
+ * the input graph and elements of size N_r, e.g. the state graph of a
+ * previous encoding of the same graph (with a different epsilon) or states
+ * taken from similar vertices. The fixed point doesn't depend on the initial
+ * states (the reservoir is contractive), but a good starting point reduces
+ * the number of iterations.
+ *
+ * A moka::GenericException exception will be thrown if the input graph or the
+ * initial graph don't match parameters of this reservoir, or if the object is
+ * not initialized.
+ */
+template <typename Graph>
+bool GraphReservoir<Graph>::encoding
+(
+    const Graph& input_graph,
+    const Graph& initial_graph
+)
+{
+  bool return_value =
+      computeEncoding(input_graph, &initial_graph, m_buffer, m_iterations);
+
+  if (!return_value)
+    Log::vrb << "GraphReservoir::encoding: reached the maximum number of "
+             << "iterations (the fixed point has not been reached)."
+             << Log::endl;
+
+  return return_value;
+} // method encoding
+
+/**
+ * Method encoding
+ *
+ * Reentrant version of encoding(const GraphType&, const GraphType&): see
+ * encoding(const GraphType&, EncodingBuffer&, Uint&).
+ */
+template <typename Graph>
+bool GraphReservoir<Graph>::encoding
+(
+    const Graph& input_graph,
+    const Graph& initial_graph,
+    EncodingBuffer& buffer,
+    Uint& iterations
+) const
+{
+  return computeEncoding(input_graph, &initial_graph, buffer, iterations);
+} // method encoding
+
 /**
  * Method encodingAnyway
  *
@@ -179,10 +187,41 @@ const Graph& GraphReservoir<Graph>::encodingAnyway(const Graph& input_graph)
   return getLastStateGraph();
 } // method encodingAnyway
 
+/**
+ * Method encmToStr
+ *
+ * Converts an EncodingMode value into an std::string. If the EncodingMode
+ * value is not recognized throws an exception of type moka::GenericException.
+ */
+template <typename T>
+std::string GraphReservoir<T>::encmToStr(const EncodingMode& encoding_mode)
+{
+  switch (encoding_mode)
+  {
+  case vertex_encoding:
+    return "vertex";
+    break;
+  case batched_encoding:
+    return "batched";
+    break;
+  case active_set_encoding:
+    return "active-set";
+    break;
+  case fixed_size_encoding:
+    return "fixed-size";
+    break;
+  default:
+    throw moka::GenericException(
+          "GraphReservoir::encmToStr: invalid EncodingMode value");
+  }
+  // return "";
+} // method encmToStr
+
 /**
  * Method init
  *
- * Initializes the two matrix W_in and What.
+ * Initializes the two matrix W_in and What (and the sparse version of What if
+ * the connectivity is under the sparse threshold).
  * The following parameters must be properly setted before to call this method
  * and you must re-call this method if any of this is changed:
  *   - input size
@@ -191,45 +230,79 @@ const Graph& GraphReservoir<Graph>::encodingAnyway(const Graph& input_graph)
  *   - input scaling
  *   - sigma
  *   - max degree
+ *   - norm tolerance (see setNormTolerance)
+ *   - ensemble size (see setEnsembleSize)
  *
+ * With an ensemble size K greater than 1 the member m is initialized (as
+ * described above) by a generator with random seed equal to the random seed
+ * of this object plus m, in the rows m*N_r ... (m+1)*N_r - 1 of W_in and in
+ * the diagonal block m of W_hat (the other elements of W_hat are 0); the
+ * reservoir matrix norm is then the max of the members norms.
  */
 template <typename T>
 void GraphReservoir<T>::init()
 {
   // Inits matrices
-  m_W_in.set_size(m_N_r, m_N_u + 1);
-  m_What.set_size(m_N_r, m_N_r);
-
-  // Fills W_in
-  std::generate
-      (
-        m_W_in.begin(),
-        m_W_in.end(),
-        bll::bind
-            (
-              &Global::UniformRandomGenerator::getRandReal,
-              bll::var(m_rand),
-              -m_input_scaling,
-              m_input_scaling
-            )
-      );
-
-  // Fills What
-  typename Matrix::iterator what_it = m_What.begin();
-  for (/* nop */; what_it != m_What.end(); ++what_it)
-    *what_it =
-        m_rand.getRandReal(0, 1) <= m_connectivity ?
-          m_rand.getRandReal(-1.0, 1.0) : 0.0;
-
-  // Rescales What in order to hold the contraction coefficient
-  double what_norm2 = arma::norm(m_What, 2);
-  if (what_norm2 == 0 || m_sigma == 0)
-    m_What.zeros();
-  else
-    m_What = (m_sigma / (m_max_degree * what_norm2)) * m_What;
+  m_W_in.set_size(m_N_s, m_N_u + 1);
+  m_What.zeros(m_N_s, m_N_s);
+  m_what_norm = 0.0;
+
+  for (Uint m = 0; m < m_ensemble_size; ++m)
+  {
+    // The first member uses the generator of this object
+    Global::UniformRandomGenerator member_rand(m_rand.getRandSeed() + m);
+    Global::UniformRandomGenerator& rand = (m == 0) ? m_rand : member_rand;
+
+    // Fills the rows of W_in and the block of What of the member
+    Matrix W_in(m_N_r, m_N_u + 1);
+    Matrix What(m_N_r, m_N_r);
+    std::generate
+        (
+          W_in.begin(),
+          W_in.end(),
+          bll::bind
+              (
+                &Global::UniformRandomGenerator::getRandReal,
+                bll::var(rand),
+                -m_input_scaling,
+                m_input_scaling
+              )
+        );
+    typename Matrix::iterator what_it = What.begin();
+    for (/* nop */; what_it != What.end(); ++what_it)
+      *what_it =
+          rand.getRandReal(0, 1) <= m_connectivity ?
+            rand.getRandReal(-1.0, 1.0) : 0.0;
+
+    // Rescales What in order to hold the contraction coefficient: the 2-norm
+    // is exact, or an upper bound of it within the norm tolerance if this is
+    // greater than 0
+    double what_norm2;
+    if (m_norm_tolerance > 0)
+      what_norm2 = mut::Math::norm2Bound(What, m_norm_tolerance);
+    else
+      what_norm2 = arma::norm(What, 2);
+    m_what_norm = std::max(m_what_norm, what_norm2);
+    if (what_norm2 == 0 || m_sigma == 0)
+      What.zeros();
+    else
+      What = (m_sigma / (m_max_degree * what_norm2)) * What;
+
+    const Uint first = m * m_N_r;
+    for (Uint j = 0; j < m_N_u + 1; ++j)
+      std::copy(
+          W_in.begin_col(j), W_in.end_col(j), m_W_in.begin_col(j) + first);
+    for (Uint j = 0; j < m_N_r; ++j)
+      std::copy(
+          What.begin_col(j),
+          What.end_col(j),
+          m_What.begin_col(first + j) + first);
+  } // for m
 
   // Makes this object usable
   setInitialized(true);
+  updateSparseReservoirMatrix();
+  updateSingleReservoirMatrix();
 
   return;
 } // method init
@@ -268,6 +341,14 @@ void GraphReservoir<T>::read(std::istream& is)
 
     m_rand.setRandSeed(Global::readLine<Uint>(is));
 
+    // The ensemble size is given by the stacked matrices
+    m_ensemble_size =
+        (m_N_r > 0 && m_What.n_rows > m_N_r) ? m_What.n_rows / m_N_r : 1;
+    m_N_s = m_ensemble_size * m_N_r;
+
+    updateSparseReservoirMatrix();
+    updateSingleReservoirMatrix();
+
   } // try
   catch (std::exception& ex)
   {
@@ -280,6 +361,128 @@ void GraphReservoir<T>::read(std::istream& is)
   return;
 } // method read
 
+/**
+ * Method solvToStr
+ *
+ * Converts a Solver value into an std::string. If the Solver value is not
+ * recognized throws an exception of type moka::GenericException.
+ */
+template <typename T>
+std::string GraphReservoir<T>::solvToStr(const Solver& solver)
+{
+  switch (solver)
+  {
+  case picard_solver:
+    return "picard";
+    break;
+  case anderson_solver:
+    return "anderson";
+    break;
+  case gauss_seidel_solver:
+    return "gauss-seidel";
+    break;
+  default:
+    throw moka::GenericException(
+          "GraphReservoir::solvToStr: invalid Solver value");
+  }
+  // return "";
+} // method solvToStr
+
+/**
+ * Method splitStateGraph
+ *
+ * Builds in member_graph the state graph of the ensemble member "member"
+ * (see setEnsembleSize), with the same structure of state_graph (a state
+ * graph computed by this object) and the elements of size N_r taken from the
+ * rows member*N_r ... (member+1)*N_r - 1 of the states.
+ *
+ * A moka::GenericException exception will be thrown if the member is not
+ * lower than the ensemble size, or if the elements of state_graph are not of
+ * size K*N_r.
+ */
+template <typename Graph>
+void GraphReservoir<Graph>::splitStateGraph
+(
+    const Graph& state_graph,
+    Uint member,
+    Graph& member_graph
+) const
+{
+  if (member >= m_ensemble_size)
+    throw moka::GenericException(
+        "GraphReservoir::splitStateGraph: invalid ensemble member");
+  if (state_graph.getSize() > 0 && state_graph.getElementsSize() != m_N_s)
+    throw moka::GenericException(
+        "GraphReservoir::splitStateGraph: wrong elements size in the state "
+        "graph");
+
+  Vector state(m_N_r);
+  member_graph.buildFrom(state_graph, state);
+  for (Uint n = 0; n < state_graph.getSize(); ++n)
+  {
+    const Vector& x = state_graph.getVertexElement(n);
+    std::copy(
+        x.begin() + member * m_N_r,
+        x.begin() + (member + 1) * m_N_r,
+        state.begin());
+    member_graph.setVertexElement(n, state);
+  } // for n
+
+  return;
+} // method splitStateGraph
+
+/**
+ * Method strToEncm
+ *
+ * Converts an std::string into an EncodingMode value. If the string is not
+ * recognized throws an exception of type moka::GenericException.
+ */
+template <typename T>
+typename GraphReservoir<T>::EncodingMode GraphReservoir<T>::strToEncm
+(
+    const std::string& str
+)
+{
+  if (str == "vertex")
+    return vertex_encoding;
+  else if (str == "batched")
+    return batched_encoding;
+  else if (str == "active-set")
+    return active_set_encoding;
+  else if (str == "fixed-size")
+    return fixed_size_encoding;
+  else
+    throw moka::GenericException(
+        "GraphReservoir::strToEncm: Invalid string representation of an "
+        "EncodingMode value");
+  // return 0;
+} // method strToEncm
+
+/**
+ * Method strToSolv
+ *
+ * Converts an std::string into a Solver value. If the string is not
+ * recognized throws an exception of type moka::GenericException.
+ */
+template <typename T>
+typename GraphReservoir<T>::Solver GraphReservoir<T>::strToSolv
+(
+    const std::string& str
+)
+{
+  if (str == "picard")
+    return picard_solver;
+  else if (str == "anderson")
+    return anderson_solver;
+  else if (str == "gauss-seidel")
+    return gauss_seidel_solver;
+  else
+    throw moka::GenericException(
+        "GraphReservoir::strToSolv: Invalid string representation of a "
+        "Solver value");
+  // return 0;
+} // method strToSolv
+
 /**
  * Method write
  *
@@ -291,7 +494,11 @@ void GraphReservoir<T>::read(std::istream& is)
  * read) the method getLastStateGraph returns an empty graph until you call
  * the encoding method, and (most important) by calling the init method you can
  * get a different initialization respect to call such method before the
- * write/read process.
+ * write/read process. Also the encoding mode, the solver, the precision and
+ * the sparse threshold are not written, since they don't change the encoding
+ * result (within the threshold epsilon). The ensemble size is not written,
+ * since it is given by the sizes of W_in and W_hat (stacked for all the
+ * members).
  */
 template <typename T>
 void GraphReservoir<T>::write(std::ostream& os) const
@@ -319,6 +526,804 @@ void GraphReservoir<T>::write(std::ostream& os) const
 // PRIVATE METHODS
 // ===============
 
+/**
+ * Method activation
+ *
+ * Applies the tanh of the state transition function to "size" components:
+ *    states_i = tanh(input_drive_i + neighbors_sum_i)
+ * through the approximation util::FastTanh::tanhSum if the fast tanh is used
+ * (see setFastTanh), through std::tanh otherwise. The output array "states"
+ * may be one of the input arrays.
+ */
+template <typename Graph>
+void GraphReservoir<Graph>::activation
+(
+    const Real *input_drive,
+    const Real *neighbors_sum,
+    Real *states,
+    Uint size
+) const
+{
+  if (m_fast_tanh)
+    mut::FastTanh::tanhSum(input_drive, neighbors_sum, states, size);
+  else
+    mut::FastTanh::exactTanhSum(input_drive, neighbors_sum, states, size);
+  return;
+} // method activation
+
+/**
+ * Method activeSetEncoding
+ *
+ * Computes the encoding process of the input graph (see encoding) as the
+ * method vertexEncoding, but recomputing at each iteration only the active
+ * vertices: the state x_{t}(n) depends only on the states of the neighbors of
+ * n at the step t-1, then the vertex n is active at the step t only if some
+ * of its neighbors changed by more than epsilon at the step t-1:
+ *    max_{n'} || x_{t-1}(n') - x_{t-2}(n') || > epsilon
+ * otherwise its state is kept (frozen). A frozen vertex becomes active again
+ * as soon as one of its neighbors moves by more than epsilon. At the first
+ * step all the vertices are active.
+ *
+ * A frozen vertex is not recomputed while its neighbors move by steps not
+ * greater than epsilon, but such steps can add up to more than epsilon over
+ * many iterations. Then when the maximum change of the recomputed vertices is
+ * not greater than epsilon (and no vertex would be active at the next step)
+ * a full sweep is computed, with all the vertices active: the process stops
+ * only when the maximum change of a full sweep is not greater than epsilon,
+ * that is the same stop condition of vertexEncoding; otherwise the active set
+ * is updated from the changes of the full sweep and the process goes on.
+ *
+ * The number of iterations computed is stored in "iterations" and the
+ * resulting state graph in the buffer.
+ */
+template <typename Graph>
+void GraphReservoir<Graph>::activeSetEncoding
+(
+    const Graph& input_graph,
+    const Graph* initial_graph,
+    EncodingBuffer& buffer,
+    Uint& iterations
+) const
+{
+  const typename Graph::View graph(input_graph);
+  const Uint size = graph.getSize();
+
+  // Input drive W_in * [1; u(n)] of each vertex n
+  computeInputDrive(input_graph, buffer.m_input_drive);
+  const Matrix& input_drive = buffer.m_input_drive;
+
+  // Makes two state matrices (initialized with the initial states) and two
+  // pointers that will be swapped
+  initialStates(input_graph, initial_graph, buffer.m_states1);
+  buffer.m_states2.zeros(m_N_s, size);
+  Matrix *current = &buffer.m_states1;
+  Matrix *previous = &buffer.m_states2;
+
+  Vector& neighbors_sum = buffer.m_residual;
+  Vector& vsum = buffer.m_vsum;
+  Vector& changes = buffer.m_changes;
+  std::vector<char>& active = buffer.m_active;
+  neighbors_sum.set_size(m_N_s);
+  vsum.set_size(m_N_s);
+  changes.set_size(size);
+  active.assign(size, 1);
+  bool full_sweep = true;
+
+  // Starts the iterative encoding process
+  iterations = 0;
+  while (iterations < m_max_iterations)
+  {
+    // The current states become the states at the previous step.
+    std::swap(current, previous);
+
+    // Computes the states of the active vertices, the other ones are copied
+    // from the previous step
+    Real max_n_norm = 0;
+    for (Uint n = 0; n < size; ++n)
+    {
+      const Real *prev_col = previous->colptr(n);
+      Real *curr_col = current->colptr(n);
+
+      if (!active[n])
+      {
+        std::copy(prev_col, prev_col + m_N_s, curr_col);
+        changes[n] = 0;
+        continue;
+      } // if
+
+      // x_{t}(n) = tanh(W_in * u(n) + What * Sum_{n'}(x_{t-1}(n')))
+      neighbors_sum.zeros();
+      for (Uint i = 0; i < graph.getNeighborsSize(n); ++i)
+      {
+        const Real *x_col = previous->colptr(graph.getNeighborIndex(n, i));
+        for (Uint k = 0; k < m_N_s; ++k)
+          neighbors_sum[k] += x_col[k];
+      } // for i
+
+      if (m_is_what_sparse)
+        m_What_sparse.multiply(neighbors_sum, vsum);
+      else
+        vsum = m_What * neighbors_sum;
+
+      activation(input_drive.colptr(n), vsum.memptr(), curr_col, m_N_s);
+      changes[n] = std::sqrt(squaredChange(curr_col, prev_col, m_N_s));
+      if (changes[n] > max_n_norm)
+        max_n_norm = changes[n];
+    } // for n
+
+    // Iterates until the fixed point is reached (approssimated by the
+    // threshold epsilon) on a full sweep, otherwise computes a full sweep
+    iterations++;
+    if (max_n_norm <= m_epsilon)
+    {
+      if (full_sweep)
+        break;
+      active.assign(size, 1);
+      full_sweep = true;
+      continue;
+    } // if
+
+    // Updates the active set: a vertex is active if some neighbor moved
+    full_sweep = false;
+    for (Uint n = 0; n < size; ++n)
+    {
+      active[n] = 0;
+      for (Uint i = 0; i < graph.getNeighborsSize(n); ++i)
+        if (changes[graph.getNeighborIndex(n, i)] > m_epsilon)
+        {
+          active[n] = 1;
+          break;
+        } // if
+    } // for n
+
+  } // while iterations
+
+  storeStateGraph(input_graph, *current, buffer);
+
+  return;
+} // method activeSetEncoding
+
+/**
+ * Method andersonEncoding
+ *
+ * Computes the encoding process of the input graph (see encoding) through
+ * the Anderson acceleration of the fixed point iteration. Let be G the state
+ * transition function applied to all the vertices (see stateTransition), at
+ * each iteration t are computed G(X_t) and the residual F_t = G(X_t) - X_t,
+ * then the next iterate is the combination of the last m values of G:
+ *    X_{t+1} = G(X_t) - Sum_{j}(gamma_j * (G(X_{t-j}) - G(X_{t-j-1})))
+ * where the coefficients gamma minimize the norm of the combination of the
+ * residuals F_t - Sum_{j}(gamma_j * (F_{t-j} - F_{t-j-1})), with m the
+ * Anderson depth (see setAndersonDepth). The least squares problem is solved
+ * through the (slightly regularized) normal equations, if it is singular the
+ * history is discarded and a Picard step X_{t+1} = G(X_t) is taken.
+ *
+ * As for the Picard iteration, the process stops when
+ *    max_{n} || G(X_t)(n) - X_t(n) || <= epsilon
+ * and the resulting states are G(X_t). Each iteration computes the function G
+ * only once, then the number of iterations can be compared with the one of
+ * the Picard iteration.
+ *
+ * The number of iterations computed is stored in "iterations" and the
+ * resulting state graph in the buffer.
+ */
+template <typename Graph>
+void GraphReservoir<Graph>::andersonEncoding
+(
+    const Graph& input_graph,
+    const Graph* initial_graph,
+    EncodingBuffer& buffer,
+    Uint& iterations
+) const
+{
+  const Uint size = input_graph.getSize();
+  const Uint dim = m_N_s * size;
+  const Uint depth = m_anderson_depth;
+
+  // Adjacency matrix and input drive W_in * U (they don't change during the
+  // iterations)
+  buildAdjacency(input_graph, buffer.m_adjacency);
+  computeInputDrive(input_graph, buffer.m_input_drive);
+
+  // Current iterate X_t, G(X_t) and G(X_{t-1}), all the states are stored
+  // column-wise in N_r x V matrices
+  Matrix& states = buffer.m_states1;
+  Matrix& g_states = buffer.m_states2;
+  Matrix& g_states_prev = buffer.m_states3;
+  initialStates(input_graph, initial_graph, states);
+
+  // Residuals and differences history (circular buffers of "depth" columns)
+  Vector& residual = buffer.m_residual;
+  Vector& residual_prev = buffer.m_residual_prev;
+  Matrix& delta_f = buffer.m_delta_f;
+  Matrix& delta_g = buffer.m_delta_g;
+  residual.set_size(dim);
+  residual_prev.set_size(dim);
+  delta_f.set_size(dim, depth);
+  delta_g.set_size(dim, depth);
+  Uint history_size = 0;
+  Uint history_next = 0;
+
+  // Starts the iterative encoding process
+  iterations = 0;
+  while (iterations < m_max_iterations)
+  {
+    // Computes G(X_t), checking the fixed point reaching
+    Real max_n_norm = std::sqrt(stateTransition(states, g_states, buffer));
+
+    iterations++;
+    if (max_n_norm <= m_epsilon)
+      break;
+
+    // Residual F_t = G(X_t) - X_t
+    for (Uint k = 0; k < dim; ++k)
+      residual[k] = g_states[k] - states[k];
+
+    // Updates the history with F_t - F_{t-1} and G(X_t) - G(X_{t-1})
+    if (iterations > 1 && depth > 0)
+    {
+      Real *df_col = delta_f.colptr(history_next);
+      Real *dg_col = delta_g.colptr(history_next);
+      for (Uint k = 0; k < dim; ++k)
+      {
+        df_col[k] = residual[k] - residual_prev[k];
+        dg_col[k] = g_states[k] - g_states_prev[k];
+      } // for k
+      history_next = (history_next + 1) % depth;
+      if (history_size < depth)
+        history_size++;
+    } // if
+    residual_prev = residual;
+    g_states_prev = g_states;
+
+    // Computes the coefficients gamma solving the normal equations
+    //    (dF' * dF + lambda * I) * gamma = dF' * F_t
+    bool picard_step = (history_size == 0);
+    Vector gamma;
+    if (!picard_step)
+    {
+      Matrix normal(history_size, history_size);
+      Vector rhs(history_size);
+      for (Uint a = 0; a < history_size; ++a)
+      {
+        const Real *df_a = delta_f.colptr(a);
+        rhs[a] = 0;
+        for (Uint k = 0; k < dim; ++k)
+          rhs[a] += df_a[k] * residual[k];
+        for (Uint b = 0; b <= a; ++b)
+        {
+          const Real *df_b = delta_f.colptr(b);
+          Real dot = 0;
+          for (Uint k = 0; k < dim; ++k)
+            dot += df_a[k] * df_b[k];
+          normal(a, b) = dot;
+          normal(b, a) = dot;
+        } // for b
+      } // for a
+
+      Real trace = 0;
+      for (Uint a = 0; a < history_size; ++a)
+        trace += normal(a, a);
+      for (Uint a = 0; a < history_size; ++a)
+        normal(a, a) += 1e-10 * trace / history_size;
+
+      picard_step = (trace == 0 || !arma::solve(gamma, normal, rhs));
+    } // if
+
+    // Computes the next iterate
+    if (picard_step)
+    {
+      states = g_states;
+      history_size = 0;
+      history_next = 0;
+    }
+    else
+    {
+      states = g_states;
+      for (Uint a = 0; a < history_size; ++a)
+      {
+        const Real *dg_a = delta_g.colptr(a);
+        for (Uint k = 0; k < dim; ++k)
+          states[k] -= gamma[a] * dg_a[k];
+      } // for a
+    } // if-else
+
+  } // while iterations
+
+  storeStateGraph(input_graph, g_states, buffer);
+
+  return;
+} // method andersonEncoding
+
+/**
+ * Method batchedEncoding
+ *
+ * Computes the encoding process of the input graph (see encoding) keeping the
+ * states of all the vertices as columns of a single N_r x V matrix, where V is
+ * the number of vertices. Let be U the (N_u + 1) x V matrix of the inputs
+ * (with the bias) and A the V x V adjacency matrix of the input graph (A(n, n')
+ * is the number of edges from n to n'), each iteration computes:
+ *    X_{t} = tanh(W_in * U + (W_hat * X_{t-1}) * trans(A))
+ * that is the same state transition function used by vertexEncoding, with
+ * one matrix-matrix product for W_hat and a sparse product for the neighbors
+ * sum. The input drive W_in * U is computed only once (see computeInputDrive).
+ *
+ * The number of iterations computed is stored in "iterations" and the
+ * resulting state graph in the buffer.
+ */
+template <typename Graph>
+void GraphReservoir<Graph>::batchedEncoding
+(
+    const Graph& input_graph,
+    const Graph* initial_graph,
+    EncodingBuffer& buffer,
+    Uint& iterations
+) const
+{
+  const Uint size = input_graph.getSize();
+
+  // Adjacency matrix and input drive W_in * U (they don't change during the
+  // iterations)
+  buildAdjacency(input_graph, buffer.m_adjacency);
+  computeInputDrive(input_graph, buffer.m_input_drive);
+
+  // Makes two state matrices (initialized with the initial states) and two
+  // pointers that will be swapped
+  initialStates(input_graph, initial_graph, buffer.m_states1);
+  buffer.m_states2.zeros(m_N_s, size);
+  Matrix *current = &buffer.m_states1;
+  Matrix *previous = &buffer.m_states2;
+
+  // Starts the iterative encoding process
+  iterations = 0;
+  while (iterations < m_max_iterations)
+  {
+    // The current state matrix becomes the state matrix at the previous step.
+    std::swap(current, previous);
+
+    // Computes all the states of the current step:
+    //    X_{t} = tanh(W_in * U + (W_hat * X_{t-1}) * trans(A))
+    // and max_{n} || x_{t}(n) - x_{t-1}(n) || in order to check the fixed
+    // point reaching
+    Real max_n_norm = std::sqrt(stateTransition(*previous, *current, buffer));
+
+    // Iterates until the fixed point is reached (approssimated by the
+    // threshold epsilon)
+    iterations++;
+    if (max_n_norm <= m_epsilon)
+      break;
+
+  } // while iterations
+
+  storeStateGraph(input_graph, *current, buffer);
+
+  return;
+} // method batchedEncoding
+
+/**
+ * Method buildAdjacency
+ *
+ * Builds the V x V adjacency matrix A of the input graph: the row n contains
+ * the neighbors of the vertex n (A(n, n') is the number of edges from n to
+ * n').
+ */
+template <typename Graph>
+void GraphReservoir<Graph>::buildAdjacency
+(
+    const Graph& input_graph,
+    SparseMatrix& adjacency
+) const
+{
+  const Uint size = input_graph.getSize();
+
+  Uint no_edges = 0;
+  for (Uint n = 0; n < size; ++n)
+    no_edges += input_graph.getNeighborsSize(n);
+
+  adjacency.clear(size);
+  adjacency.reserve(size, no_edges);
+  for (Uint n = 0; n < size; ++n)
+  {
+    adjacency.appendRow();
+    for (Uint i = 0; i < input_graph.getNeighborsSize(n); ++i)
+      adjacency.append(input_graph.getNeighbors(n)[i], 1.0);
+  } // for n
+
+  return;
+} // method buildAdjacency
+
+/**
+ * Method computeEncoding
+ *
+ * Computes the encoding process of the input graph (see the reentrant method
+ * encoding) starting from the states of "initial_graph", or from the null
+ * states if it is NULL.
+ */
+template <typename Graph>
+bool GraphReservoir<Graph>::computeEncoding
+(
+    const Graph& input_graph,
+    const Graph* initial_graph,
+    EncodingBuffer& buffer,
+    Uint& iterations
+) const
+{
+  // Checks the initialization
+  if (!isInitialized())
+    throw moka::GenericException(
+        "GraphReservoir::encoding: the object is not initialized");
+
+  // Checks the input graph
+  if (input_graph.getElementsSize() != m_N_u)
+    throw moka::GenericException(
+        "GraphReservoir::encoding: wrong elements size in the input graph");
+
+  // Checks the initial graph
+  if (initial_graph &&
+      (initial_graph->getSize() != input_graph.getSize() ||
+       initial_graph->getElementsSize() != m_N_s))
+    throw moka::GenericException(
+        "GraphReservoir::encoding: the initial graph doesn't match the input "
+        "graph or the reservoir size");
+
+  // Computes the fixed point
+  switch (m_solver)
+  {
+  case anderson_solver:
+    andersonEncoding(input_graph, initial_graph, buffer, iterations);
+    break;
+  case gauss_seidel_solver:
+    gaussSeidelEncoding(input_graph, initial_graph, buffer, iterations);
+    break;
+  case picard_solver: default:
+    if (m_encoding_mode != active_set_encoding &&
+        m_precision == mut::Math::single_precision)
+      singleBatchedEncoding(input_graph, initial_graph, buffer, iterations);
+    else if (m_encoding_mode == batched_encoding)
+      batchedEncoding(input_graph, initial_graph, buffer, iterations);
+    else if (m_encoding_mode == active_set_encoding)
+      activeSetEncoding(input_graph, initial_graph, buffer, iterations);
+    else if (m_encoding_mode != fixed_size_encoding || m_is_what_sparse ||
+             !fixedSizeEncoding(input_graph, initial_graph, buffer, iterations))
+      vertexEncoding(input_graph, initial_graph, buffer, iterations);
+    break;
+  } // switch
+
+  return iterations < m_max_iterations;
+} // method computeEncoding
+
+/**
+ * Method computeInputDrive
+ *
+ * Computes the input drive of all the vertices of the input graph, that is
+ * the N_r x V matrix W_in * U where U is the (N_u + 1) x V matrix that
+ * contains as column n the input u(n) of the vertex n, with the fixed input
+ * for the bias on the first row. The column n of the result is then the term
+ * W_in * [1; u(n)] of the state transition function of the vertex n, that
+ * doesn't change during the encoding process.
+ */
+template <typename Graph>
+void GraphReservoir<Graph>::computeInputDrive
+(
+    const Graph& input_graph,
+    Matrix& input_drive
+) const
+{
+  const typename Graph::View graph(input_graph);
+  const Uint size = graph.getSize();
+
+  Matrix inputs(m_N_u + 1, size);
+  for (Uint n = 0; n < size; ++n)
+  {
+    const Vector& u = graph.getVertexElement(n);
+    inputs(0, n) = 1;
+    for (Uint j = 0; j < m_N_u; ++j)
+      inputs(j + 1, n) = u[j];
+  } // for n
+
+  input_drive = m_W_in * inputs;
+
+  return;
+} // method computeInputDrive
+
+/**
+ * Method fixedSizeEncoding
+ *
+ * Computes the vertex encoding through fixedVertexEncoding if the reservoir
+ * size is one of the sizes for which the kernel is specialized (used by the
+ * fixed_size_encoding mode). Returns false (without computing anything)
+ * otherwise, or if the input graph is empty.
+ */
+template <typename Graph>
+bool GraphReservoir<Graph>::fixedSizeEncoding
+(
+    const Graph& input_graph,
+    const Graph* initial_graph,
+    EncodingBuffer& buffer,
+    Uint& iterations
+) const
+{
+  if (input_graph.getSize() == 0)
+    return false;
+
+  switch (m_N_s)
+  {
+  case 10:
+    fixedVertexEncoding<10>(input_graph, initial_graph, buffer, iterations);
+    break;
+  case 16:
+    fixedVertexEncoding<16>(input_graph, initial_graph, buffer, iterations);
+    break;
+  case 20:
+    fixedVertexEncoding<20>(input_graph, initial_graph, buffer, iterations);
+    break;
+  case 25:
+    fixedVertexEncoding<25>(input_graph, initial_graph, buffer, iterations);
+    break;
+  case 30:
+    fixedVertexEncoding<30>(input_graph, initial_graph, buffer, iterations);
+    break;
+  case 32:
+    fixedVertexEncoding<32>(input_graph, initial_graph, buffer, iterations);
+    break;
+  case 40:
+    fixedVertexEncoding<40>(input_graph, initial_graph, buffer, iterations);
+    break;
+  case 48:
+    fixedVertexEncoding<48>(input_graph, initial_graph, buffer, iterations);
+    break;
+  case 50:
+    fixedVertexEncoding<50>(input_graph, initial_graph, buffer, iterations);
+    break;
+  case 64:
+    fixedVertexEncoding<64>(input_graph, initial_graph, buffer, iterations);
+    break;
+  default:
+    return false;
+  } // switch
+
+  return true;
+} // method fixedSizeEncoding
+
+/**
+ * Method fixedVertexEncoding
+ *
+ * Computes the encoding process of the input graph as vertexEncoding, with
+ * the reservoir size N_r = N known at compile time. The states of all the
+ * vertices and their input drives are stored in the (reused) arrays of the
+ * buffer, N consecutive values for each vertex, and for each vertex n the
+ * state transition function is computed as
+ *    x_{t}(n) = tanh(W_in * u(n) + W_hat * Sum_{n'}(x_{t-1}(n')))
+ * (one product with W_hat for each vertex instead of one for each neighbor)
+ * using fixed size arrays on the stack for the neighbors sum and the product.
+ * The change of each state is computed with its new value, in order to check
+ * the fixed point reaching.
+ *
+ * The number of iterations computed is stored in "iterations" and the
+ * resulting state graph in the buffer.
+ */
+template <typename Graph>
+template <Global::Uint N>
+void GraphReservoir<Graph>::fixedVertexEncoding
+(
+    const Graph& input_graph,
+    const Graph* initial_graph,
+    EncodingBuffer& buffer,
+    Uint& iterations
+) const
+{
+  typedef typename Graph::View::NeighborIterator NeighborIterator;
+  const typename Graph::View graph(input_graph);
+  const Uint size = graph.getSize();
+  const Real *what = m_What.memptr();
+
+  // Input drive W_in * [1; u(n)] of each vertex n (computed only once since
+  // it doesn't change during the iterations)
+  std::vector<Real>& input_drive = buffer.m_fixed_input_drive;
+  input_drive.resize(size * N);
+  for (Uint n = 0; n < size; ++n)
+  {
+    const Vector& u = graph.getVertexElement(n);
+    Real *drive = &input_drive[n * N];
+    const Real *w_col = m_W_in.colptr(0);
+    for (Uint k = 0; k < N; ++k)
+      drive[k] = w_col[k];
+    for (Uint j = 0; j < m_N_u; ++j)
+    {
+      w_col = m_W_in.colptr(j + 1);
+      const Real u_j = u[j];
+      for (Uint k = 0; k < N; ++k)
+        drive[k] += w_col[k] * u_j;
+    } // for j
+  } // for n
+
+  // Makes two state arrays (initialized with the initial states, or with
+  // null states) and two pointers that will be swapped
+  buffer.m_fixed_states1.assign(size * N, 0.0);
+  buffer.m_fixed_states2.resize(size * N);
+  if (initial_graph)
+    for (Uint n = 0; n < size; ++n)
+      std::copy(
+          initial_graph->getVertexElement(n).begin(),
+          initial_graph->getVertexElement(n).end(),
+          buffer.m_fixed_states1.begin() + n * N);
+  Real *current = &buffer.m_fixed_states1[0];
+  Real *previous = &buffer.m_fixed_states2[0];
+
+  // Starts the iterative encoding process
+  iterations = 0;
+  while (iterations < m_max_iterations)
+  {
+    // The current states become the states at the previous step.
+    std::swap(current, previous);
+
+    Real max_n_norm2 = 0;
+    for (Uint n = 0; n < size; ++n)
+    {
+      // Sum_{n'}(x_{t-1}(n')) over the neighbors n' of the vertex n
+      Real neighbors_sum[N];
+      std::fill(neighbors_sum, neighbors_sum + N, Real(0));
+      NeighborIterator neigh = graph.getNeighborsBegin(n);
+      const NeighborIterator neigh_end = graph.getNeighborsEnd(n);
+      for (/* nop */; neigh != neigh_end; ++neigh)
+      {
+        const Real *x = previous + (*neigh) * N;
+        for (Uint k = 0; k < N; ++k)
+          neighbors_sum[k] += x[k];
+      } // for neigh
+
+      // W_hat * Sum_{n'}(x_{t-1}(n')), by columns of W_hat
+      Real vsum[N];
+      std::fill(vsum, vsum + N, Real(0));
+      for (Uint c = 0; c < N; ++c)
+      {
+        const Real *w_col = what + c * N;
+        const Real s_c = neighbors_sum[c];
+        for (Uint k = 0; k < N; ++k)
+          vsum[k] += w_col[k] * s_c;
+      } // for c
+
+      // Computes the n-th state and its change
+      Real *x_new = current + n * N;
+      const Real *x_old = previous + n * N;
+      activation(&input_drive[n * N], vsum, x_new, N);
+      const Real n_norm2 = squaredChange(x_new, x_old, N);
+      if (n_norm2 > max_n_norm2)
+        max_n_norm2 = n_norm2;
+    } // for n
+
+    // Iterates until the fixed point is reached (approssimated by the
+    // threshold epsilon)
+    iterations++;
+    if (std::sqrt(max_n_norm2) <= m_epsilon)
+      break;
+
+  } // while iterations
+
+  // Resulting state graph
+  Vector& state = buffer.m_vsum;
+  state.set_size(N);
+  buffer.m_graph1.buildFrom(input_graph, state);
+  for (Uint n = 0; n < size; ++n)
+  {
+    std::copy(current + n * N, current + (n + 1) * N, state.begin());
+    buffer.m_graph1.setVertexElement(n, state);
+  } // for n
+  buffer.m_current = 0;
+
+  return;
+} // method fixedVertexEncoding
+
+/**
+ * Method gaussSeidelEncoding
+ *
+ * Computes the encoding process of the input graph (see encoding) through
+ * Gauss-Seidel sweeps: the vertices are updated in order and in place, so the
+ * state of a vertex is computed using the states of its neighbors already
+ * updated in the current sweep:
+ *    x(n) = tanh(W_in * u(n) + W_hat * Sum_{n'}(x(n')))
+ * The process stops when the maximum change of a vertex state in a sweep is
+ * not greater than epsilon, that is when
+ *    max_{n} || x_{t}(n) - x_{t-1}(n) || <= epsilon
+ * as for the Picard iteration. The number of sweeps is the number of
+ * iterations.
+ *
+ * The number of iterations computed is stored in "iterations" and the
+ * resulting state graph in the buffer.
+ */
+template <typename Graph>
+void GraphReservoir<Graph>::gaussSeidelEncoding
+(
+    const Graph& input_graph,
+    const Graph* initial_graph,
+    EncodingBuffer& buffer,
+    Uint& iterations
+) const
+{
+  const typename Graph::View graph(input_graph);
+  const Uint size = graph.getSize();
+
+  // Input drive W_in * U (it doesn't change during the iterations)
+  computeInputDrive(input_graph, buffer.m_input_drive);
+  const Matrix& input_drive = buffer.m_input_drive;
+
+  // The states of all the vertices (updated in place)
+  Matrix& states = buffer.m_states1;
+  initialStates(input_graph, initial_graph, states);
+
+  Vector& neighbors_sum = buffer.m_residual;
+  Vector& vsum = buffer.m_vsum;
+  neighbors_sum.set_size(m_N_s);
+  vsum.set_size(m_N_s);
+
+  // Starts the iterative encoding process
+  iterations = 0;
+  while (iterations < m_max_iterations)
+  {
+    Real max_n_norm = 0;
+    for (Uint n = 0; n < size; ++n)
+    {
+      // Sum of the current states of the neighbors
+      neighbors_sum.zeros();
+      for (Uint i = 0; i < graph.getNeighborsSize(n); ++i)
+      {
+        const Real *x_col = states.colptr(graph.getNeighborIndex(n, i));
+        for (Uint k = 0; k < m_N_s; ++k)
+          neighbors_sum[k] += x_col[k];
+      } // for i
+
+      if (m_is_what_sparse)
+        m_What_sparse.multiply(neighbors_sum, vsum);
+      else
+        vsum = m_What * neighbors_sum;
+
+      // Updates the n-th state in place (the new state is computed in vsum)
+      activation(input_drive.colptr(n), vsum.memptr(), vsum.memptr(), m_N_s);
+      Real *x_col = states.colptr(n);
+      const Real n_norm2 = squaredChange(vsum.memptr(), x_col, m_N_s);
+      std::copy(vsum.begin(), vsum.end(), x_col);
+      if (n_norm2 > max_n_norm)
+        max_n_norm = n_norm2;
+    } // for n
+
+    // Iterates until the fixed point is reached (approssimated by the
+    // threshold epsilon)
+    iterations++;
+    if (std::sqrt(max_n_norm) <= m_epsilon)
+      break;
+
+  } // while iterations
+
+  storeStateGraph(input_graph, states, buffer);
+
+  return;
+} // method gaussSeidelEncoding
+
+/**
+ * Method initialStates
+ *
+ * Initializes the N_r x V matrix of the states (a column for each vertex of
+ * the input graph) with the states of the initial graph, or with null states
+ * if the initial graph is NULL.
+ */
+template <typename Graph>
+void GraphReservoir<Graph>::initialStates
+(
+    const Graph& input_graph,
+    const Graph* initial_graph,
+    Matrix& states
+) const
+{
+  states.zeros(m_N_s, input_graph.getSize());
+  if (initial_graph)
+    for (Uint n = 0; n < input_graph.getSize(); ++n)
+      std::copy(
+          initial_graph->getVertexElement(n).begin(),
+          initial_graph->getVertexElement(n).end(),
+          states.begin_col(n));
+  return;
+} // method initialStates
+
 /**
  * Method clearObject
  *
@@ -332,15 +1337,28 @@ void GraphReservoir<T>::clearObject()
   m_What.clear();
   m_N_u = 0;
   m_N_r = 0;
+  m_ensemble_size = 1;
+  m_N_s = 0;
   m_epsilon = 0.01;
   m_sigma = 0.9;
   m_input_scaling = 0.1;
   m_connectivity = 1.0;
+  m_norm_tolerance = 0.0;
+  m_what_norm = 0.0;
+  m_sparse_threshold = 0.3;
+  m_is_what_sparse = false;
+  m_What_sparse.clear();
+  m_precision = mut::Math::double_precision;
+  m_What_single.clear();
   m_max_degree = 0;
   m_max_iterations = 10000;
   m_iterations = 0;
+  m_encoding_mode = vertex_encoding;
+  m_solver = picard_solver;
+  m_anderson_depth = 5;
+  m_fast_tanh = false;
   m_rand.setRandSeed();
-  m_state_graph.clear();
+  m_buffer.clear();
   return;
 } // method clearObject
 
@@ -354,9 +1372,363 @@ template <typename T>
 void GraphReservoir<T>::setInitialized(bool initialized)
 {
   m_is_initialized = initialized;
+  if (!m_is_initialized)
+  {
+    m_is_what_sparse = false;
+    m_What_sparse.clear();
+    m_What_single.clear();
+  }
   return;
 } // method setInitialized
 
+/**
+ * Method singleBatchedEncoding
+ *
+ * Computes the encoding process of the input graph (see encoding) as the
+ * method batchedEncoding, but in single precision: the input drive and the
+ * initial states are computed in double precision and then converted, the
+ * iterations use the single precision copy of W_hat (or its sparse version)
+ * and the resulting states are converted back to double precision.
+ *
+ * The number of iterations computed is stored in "iterations" and the
+ * resulting state graph in the buffer.
+ */
+template <typename Graph>
+void GraphReservoir<Graph>::singleBatchedEncoding
+(
+    const Graph& input_graph,
+    const Graph* initial_graph,
+    EncodingBuffer& buffer,
+    Uint& iterations
+) const
+{
+  const Uint size = input_graph.getSize();
+
+  // Adjacency matrix, input drive W_in * U and initial states
+  buildAdjacency(input_graph, buffer.m_adjacency);
+  computeInputDrive(input_graph, buffer.m_input_drive);
+  initialStates(input_graph, initial_graph, buffer.m_states1);
+
+  // Single precision copies (two state matrices and two pointers that will be
+  // swapped)
+  SingleMatrix& input_drive = buffer.m_single_input_drive;
+  input_drive.set_size(m_N_s, size);
+  std::copy(
+      buffer.m_input_drive.begin(),
+      buffer.m_input_drive.end(),
+      input_drive.begin());
+  buffer.m_single_states1.set_size(m_N_s, size);
+  std::copy(
+      buffer.m_states1.begin(),
+      buffer.m_states1.end(),
+      buffer.m_single_states1.begin());
+  buffer.m_single_states2.zeros(m_N_s, size);
+  SingleMatrix *current = &buffer.m_single_states1;
+  SingleMatrix *previous = &buffer.m_single_states2;
+  SingleMatrix& what_states = buffer.m_single_what_states;
+  SingleMatrix& neighbors_sum = buffer.m_single_neighbors_sum;
+
+  // Starts the iterative encoding process
+  iterations = 0;
+  while (iterations < m_max_iterations)
+  {
+    // The current state matrix becomes the state matrix at the previous step.
+    std::swap(current, previous);
+
+    // Computes all the states of the current step:
+    //    X_{t} = tanh(W_in * U + (W_hat * X_{t-1}) * trans(A))
+    if (m_is_what_sparse)
+      m_What_sparse.multiply(*previous, what_states);
+    else
+      what_states = m_What_single * (*previous);
+    buffer.m_adjacency.multiplyTransposed(what_states, neighbors_sum);
+
+    // ... computing also max_{n} || x_{t}(n) - x_{t-1}(n) || in order to
+    // check the fixed point reaching
+    SingleReal max_n_norm2 = 0;
+    for (Uint n = 0; n < size; ++n)
+    {
+      const SingleReal *drive_col = input_drive.colptr(n);
+      const SingleReal *sum_col = neighbors_sum.colptr(n);
+      const SingleReal *prev_col = previous->colptr(n);
+      SingleReal *curr_col = current->colptr(n);
+      SingleReal n_norm2 = 0;
+      for (Uint k = 0; k < m_N_s; ++k)
+      {
+        curr_col[k] = std::tanh(drive_col[k] + sum_col[k]);
+        n_norm2 += (curr_col[k] - prev_col[k]) * (curr_col[k] - prev_col[k]);
+      } // for k
+      if (n_norm2 > max_n_norm2)
+        max_n_norm2 = n_norm2;
+    } // for n
+
+    // Iterates until the fixed point is reached (approssimated by the
+    // threshold epsilon)
+    iterations++;
+    if (std::sqrt(max_n_norm2) <= m_epsilon)
+      break;
+
+  } // while iterations
+
+  // Back to double precision
+  buffer.m_states1.set_size(m_N_s, size);
+  std::copy(current->begin(), current->end(), buffer.m_states1.begin());
+  storeStateGraph(input_graph, buffer.m_states1, buffer);
+
+  return;
+} // method singleBatchedEncoding
+
+/**
+ * Method squaredChange
+ *
+ * Returns the squared 2-norm of the change x - y of a state of the given
+ * size, adding up the squares as arma::norm(x - y, 2) does (in two partial
+ * sums, of the even and of the odd elements): its square root is then the
+ * same of arma::norm bit for bit, and the fixed point is reached at the
+ * same iteration as when the changes were computed through arma::norm.
+ */
+template <typename Graph>
+inline
+typename GraphReservoir<Graph>::Real GraphReservoir<Graph>::squaredChange
+(
+    const Real *x,
+    const Real *y,
+    Uint size
+)
+{
+  Real acc1 = 0, acc2 = 0;
+
+  Uint i = 0, j = 1;
+  for (; j < size; i += 2, j += 2)
+  {
+    const Real d_i = x[i] - y[i];
+    const Real d_j = x[j] - y[j];
+    acc1 += d_i * d_i;
+    acc2 += d_j * d_j;
+  } // for i, j
+  if (i < size)
+  {
+    const Real d_i = x[i] - y[i];
+    acc1 += d_i * d_i;
+  }
+
+  return acc1 + acc2;
+} // method squaredChange
+
+/**
+ * Method stateTransition
+ *
+ * Applies the state transition function to all the vertices: given the
+ * N_r x V matrix of the states X (a column for each vertex) computes
+ *    next_states = tanh(W_in * U + (W_hat * X) * trans(A))
+ * The input drive W_in * U and the adjacency matrix A must be already
+ * computed in the buffer (see computeInputDrive and buildAdjacency).
+ *
+ * Returns the max squared change of a vertex state:
+ *    max_{n} || next_states(:, n) - X(:, n) ||^2
+ * computed while each new column is computed (see squaredChange, its square
+ * root is the same of arma::norm).
+ */
+template <typename Graph>
+typename GraphReservoir<Graph>::Real GraphReservoir<Graph>::stateTransition
+(
+    const Matrix& states,
+    Matrix& next_states,
+    EncodingBuffer& buffer
+) const
+{
+  if (m_is_what_sparse)
+    m_What_sparse.multiply(states, buffer.m_what_states);
+  else
+    buffer.m_what_states = m_What * states;
+  buffer.m_adjacency.multiplyTransposed(
+      buffer.m_what_states, buffer.m_neighbors_sum);
+
+  next_states.set_size(m_N_s, states.n_cols);
+  Real max_n_norm2 = 0;
+  for (Uint n = 0; n < states.n_cols; ++n)
+  {
+    const Real *x_col = states.colptr(n);
+    Real *next_col = next_states.colptr(n);
+    activation(
+        buffer.m_input_drive.colptr(n),
+        buffer.m_neighbors_sum.colptr(n),
+        next_col,
+        m_N_s);
+
+    const Real n_norm2 = squaredChange(next_col, x_col, m_N_s);
+    if (n_norm2 > max_n_norm2)
+      max_n_norm2 = n_norm2;
+  } // for n
+
+  return max_n_norm2;
+} // method stateTransition
+
+/**
+ * Method storeStateGraph
+ *
+ * Builds in the buffer the state graph with the same structure of the input
+ * graph, and the columns of the N_r x V matrix "states" as vertices elements.
+ */
+template <typename Graph>
+void GraphReservoir<Graph>::storeStateGraph
+(
+    const Graph& input_graph,
+    const Matrix& states,
+    EncodingBuffer& buffer
+) const
+{
+  buffer.m_graph1.buildFrom(input_graph, arma::zeros(m_N_s));
+  for (Uint n = 0; n < input_graph.getSize(); ++n)
+    buffer.m_graph1.setVertexElement(n, states.col(n));
+  buffer.m_current = 0;
+  return;
+} // method storeStateGraph
+
+/**
+ * Method updateSingleReservoirMatrix
+ *
+ * Builds the single precision copy of the reservoir matrix W_hat if the
+ * single precision is setted (and the sparse version of W_hat is not used),
+ * clears it otherwise.
+ */
+template <typename T>
+void GraphReservoir<T>::updateSingleReservoirMatrix()
+{
+  if (isInitialized() &&
+      m_precision == mut::Math::single_precision &&
+      !m_is_what_sparse)
+  {
+    m_What_single.set_size(m_What.n_rows, m_What.n_cols);
+    std::copy(m_What.begin(), m_What.end(), m_What_single.begin());
+  }
+  else
+    m_What_single.clear();
+
+  return;
+} // method updateSingleReservoirMatrix
+
+/**
+ * Method updateSparseReservoirMatrix
+ *
+ * Builds the sparse version of the reservoir matrix W_hat if its density is
+ * lower than the sparse threshold, clears it otherwise. With a connectivity
+ * c and K ensemble members each row of W_hat has about c * N_r non-zero
+ * elements over K * N_r, then the sparse products cost about c / K times the
+ * dense ones.
+ */
+template <typename T>
+void GraphReservoir<T>::updateSparseReservoirMatrix()
+{
+  m_is_what_sparse =
+      isInitialized() &&
+      m_connectivity / m_ensemble_size < m_sparse_threshold;
+
+  if (m_is_what_sparse)
+    m_What_sparse.buildFrom(m_What);
+  else
+    m_What_sparse.clear();
+
+  return;
+} // method updateSparseReservoirMatrix
+
+/**
+ * Method vertexEncoding
+ *
+ * Computes the encoding process of the input graph (see encoding) computing
+ * the state of each vertex separately, through the neighbors states of the
+ * previous step. The change of each state is computed together with the
+ * state, as in stateTransition (see squaredChange).
+ *
+ * The number of iterations computed is stored in "iterations" and the
+ * resulting state graph in the buffer.
+ */
+template <typename Graph>
+void GraphReservoir<Graph>::vertexEncoding
+(
+    const Graph& input_graph,
+    const Graph* initial_graph,
+    EncodingBuffer& buffer,
+    Uint& iterations
+) const
+{
+  // Builds two states graphs with the same structure of the input graph and
+  // elements of size Nr initialized as null vectors (vectors of all 0), or
+  // as the initial states if given.
+  buffer.m_graph1.buildFrom(input_graph, arma::zeros(m_N_s));
+  buffer.m_graph2.buildFrom(input_graph, arma::zeros(m_N_s));
+  if (initial_graph)
+    for (Uint n = 0; n < input_graph.getSize(); ++n)
+      buffer.m_graph1.setVertexElement(n, initial_graph->getVertexElement(n));
+
+  // Input drive W_in * [1; u(n)] of each vertex n (computed only once since
+  // it doesn't change during the iterations)
+  const Matrix& input_drive = buffer.m_input_drive;
+  computeInputDrive(input_graph, buffer.m_input_drive);
+
+  // Makes two pointers that will be swapped, along with the views on the two
+  // state graphs
+  Graph *current = &buffer.m_graph1;
+  Graph *previous = &buffer.m_graph2;
+  typename Graph::View current_view(*current);
+  typename Graph::View previous_view(*previous);
+  const Uint size = current_view.getSize();
+  Vector& vsum = buffer.m_vsum;
+  vsum.set_size(m_N_s);
+
+  // Starts the iterative encoding process
+  iterations = 0;
+  while (iterations < m_max_iterations)
+  {
+    // The current state graph becomes the state graph at the previous step.
+    std::swap(current, previous);
+    std::swap(current_view, previous_view);
+
+    // Computes the states of the current state graph according to the state
+    // transition function for each vertex n:
+    //    x_{t}(n) = tanh(W_in * u(n) + Sum_{n'}(What * x_{t-1}(n'))
+    // where n' are the neighbors of the vertex n (W_in * u(n) is the column n
+    // of the input drive), and max_{n} || x_{t}(n) - x_{t-1}(n) || in order
+    // to check the fixed point reaching
+    Real max_n_norm2 = 0;
+    for (Uint n = 0; n < size; ++n)
+    {
+      vsum.zeros();
+
+      // Note: also if the graph degree is greater than k (i.e. m_max_degree)
+      // the state is computed
+      for (Uint i = 0; i < previous_view.getNeighborsSize(n); ++i)
+      {
+        if (m_is_what_sparse)
+          m_What_sparse.multiplyAdd(previous_view.getNeighbor(n, i), vsum);
+        else
+          vsum += m_What * previous_view.getNeighbor(n, i);
+      } // for i
+
+      // Computes the n-th state (in vsum) and its change
+      activation(input_drive.colptr(n), vsum.memptr(), vsum.memptr(), m_N_s);
+      const Real n_norm2 = squaredChange(
+          vsum.memptr(), previous_view.getVertexElement(n).memptr(), m_N_s);
+      if (n_norm2 > max_n_norm2)
+        max_n_norm2 = n_norm2;
+      current->setVertexElement(n, vsum);
+
+    } // for n
+
+    // Iterates until the fixed point is reached (approssimated by the
+    // threshold epsilon)
+    iterations++;
+    if (std::sqrt(max_n_norm2) <= m_epsilon)
+      break;
+
+  } // while iterations
+
+  // The result graph is the current state graph (no copy is needed)
+  buffer.m_current = (current == &buffer.m_graph1) ? 0 : 1;
+
+  return;
+} // method vertexEncoding
+
 } // namespace ml
 } // namespace moka
 
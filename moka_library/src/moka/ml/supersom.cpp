@@ -1,5 +1,6 @@
 #include "supersom.h"
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <limits>
@@ -10,6 +11,7 @@
 #include <boost/lambda/lambda.hpp>
 #include <moka/exception.h>
 #include <moka/log.h>
+#include <moka/util/squareddistance.h>
 
 namespace moka {
 namespace ml {
@@ -18,6 +20,69 @@ namespace balg = ::boost::algorithm;
 namespace bll  = ::boost::lambda;
 namespace mut  = ::moka::util;
 
+namespace {
+
+//! Maximum number of elements of the products matrix of a block of data in
+//! the batch winner unit search (see SuperSOM::winnerUnits)
+const size_t max_products_size = 1 << 16;
+
+//! Stores in winners[first + j] the index of the column of the unit with the
+//! smallest norms[u] - 2 * products(u, j), for each column j of products
+//! (the first unit on ties, as in SuperSOM::winnerUnit)
+template <typename Type>
+void argminUnits(
+    const arma::Mat<Type>& products,
+    const arma::Col<Type>& norms,
+    size_t first,
+    std::vector<size_t>& winners)
+{
+  for (size_t j = 0; j < products.n_cols; ++j)
+  {
+    const Type *product = products.colptr(j);
+    size_t winner = 0;
+    Type dist_min = norms[0] - 2 * product[0];
+    for (size_t u = 1; u < products.n_rows; ++u)
+    {
+      const Type dist = norms[u] - 2 * product[u];
+      if (dist < dist_min)
+      {
+        dist_min = dist;
+        winner = u;
+      }
+    } // for u
+    winners[first + j] = winner;
+  } // for j
+}
+
+//! Stores in units[j] the index of the column of codebooks nearest to the
+//! column j of data, processing the columns in blocks through a matrix
+//! product with the codebooks (see SuperSOM::winnerUnits)
+template <typename Type>
+void batchArgminUnits(
+    const arma::Mat<Type>& codebooks,
+    const arma::Col<Type>& norms,
+    const arma::Mat<Type>& data,
+    std::vector<size_t>& units)
+{
+  const size_t block_size =
+      std::max<size_t>(1, max_products_size / codebooks.n_cols);
+
+  units.resize(data.n_cols);
+  for (size_t first = 0; first < data.n_cols; first += block_size)
+  {
+    const size_t n = std::min<size_t>(block_size, data.n_cols - first);
+    const arma::Mat<Type> block(
+        const_cast<Type*>(data.colptr(first)),
+        data.n_rows,
+        n,
+        false);
+    const arma::Mat<Type> products = arma::trans(codebooks) * block;
+    argminUnits(products, norms, first, units);
+  } // for first
+}
+
+} // namespace
+
 /**
  * Constructor
  */
@@ -68,15 +133,16 @@ SuperSOM::Real SuperSOM::activate
   if (!isInitialized())
     return 0.0;
 
+  if (data.n_elem != getCodebookSize())
+    throw moka::GenericException("SuperSOM::activate: wrong data size");
+
+  // (x / gamma)^2 from the squared distance (no square root needed)
   Real act_fun_res =
       1.0 /
       (
         1.0 +
-        std::pow
-        (
-          distance(data, m_map[unit.first][unit.second]) / m_act_fun_gamma,
-          2
-        )
+        squaredDistance(data, m_map[unit.first][unit.second]) /
+        (m_act_fun_gamma * m_act_fun_gamma)
       );
   return act_fun_res;
 } // method activate
@@ -163,6 +229,7 @@ void SuperSOM::init(const DataContainer& training_data)
 
   // Makes this object usable
   setInitialized(true);
+  updateCodebooksMatrix();
 
   return;
 } // method initMap
@@ -308,6 +375,13 @@ SuperSOM& SuperSOM::operator=(const SuperSOM& ssom)
 
   // SOM elements
   m_map = ssom.m_map;
+  m_precision = ssom.m_precision;
+  m_codebooks = ssom.m_codebooks;
+  m_codebooks_norms = ssom.m_codebooks_norms;
+  m_single_codebooks = ssom.m_single_codebooks;
+  m_single_codebooks_norms = ssom.m_single_codebooks_norms;
+  m_indexed_search = ssom.m_indexed_search;
+  m_codebooks_index = ssom.m_codebooks_index;
 
   // Training parameters
   m_nepochs_1 = ssom.m_nepochs_1;
@@ -323,6 +397,7 @@ SuperSOM& SuperSOM::operator=(const SuperSOM& ssom)
   m_sigma_fin_2 = ssom.m_sigma_fin_2;
   m_sigma_fin_3 = ssom.m_sigma_fin_3;
   m_alpha_decay_type = ssom.m_alpha_decay_type;
+  m_local_search_radius = ssom.m_local_search_radius;
 
   // Training support structures
   clearNeighborsMap();
@@ -351,12 +426,21 @@ SuperSOM& SuperSOM::operator=(const SuperSOM& ssom)
  * Read the SOM from an input stream, previously written using the method
  * write.
  *
+ * The precision (see setPrecision) is not written, then the precision setted
+ * before the reading is kept.
+ *
  * In case of errors an exception of type moka::GenericException will be
  * thrown and this object is left "clear" (as just created).
  */
 void SuperSOM::read(std::istream& is)
 {
+  Precision precision = m_precision;
+  bool indexed_search = m_indexed_search;
+  Uint local_search_radius = m_local_search_radius;
   clearObject();
+  m_precision = precision;
+  m_indexed_search = indexed_search;
+  m_local_search_radius = local_search_radius;
 
   try
   {
@@ -397,6 +481,8 @@ void SuperSOM::read(std::istream& is)
     Global::readLine(is, line);
     m_alpha_decay_type = strToDect(line);
 
+    updateCodebooksMatrix();
+
   } // try
   catch (std::exception& ex)
   {
@@ -485,11 +571,41 @@ void SuperSOM::setDefaultParameters(Uint training_set_size)
   m_sigma_3 = m_sigma_fin_2 / 2.0;
   m_sigma_fin_3 = 0.1;
 
+  // Winner unit always searched on the whole map
+  m_local_search_radius = 0;
+
   setInitialized(false);
 
   return;
 } // method setDefaultParameters
 
+/**
+ * Method setIndexedSearch
+ *
+ * Sets whether the winner unit search (see winnerUnit and winnerUnits) goes
+ * through the nearest neighbor index of the codebooks, building or discarding
+ * such index.
+ */
+void SuperSOM::setIndexedSearch(bool indexed_search)
+{
+  m_indexed_search = indexed_search;
+  updateCodebooksMatrix();
+  return;
+} // method setIndexedSearch
+
+/**
+ * Method setPrecision
+ *
+ * Sets the floating point precision of the winner unit search (see
+ * winnerUnit), building or discarding the single precision codebooks.
+ */
+void SuperSOM::setPrecision(Precision precision)
+{
+  m_precision = precision;
+  updateCodebooksMatrix();
+  return;
+} // method setPrecision
+
 /**
  * Method strToDect
  *
@@ -543,7 +659,9 @@ void SuperSOM::supervisedTraining
     return;
   }
 
-  // Build training support data structures
+  // Build training support data structures (the codebooks matrix is not used
+  // by the training, so it is cleared and built again at the end)
+  clearCodebooksMatrix();
   initNeighborsMap();
 
   // Unsupervised rough train
@@ -557,7 +675,8 @@ void SuperSOM::supervisedTraining
         m_alpha_1,
         m_alpha_decay_type,
         m_sigma_1,
-        m_sigma_fin_1
+        m_sigma_fin_1,
+        false
     );
   }
 
@@ -572,7 +691,8 @@ void SuperSOM::supervisedTraining
         m_alpha_2,
         m_alpha_decay_type,
         m_sigma_2,
-        m_sigma_fin_2
+        m_sigma_fin_2,
+        m_local_search_radius > 0
     );
   }
 
@@ -595,6 +715,9 @@ void SuperSOM::supervisedTraining
   // Delete data structures
   clearNeighborsMap();
 
+  // The codebooks are changed
+  updateCodebooksMatrix();
+
   return;
 } // method supervisedTraining
 
@@ -649,17 +772,17 @@ void SuperSOM::umatrix(UMatrix& umat) const
     {
       // Compute dx
       if (c < m_ncols - 1)
-        umat[2 * r][2 * c + 1] = arma::norm(m_map[r][c] - m_map[r][c + 1], 2);
+        umat[2 * r][2 * c + 1] = distance(m_map[r][c], m_map[r][c + 1]);
 
       // Compute dy
       if (r < m_nrows - 1)
       {
         if (r % 2 != 0) // odd row (right shifted)
           umat[2 * r + 1][2 * c] =
-              arma::norm(m_map[r][c] - m_map[r + 1][c], 2);
+              distance(m_map[r][c], m_map[r + 1][c]);
         else if (c > 0) // even row, but not in the first column
           umat[2 * r + 1][2 * c - 1] =
-              arma::norm(m_map[r][c] - m_map[r + 1][c - 1], 2);
+              distance(m_map[r][c], m_map[r + 1][c - 1]);
       } // if
 
       // Compute dz
@@ -667,10 +790,10 @@ void SuperSOM::umatrix(UMatrix& umat) const
       {
         if (r % 2 == 0) // even row
           umat[2 * r + 1][2 * c] =
-              arma::norm(m_map[r][c] - m_map[r + 1][c], 2);
+              distance(m_map[r][c], m_map[r + 1][c]);
         else if (c < m_ncols - 1) // odd row (right shifted), not last column
           umat[2 * r + 1][2 * c + 1] =
-              arma::norm(m_map[r][c] - m_map[r + 1][c + 1], 2);
+              distance(m_map[r][c], m_map[r + 1][c + 1]);
       } // if
 
     } // for (r,c)
@@ -869,7 +992,9 @@ void SuperSOM::unsupervisedTraining(const DataContainer& training_data)
     return;
   }
 
-  // Build training support data structures
+  // Build training support data structures (the codebooks matrix is not used
+  // by the training, so it is cleared and built again at the end)
+  clearCodebooksMatrix();
   initNeighborsMap();
 
   // Rough train
@@ -883,7 +1008,8 @@ void SuperSOM::unsupervisedTraining(const DataContainer& training_data)
         m_alpha_1,
         m_alpha_decay_type,
         m_sigma_1,
-        m_sigma_fin_1
+        m_sigma_fin_1,
+        false
     );
   }
 
@@ -898,7 +1024,8 @@ void SuperSOM::unsupervisedTraining(const DataContainer& training_data)
         m_alpha_2,
         m_alpha_decay_type,
         m_sigma_2,
-        m_sigma_fin_2
+        m_sigma_fin_2,
+        m_local_search_radius > 0
     );
   }
 
@@ -913,13 +1040,17 @@ void SuperSOM::unsupervisedTraining(const DataContainer& training_data)
         m_alpha_3,
         m_alpha_decay_type,
         m_sigma_3,
-        m_sigma_fin_3
+        m_sigma_fin_3,
+        m_local_search_radius > 0
     );
   }
 
   // Delete data structures
   clearNeighborsMap();
 
+  // The codebooks are changed
+  updateCodebooksMatrix();
+
   return;
 } // method unsupervisedTraining
 
@@ -940,30 +1071,53 @@ SuperSOM::UnitIndex SuperSOM::winnerUnit(const Data& data) const
     throw moka::GenericException(
         "SuperSOM::winnerUnit: the map should be initialized");
 
+  if (data.n_elem != getCodebookSize())
+    throw moka::GenericException(
+        "SuperSOM::winnerUnit: wrong data size");
+
   UnitIndex winner_unit;
   winner_unit.first = 0;
   winner_unit.second = 0;
 
-  Real dist_min = distance(data, m_map[0][0]);
+  // Search through the nearest neighbor index if available
+  if (!m_codebooks_index.isEmpty())
+  {
+    const Uint u = m_codebooks_index.nearest(data.memptr());
+    winner_unit.first = u / m_ncols;
+    winner_unit.second = u % m_ncols;
+    return winner_unit;
+  } // if
 
-  // Get the winner unit
-  for (size_t r = 0; r < m_nrows; ++r)
+  // The squared distances are compared, and the computation of each one is
+  // abandoned as soon as it exceeds the smallest distance found so far
+
+  // Single precision search if the single precision codebooks are available
+  if (!m_single_codebooks.is_empty())
   {
-    for (size_t c = 0; c < m_ncols; ++c)
+    const Uint data_size = m_single_codebooks.n_rows;
+
+    // The data are converted while computing each distance
+    SingleReal dist_min = std::numeric_limits<SingleReal>::max();
+    for (Uint u = 0; u < m_single_codebooks.n_cols; ++u)
     {
-      Real dist = distance(data, m_map[r][c]);
+      SingleReal dist = mut::SquaredDistance::compute(
+          data.memptr(),
+          m_single_codebooks.colptr(u),
+          data_size,
+          dist_min);
 
       if (dist < dist_min)
       {
         dist_min = dist;
-        winner_unit.first = r;
-        winner_unit.second = c;
+        winner_unit.first = u / m_ncols;
+        winner_unit.second = u % m_ncols;
       } // if
+    } // for u
 
-    } // for c
-  } // for r
+    return winner_unit;
+  } // if
 
-  return winner_unit;
+  return mapWinnerUnit(data);
 } // method winnerUnit
 
 /**
@@ -987,10 +1141,27 @@ void SuperSOM::winnerUnits
     throw moka::GenericException(
         "SuperSOM::winnerUnits: the map should be initialized");
 
+  if (data.n_elem != getCodebookSize())
+    throw moka::GenericException(
+        "SuperSOM::winnerUnits: wrong data size");
+
   // Clear final vector
   winners.clear();
   winners.resize(n);
 
+  // Search through the nearest neighbor index if available
+  if (!m_codebooks_index.isEmpty())
+  {
+    std::vector<Uint> units;
+    m_codebooks_index.nearest(data.memptr(), n, units);
+    for (size_t i = 0; i < units.size(); ++i)
+    {
+      winners[i].first = units[i] / m_ncols;
+      winners[i].second = units[i] % m_ncols;
+    }
+    return;
+  } // if
+
   // Some support structures
   std::vector< std::pair<UnitIndex, Real> > closest_unit(n);
   Real last_dist = std::numeric_limits<Real>::max();
@@ -1009,7 +1180,8 @@ void SuperSOM::winnerUnits
   for (unit.first = 0; unit.first < m_nrows; ++unit.first)
     for (unit.second = 0; unit.second < m_ncols; ++unit.second)
     {
-      Real dist = distance(data, getCodebook(unit));
+      // Squared distance, abandoned above the n-th smallest one
+      Real dist = squaredDistance(data, getCodebook(unit), last_dist);
 
       if (dist < last_dist)
       {
@@ -1047,6 +1219,117 @@ void SuperSOM::winnerUnits
   return;
 } // method winnerUnits
 
+/**
+ * Method winnerUnits
+ *
+ * Computes and fill the vector WINNERS with the indeces of the winner unit of
+ * each column of DATA (winners[j] is the winner unit on the column j), that
+ * are the ones computed by the method winnerUnit on each column (but on ties
+ * within the rounding errors).
+ *
+ * The columns of DATA are processed in blocks: the squared distances between
+ * the columns of a block and all the codebooks are computed at once through a
+ * single matrix product with the codebooks matrix, as
+ *    |x - c|^2 = |x|^2 - 2 c'x + |c|^2
+ * where the term |x|^2 is omitted (it doesn't change the winner). If the
+ * codebooks matrix is not available (during the training), or with the
+ * indexed search, the winner unit of each column is computed through the
+ * method winnerUnit.
+ *
+ * The map should first initialized (see isInitialized) otherwise an error
+ * occurs and an exception of type moka::GenericException will be throw.
+ */
+void SuperSOM::winnerUnits
+(
+    const Matrix& data,
+    std::vector<UnitIndex>& winners
+) const
+{
+  if (!isInitialized())
+    throw moka::GenericException(
+        "SuperSOM::winnerUnits: the map should be initialized");
+
+  winners.resize(data.n_cols);
+
+  if (m_codebooks.is_empty() || !m_codebooks_index.isEmpty())
+  {
+    for (Uint j = 0; j < data.n_cols; ++j)
+    {
+      const Data column(const_cast<Real*>(data.colptr(j)), data.n_rows, false);
+      winners[j] = winnerUnit(column);
+    }
+    return;
+  } // if
+
+  if (data.n_rows != m_codebooks.n_rows)
+    throw moka::GenericException(
+        "SuperSOM::winnerUnits: wrong data size");
+
+  std::vector<size_t> units;
+  if (m_single_codebooks.is_empty())
+    batchArgminUnits(m_codebooks, m_codebooks_norms, data, units);
+  else
+  {
+    SingleMatrix single_data(data.n_rows, data.n_cols);
+    std::copy(data.begin(), data.end(), single_data.begin());
+    batchArgminUnits(
+        m_single_codebooks, m_single_codebooks_norms, single_data, units);
+  } // if-else
+
+  for (size_t j = 0; j < data.n_cols; ++j)
+  {
+    winners[j].first = units[j] / m_ncols;
+    winners[j].second = units[j] % m_ncols;
+  }
+
+  return;
+} // method winnerUnits
+
+/**
+ * Method winnerUnits
+ *
+ * As the method above, but on data already in single precision (e.g. states
+ * gathered directly in a single precision matrix): with the single precision
+ * search (see setPrecision) the columns of DATA are compared with the single
+ * precision codebooks as they are, without any copy. Otherwise DATA is
+ * converted to double precision and searched as above.
+ */
+void SuperSOM::winnerUnits
+(
+    const SingleMatrix& data,
+    std::vector<UnitIndex>& winners
+) const
+{
+  if (!isInitialized())
+    throw moka::GenericException(
+        "SuperSOM::winnerUnits: the map should be initialized");
+
+  if (m_single_codebooks.is_empty())
+  {
+    Matrix double_data(data.n_rows, data.n_cols);
+    std::copy(data.begin(), data.end(), double_data.begin());
+    winnerUnits(double_data, winners);
+    return;
+  } // if
+
+  if (data.n_rows != m_single_codebooks.n_rows)
+    throw moka::GenericException(
+        "SuperSOM::winnerUnits: wrong data size");
+
+  std::vector<size_t> units;
+  batchArgminUnits(
+      m_single_codebooks, m_single_codebooks_norms, data, units);
+
+  winners.resize(data.n_cols);
+  for (size_t j = 0; j < data.n_cols; ++j)
+  {
+    winners[j].first = units[j] / m_ncols;
+    winners[j].second = units[j] % m_ncols;
+  }
+
+  return;
+} // method winnerUnits
+
 ///**
 // * Method write
 // *
@@ -1172,6 +1455,22 @@ SuperSOM::Real SuperSOM::alphaDecay
   return alpha;
 } // method alphaDecay
 
+/**
+ * Method clearCodebooksMatrix
+ *
+ * Clears the matrix of the codebooks, its single precision copy and the
+ * nearest neighbor index (see updateCodebooksMatrix).
+ */
+void SuperSOM::clearCodebooksMatrix()
+{
+  m_codebooks.clear();
+  m_codebooks_norms.clear();
+  m_single_codebooks.clear();
+  m_single_codebooks_norms.clear();
+  m_codebooks_index.clear();
+  return;
+} // method clearCodebooksMatrix
+
 /**
  * Method clearNeighborsMap
  *
@@ -1211,6 +1510,9 @@ void SuperSOM::clearObject()
 
   // SOM elements
   m_map.clear();
+  m_precision = mut::Math::double_precision;
+  m_indexed_search = false;
+  clearCodebooksMatrix();
 
   // Training parameters
   m_nepochs_1 = 0;
@@ -1226,6 +1528,7 @@ void SuperSOM::clearObject()
   m_sigma_fin_2 = 0.0;
   m_sigma_fin_3 = 0.0;
   m_alpha_decay_type = linear_decay;
+  m_local_search_radius = 0;
 
   // Training support structures (should already be empty)
   clearNeighborsMap();
@@ -1238,7 +1541,8 @@ void SuperSOM::clearObject()
 /**
  * Method distance
  *
- * Returns the euclidean distance between DATA and CODEBOOK.
+ * Returns the euclidean distance between DATA and CODEBOOK (the searches of
+ * the nearest units compare the squared distances, see squaredDistance).
  */
 inline
 SuperSOM::Real SuperSOM::distance
@@ -1247,7 +1551,7 @@ SuperSOM::Real SuperSOM::distance
     const Codebook& codebook
 ) const
 {
-  return arma::norm(data - codebook, 2);
+  return std::sqrt(squaredDistance(data, codebook));
 } // method distance
 
 /**
@@ -1354,6 +1658,85 @@ void SuperSOM::initNeighborsMap()
   return;
 } // method initNeighborsMap
 
+/**
+ * Method initWinnerUnitVector
+ *
+ * Computes the winner unit of each training data and stores it in
+ * m_winner_unit_vector (at the same index of the data), through the exact
+ * search on the map of the codebooks (see mapWinnerUnit).
+ */
+void SuperSOM::initWinnerUnitVector(const DataContainer& tr_data)
+{
+  const size_t tr_size = tr_data.size();
+  m_winner_unit_vector.resize(tr_size);
+
+  for (size_t i = 0; i < tr_size; ++i)
+  {
+    if (tr_data[i].n_elem != getCodebookSize())
+      throw moka::GenericException(
+          "SuperSOM::initWinnerUnitVector: wrong data size");
+    m_winner_unit_vector[i] = mapWinnerUnit(tr_data[i]);
+  } // for i
+
+  return;
+} // method initWinnerUnitVector
+
+/**
+ * Method localWinnerUnit
+ *
+ * Returns the winner unit on the passed data searching it near PREVIOUS_WINNER
+ * (the winner unit of the same data at its previous presentation), that is
+ * in the units within the local search radius from it (see
+ * setLocalSearchRadius) in the map topology, visited ring by ring through
+ * m_neighbors_map (that must be already builded).
+ * If the closest unit found is in the outer ring the winner unit could be
+ * farther, then the search is inconclusive and the winner unit is searched
+ * on the whole map (see mapWinnerUnit). Otherwise the closest unit is returned,
+ * that is the winner unit unless the data moved to a different region of the
+ * map: since the codebooks change slowly in the later training phases, this
+ * is a good approximation of the winner unit at a fraction of the cost.
+ */
+SuperSOM::UnitIndex SuperSOM::localWinnerUnit
+(
+    const Data& data,
+    const UnitIndex& previous_winner
+) const
+{
+  const std::vector< std::list<UnitIndex>* >& rings =
+      m_neighbors_map[previous_winner.first][previous_winner.second];
+  const size_t n_rings =
+      std::min<size_t>(rings.size(), m_local_search_radius + 1);
+
+  UnitIndex winner_unit = previous_winner;
+  Real dist_min = squaredDistance(data, getCodebook(previous_winner));
+  size_t winner_ring = 0;
+
+  for (size_t ring = 1; ring < n_rings; ++ring)
+  {
+    if (rings[ring] == NULL)
+      continue;
+
+    std::list<UnitIndex>::const_iterator it = rings[ring]->begin();
+    for (/* nop */; it != rings[ring]->end(); ++it)
+    {
+      Real dist = squaredDistance(data, getCodebook(*it), dist_min);
+      if (dist < dist_min)
+      {
+        dist_min = dist;
+        winner_unit = *it;
+        winner_ring = ring;
+      }
+    } // for it
+
+  } // for ring
+
+  // Inconclusive search (unless the whole map has been searched)
+  if (winner_ring + 1 == n_rings && n_rings < rings.size())
+    return mapWinnerUnit(data);
+
+  return winner_unit;
+} // method localWinnerUnit
+
 /**
  * Method lvq1ExtUpdate
  *
@@ -1410,8 +1793,8 @@ void SuperSOM::lvq3ExtUpdate
   {
     // check if data fall in the window (there must not be a large
     // disproportion between distances from data and the two winning units)
-    Real dist1 = arma::norm(data - getCodebook(closest_unit_1), 2);
-    Real dist2 = arma::norm(data - getCodebook(closest_unit_2), 2);
+    Real dist1 = distance(data, getCodebook(closest_unit_1));
+    Real dist2 = distance(data, getCodebook(closest_unit_2));
 
     Real window_threshold = (1 - window) / (1 + window);
     if (std::min(dist1 / dist2, dist2 / dist2) > window_threshold)
@@ -1444,6 +1827,42 @@ void SuperSOM::lvq3ExtUpdate
   return;
 } // method lvq3ExtUpdate
 
+/**
+ * Method mapWinnerUnit
+ *
+ * Returns the winner unit on the passed data (of the right size) comparing it
+ * with every codebook of the map, in double precision. This is the exact
+ * search used by the training (the codebooks matrix, its single precision
+ * copy and the nearest neighbor index serve only the trained map).
+ */
+SuperSOM::UnitIndex SuperSOM::mapWinnerUnit(const Data& data) const
+{
+  UnitIndex winner_unit;
+  winner_unit.first = 0;
+  winner_unit.second = 0;
+
+  Real dist_min = squaredDistance(data, m_map[0][0]);
+
+  // Get the winner unit
+  for (size_t r = 0; r < m_nrows; ++r)
+  {
+    for (size_t c = 0; c < m_ncols; ++c)
+    {
+      Real dist = squaredDistance(data, m_map[r][c], dist_min);
+
+      if (dist < dist_min)
+      {
+        dist_min = dist;
+        winner_unit.first = r;
+        winner_unit.second = c;
+      } // if
+
+    } // for c
+  } // for r
+
+  return winner_unit;
+} // method mapWinnerUnit
+
 /**
  * Method setInitialized
  *
@@ -1453,6 +1872,8 @@ void SuperSOM::lvq3ExtUpdate
 void SuperSOM::setInitialized(bool initialized)
 {
   m_is_initialized = initialized;
+  if (!m_is_initialized)
+    clearCodebooksMatrix();
   return;
 } // method setInitialized
 
@@ -1473,6 +1894,29 @@ SuperSOM::Real SuperSOM::sigmaDecay
   return sigma_ini + step * ((sigma_fin - sigma_ini) / (total_steps - 1.0));
 } // method sigmaDecay
 
+/**
+ * Method squaredDistance
+ *
+ * Returns the squared euclidean distance between DATA and CODEBOOK (that must
+ * have the same size), without temporaries. The computation is abandoned as
+ * soon as the partial sum exceeds BOUND, and then a value greater than BOUND
+ * is returned (see util::SquaredDistance).
+ */
+inline
+SuperSOM::Real SuperSOM::squaredDistance
+(
+    const Data& data,
+    const Codebook& codebook,
+    Real bound
+) const
+{
+  return mut::SquaredDistance::compute(
+      data.memptr(),
+      codebook.memptr(),
+      data.n_elem,
+      bound);
+} // method squaredDistance
+
 /**
  * Method superTrainProcedure
  *
@@ -1498,16 +1942,17 @@ void SuperSOM::superTrainProcedure
   Real sigma = sigma_ini;
 
   // Init data structures
-  m_winner_unit_vector.resize(tr_data_size);
   m_classes_map.resize(m_nrows);
   for (size_t i = 0; i < m_nrows; ++i)
     m_classes_map[i].resize(m_ncols);
 
-  // Compute initial classes for each unit and winner unit for each input
+  // Compute the winner unit for each input
+  initWinnerUnitVector(tr_data);
+
+  // Compute initial classes for each unit
   for (size_t i = 0; i < tr_data_size; ++i)
   {
-    UnitIndex win_unit = winnerUnit(tr_data[i]);
-    m_winner_unit_vector[i] = win_unit;
+    const UnitIndex& win_unit = m_winner_unit_vector[i];
 
     std::map<Real, Int>& win_unit_classes =
         m_classes_map[win_unit.first][win_unit.second];
@@ -1535,7 +1980,10 @@ void SuperSOM::superTrainProcedure
     for (size_t i = 0; i < tr_data_size; ++i, ++step)
     {
       // LVQ1
-      UnitIndex winner_unit = winnerUnit(tr_data[av[i]]);
+      UnitIndex winner_unit =
+          m_local_search_radius > 0 ?
+            localWinnerUnit(tr_data[av[i]], m_winner_unit_vector[av[i]]) :
+            mapWinnerUnit(tr_data[av[i]]);
       lvq1ExtUpdate
           (
             tr_data[av[i]],
@@ -1636,7 +2084,8 @@ void SuperSOM::unsuperTrainProcedure
     const Real& alpha_ini,
     const DecayType& alpha_decay,
     const Real& sigma_ini,
-    const Real& sigma_fin
+    const Real& sigma_fin,
+    bool local_search
 )
 {
   size_t tr_size = tr_data.size();
@@ -1644,6 +2093,10 @@ void SuperSOM::unsuperTrainProcedure
   Real alpha = alpha_ini;
   Real sigma = sigma_ini;
 
+  // Winner units of the data, for the local winner unit search
+  if (local_search)
+    initWinnerUnitVector(tr_data);
+
   // Build access vector
   std::vector<size_t> av(tr_size);
   for (size_t i = 0; i < tr_size; ++i)
@@ -1660,7 +2113,15 @@ void SuperSOM::unsuperTrainProcedure
     for (size_t i = 0; i < tr_size; ++i, ++step)
     {
       // Get the winner unit
-      UnitIndex win_unit = winnerUnit(tr_data[av[i]]);
+      UnitIndex win_unit;
+      if (local_search)
+      {
+        win_unit =
+            localWinnerUnit(tr_data[av[i]], m_winner_unit_vector[av[i]]);
+        m_winner_unit_vector[av[i]] = win_unit;
+      }
+      else
+        win_unit = mapWinnerUnit(tr_data[av[i]]);
 
       // Update codebook
       updateCodebook(win_unit, tr_data[av[i]], alpha, sigma);
@@ -1673,6 +2134,8 @@ void SuperSOM::unsuperTrainProcedure
 
   } // for ep
 
+  m_winner_unit_vector.clear();
+
   return;
 } // method unsuperTrainProcedure
 
@@ -1772,6 +2235,78 @@ void SuperSOM::updateCodebook
   return;
 } // method updateCodebook
 
+/**
+ * Method updateCodebooksColumn
+ *
+ * Copies the codebook of the passed unit in its column of the codebooks
+ * matrix, and of its single precision copy if built, together with its
+ * squared norm (see updateCodebooksMatrix).
+ */
+inline
+void SuperSOM::updateCodebooksColumn(const UnitIndex& unit)
+{
+  const Real *codebook = m_map[unit.first][unit.second].memptr();
+  const Uint size = m_codebooks.n_rows;
+  const Uint u = unit.first * m_ncols + unit.second;
+
+  Real *column = m_codebooks.colptr(u);
+  Real norm = 0;
+  for (Uint i = 0; i < size; ++i)
+  {
+    column[i] = codebook[i];
+    norm += codebook[i] * codebook[i];
+  }
+  m_codebooks_norms[u] = norm;
+
+  if (m_single_codebooks.is_empty())
+    return;
+
+  SingleReal *single_column = m_single_codebooks.colptr(u);
+  SingleReal single_norm = 0;
+  for (Uint i = 0; i < size; ++i)
+  {
+    single_column[i] = codebook[i];
+    single_norm += single_column[i] * single_column[i];
+  }
+  m_single_codebooks_norms[u] = single_norm;
+
+  return;
+} // method updateCodebooksColumn
+
+/**
+ * Method updateCodebooksMatrix
+ *
+ * Builds the matrix of the codebooks (the column r * no_columns + c is the
+ * codebook of the unit (r, c)) and their squared norms if the map is
+ * initialized, clears them otherwise. If the single precision is setted (and
+ * the indexed search is not) it builds also the single precision copy of
+ * them, with the indexed search the nearest neighbor index of the codebooks.
+ */
+void SuperSOM::updateCodebooksMatrix()
+{
+  clearCodebooksMatrix();
+  if (!isInitialized() || m_map.empty())
+    return;
+
+  m_codebooks.set_size(getCodebookSize(), getNoUnits());
+  m_codebooks_norms.set_size(getNoUnits());
+  if (!m_indexed_search && m_precision == mut::Math::single_precision)
+  {
+    m_single_codebooks.set_size(getCodebookSize(), getNoUnits());
+    m_single_codebooks_norms.set_size(getNoUnits());
+  }
+
+  UnitIndex unit;
+  for (unit.first = 0; unit.first < m_nrows; ++unit.first)
+    for (unit.second = 0; unit.second < m_ncols; ++unit.second)
+      updateCodebooksColumn(unit);
+
+  if (m_indexed_search)
+    m_codebooks_index.build(m_codebooks);
+
+  return;
+} // method updateCodebooksMatrix
+
 /**
  * Method updateUnitClass
  *
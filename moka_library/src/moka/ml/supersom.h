@@ -2,6 +2,7 @@
 #define MOKA_ML_SUPERSOM_H
 
 #include <istream>
+#include <limits>
 #include <list>
 #include <map>
 #include <ostream>
@@ -11,6 +12,7 @@
 #include <moka/exception.h>
 #include <moka/global.h>
 #include <moka/util/math.h>
+#include <moka/util/vptree.h>
 
 namespace moka {
 namespace ml {
@@ -20,6 +22,44 @@ namespace ml {
  *
  * Implementation of a Supervised Self-Organizing Map [1].
  *
+ * Besides the map of the codebooks, the SOM keeps a copy of them stored
+ * contiguously in a matrix (a column for each unit) together with their
+ * squared norms, so the batch winner unit search (method winnerUnits on a
+ * matrix of data) finds the winner units of many data at once through a
+ * single matrix product, using |x - c|^2 = |x|^2 - 2 c'x + |c|^2. With the
+ * single precision (see setPrecision) the winner unit search compares the data
+ * with a single precision copy of such matrix. Only the search is in single
+ * precision: the codebooks, the training and the other methods (e.g. activate)
+ * stay in double precision, and the data passed in double precision are
+ * converted while computing the distances (winnerUnit) or copied once per
+ * search (winnerUnits; the batch search on data already in single precision,
+ * e.g. gathered directly from the states, avoids such copy).
+ *
+ * The training always searches the winner units exactly, comparing the data
+ * with each codebook of the map in double precision: the batch, the single
+ * precision and the indexed searches serve only the trained map. Then the
+ * codebooks matrix, its single precision copy and the nearest neighbor index
+ * are cleared when the training starts, and built again once at its end.
+ *
+ * The searches of the nearest units (winnerUnit, winnerUnits and so the
+ * training) compare the squared distances, computed by util::SquaredDistance
+ * and abandoned as soon as they exceed the smallest one found so far.
+ *
+ * Optionally (see setLocalSearchRadius) the training phases after the first
+ * one search the winner unit of each data near the winner unit of the same
+ * data at its previous presentation, instead of on the whole map (see the
+ * method localWinnerUnit).
+ *
+ * With the indexed search (see setIndexedSearch) an exact nearest neighbor
+ * index (a util::VpTree) is built over the codebooks together with the
+ * codebooks matrix, that is once the codebooks are fixed (after the training,
+ * init or read), and the winner unit searches (winnerUnit and winnerUnits) go
+ * through it instead of comparing the data with every unit. The results are
+ * the same, but the search cost grows sublinearly with the map size when the
+ * codebooks are well clustered (as in a trained map). Since the index is
+ * exact and built in double precision, it's used in place of the single
+ * precision search.
+ *
  * References
  *   [1] T. Kohonen. The Self-Organizing Map. 1990.
  *   [2] T. Kohonen et al. SOM_PAK: The Self Organized Map Program Package.
@@ -34,8 +74,13 @@ class SuperSOM
     typedef typename util::Math::Vector Data;
     typedef Data Codebook;
     typedef std::vector<Data> DataContainer;
+    typedef util::Math::Matrix Matrix;
     typedef std::pair<size_t, size_t> UnitIndex;
     typedef std::vector< std::vector<float> > UMatrix;
+    typedef util::Math::SingleReal SingleReal;
+    typedef util::Math::SingleMatrix SingleMatrix;
+    typedef util::Math::SingleVector SingleVector;
+    typedef util::Math::Precision Precision;
 
     enum TrainingType { unsupervised_training, supervised_training };
     enum DecayType { linear_decay, inverse_decay };
@@ -111,6 +156,12 @@ class SuperSOM
       return m_map[0][0].size();
     }
 
+    //! Radius of the local winner unit search in the training (0: disabled)
+    const Uint& getLocalSearchRadius() const
+    {
+      return m_local_search_radius;
+    }
+
     //! Number of columns in the map
     const Uint& getNoColumns() const
     {
@@ -147,6 +198,12 @@ class SuperSOM
       return getNoColumns() * getNoRows();
     }
 
+    //! Floating point precision of the winner unit search
+    Precision getPrecision() const
+    {
+      return m_precision;
+    }
+
     //! Random seed for map generation
     Uint getRandomSeed() const
     {
@@ -192,6 +249,12 @@ class SuperSOM
     //! Inits map initial codebooks randomly in the range of training data
     void init(const DataContainer& training_data);
 
+    //! True if the winner unit search goes through the nearest neighbor index
+    bool isIndexedSearch() const
+    {
+      return m_indexed_search;
+    }
+
     //! Return true if the map has been initialized, false otherwise.
     bool isInitialized() const
     {
@@ -243,6 +306,15 @@ class SuperSOM
     //! Given the training set size automatically deduces good parameters
     void setDefaultParameters(Uint training_set_size);
 
+    //! Winner unit search through the nearest neighbor index of the codebooks
+    void setIndexedSearch(bool indexed_search);
+
+    //! Radius of the local winner unit search in the training (0: disabled)
+    void setLocalSearchRadius(const Uint& radius)
+    {
+      m_local_search_radius = radius;
+    }
+
     //! Number of columns in the map
     void setNoColumns(const Uint& ncols)
     {
@@ -275,6 +347,9 @@ class SuperSOM
       setInitialized(false);
     }
 
+    //! Floating point precision of the winner unit search
+    void setPrecision(Precision precision);
+
     //! Random seed for map initialization
     void setRandomSeed(const Uint& rseed)
     {
@@ -341,6 +416,16 @@ class SuperSOM
         Uint n,
         std::vector<UnitIndex>& winners) const;
 
+    //! Fill the vector <winners> with the winner unit of each column of <data>
+    void winnerUnits(
+        const Matrix& data,
+        std::vector<UnitIndex>& winners) const;
+
+    //! As above, on data in single precision
+    void winnerUnits(
+        const SingleMatrix& data,
+        std::vector<UnitIndex>& winners) const;
+
     //! Writes the SOM on the passed output stream
     void write(std::ostream& os) const;
 
@@ -356,6 +441,13 @@ class SuperSOM
 
     // SOM elements
     std::vector< std::vector<Codebook> > m_map;
+    Precision m_precision;
+    Matrix m_codebooks;
+    Data m_codebooks_norms;
+    SingleMatrix m_single_codebooks;
+    SingleVector m_single_codebooks_norms;
+    bool m_indexed_search;
+    util::VpTree m_codebooks_index;
 
     // Training parameters
     Uint m_nepochs_1, m_nepochs_2, m_nepochs_3;
@@ -363,6 +455,7 @@ class SuperSOM
     Real m_sigma_1, m_sigma_2, m_sigma_3;
     Real m_sigma_fin_1, m_sigma_fin_2, m_sigma_fin_3;
     DecayType m_alpha_decay_type;
+    Uint m_local_search_radius;
 
     // Training support structures
     std::vector< std::vector< std::vector< std::list<UnitIndex>* > > >
@@ -377,6 +470,8 @@ class SuperSOM
         const Uint& total_steps,
         const Uint& step) const;
 
+    void clearCodebooksMatrix();
+
     void clearNeighborsMap();
 
     void clearObject();
@@ -391,6 +486,12 @@ class SuperSOM
 
     void initNeighborsMap();
 
+    void initWinnerUnitVector(const DataContainer& tr_data);
+
+    UnitIndex localWinnerUnit(
+        const Data& data,
+        const UnitIndex& previous_winner) const;
+
     void lvq1ExtUpdate(
         const Data& data,
         const Real& data_class,
@@ -408,6 +509,8 @@ class SuperSOM
         const Real& alpha,
         const Real& sigma);
 
+    UnitIndex mapWinnerUnit(const Data& data) const;
+
     void setInitialized(bool initialized = false);
 
     Real sigmaDecay(
@@ -416,6 +519,11 @@ class SuperSOM
         const Uint& total_steps,
         const Uint& step) const;
 
+    Real squaredDistance(
+        const Data& data,
+        const Codebook& codebook,
+        Real bound = std::numeric_limits<Real>::max()) const;
+
     void superTrainProcedure(
         const DataContainer& tr_data,
         const std::vector<Real>& tr_data_class,
@@ -433,7 +541,8 @@ class SuperSOM
         const Real& alpha,
         const DecayType& alpha_decay,
         const Real& sigma_ini,
-        const Real& sigma_fin);
+        const Real& sigma_fin,
+        bool local_search);
 
     void updateCodebook(
         const UnitIndex& winner_unit,
@@ -443,6 +552,10 @@ class SuperSOM
         bool positive_updating = true,
         const Real& epsilon = 1.0);
 
+    void updateCodebooksColumn(const UnitIndex& unit);
+
+    void updateCodebooksMatrix();
+
     void updateUnitClass(
         const UnitIndex& data_win_unit,
         const Real& data_class,
@@ -3,6 +3,9 @@
 #include <algorithm>
 #include <map>
 #include <sstream>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <moka/util/fasttanh.h>
 #include <moka/util/timer.h>
 
 namespace moka {
@@ -20,6 +23,215 @@ typedef GraphEsnSom::Int Int;
 typedef GraphEsnSom::Real Real;
 typedef GraphEsnSom::Uint Uint;
 
+namespace {
+
+/**
+ * Class ParallelEncoding
+ *
+ * Support class for the method GraphEsnSom::encodeGraphs: computes the
+ * encoding of a set of input graphs on a pool of threads that share the same
+ * (const) reservoir. The input graphs are not assigned to the threads in
+ * advance: each thread takes the next graph not yet encoded as soon as it is
+ * free, so the load remains balanced also when the encoding times are very
+ * different. Each result is written in the slot with the same index of the
+ * input graph, so the results order doesn't depend on the threads.
+ */
+class ParallelEncoding
+{
+  public:
+    typedef GraphEsnSom::Reservoir Reservoir;
+
+    //! Constructor
+    ParallelEncoding(
+        const Reservoir& reservoir,
+        const std::vector<const MultiLabeledGraph*>& inputs,
+        const std::vector<const MultiLabeledGraph*>& initial_graphs,
+        const std::vector<MultiLabeledGraph*>& state_graphs,
+        std::vector<Uint>& iterations,
+        std::vector<char>& converged) :
+      m_reservoir(reservoir),
+      m_inputs(inputs),
+      m_initial_graphs(initial_graphs),
+      m_state_graphs(state_graphs),
+      m_iterations(iterations),
+      m_converged(converged),
+      m_next(0),
+      m_failed(false)
+    { }
+
+    //! Error message of the failed encoding (empty if no encoding failed)
+    const std::string& getError() const
+    {
+      return m_error;
+    }
+
+    //! Iterations computed by each thread in the last run
+    const std::vector<Uint>& getThreadIterations() const
+    {
+      return m_thread_iterations;
+    }
+
+    /**
+     * Method run
+     *
+     * Encodes all the input graphs using the given number of threads (the
+     * calling thread is used if no_threads is 1). Returns false if an
+     * exception has been thrown by an encoding (see getError).
+     */
+    bool run(Uint no_threads)
+    {
+      m_next = 0;
+      m_failed = false;
+      m_error.clear();
+      m_thread_iterations.assign(no_threads, 0);
+
+      if (no_threads <= 1)
+        worker(0);
+      else
+      {
+        boost::thread_group threads;
+        for (Uint t = 0; t < no_threads; ++t)
+          threads.create_thread(
+              boost::bind(&ParallelEncoding::worker, this, t));
+        threads.join_all();
+      } // if-else
+
+      return !m_failed;
+    } // method run
+
+  private:
+    const Reservoir& m_reservoir;
+    const std::vector<const MultiLabeledGraph*>& m_inputs;
+    const std::vector<const MultiLabeledGraph*>& m_initial_graphs;
+    const std::vector<MultiLabeledGraph*>& m_state_graphs;
+    std::vector<Uint>& m_iterations;
+    std::vector<char>& m_converged;
+    std::vector<Uint> m_thread_iterations;
+    boost::mutex m_mutex;
+    Uint m_next;
+    bool m_failed;
+    std::string m_error;
+
+    /**
+     * Method nextGraph
+     *
+     * Takes the index of the next graph to encode. Returns false if there
+     * are no more graphs or if an encoding is failed.
+     */
+    bool nextGraph(Uint& i)
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      if (m_failed || m_next >= m_inputs.size())
+        return false;
+      i = m_next++;
+      return true;
+    } // method nextGraph
+
+    /**
+     * Method worker
+     *
+     * Body of the thread "thread_id": encodes graphs until there are no more
+     * graphs to encode, using its own encoding buffer. If the initial graphs
+     * are given each encoding starts from the states of its initial graph.
+     */
+    void worker(Uint thread_id)
+    {
+      Reservoir::EncodingBuffer buffer;
+      Uint thread_iterations = 0;
+      Uint i;
+
+      while (nextGraph(i)) try
+      {
+        if (m_initial_graphs.empty())
+          m_converged[i] =
+              m_reservoir.encoding(*m_inputs[i], buffer, m_iterations[i]);
+        else
+          m_converged[i] =
+              m_reservoir.encoding(
+                *m_inputs[i], *m_initial_graphs[i], buffer, m_iterations[i]);
+        buffer.swapStateGraph(*m_state_graphs[i]);
+        thread_iterations += m_iterations[i];
+      }
+      catch (std::exception& ex)
+      {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        m_failed = true;
+        m_error = ex.what();
+      }
+      catch (...)
+      {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        m_failed = true;
+        m_error = "unknown exception";
+      }
+
+      m_thread_iterations[thread_id] = thread_iterations;
+      return;
+    } // method worker
+
+}; // class ParallelEncoding
+
+/**
+ * Function gatherStates
+ *
+ * Copies the states of the verteces of the passed state graph in the columns
+ * of STATES (in the order of the verteces), converted to the element type of
+ * the matrix.
+ */
+template <typename MatrixType>
+void gatherStates(const MultiLabeledGraph& state_graph, MatrixType& states)
+{
+  const MultiLabeledGraph::View graph(state_graph);
+
+  states.set_size(state_graph.getElementsSize(), graph.getSize());
+  for (Uint vertex = 0; vertex < graph.getSize(); ++vertex)
+  {
+    const Math::Vector& state = graph.getVertexElement(vertex);
+    if (state.n_elem != states.n_rows)
+      throw moka::GenericException(
+          "GraphEsnSom::winnerUnits: wrong state size");
+    std::copy(state.begin(), state.end(), states.begin_col(vertex));
+  }
+
+  return;
+} // function gatherStates
+
+/**
+ * Function atomSymbolLabel
+ *
+ * Returns the index of the atom symbol label (see the parameter
+ * <add-lbl-atom-symbol> of MultiLabeledGraphDataset::load) in the vertex
+ * labels of the graph, or the number of labels if there isn't such label.
+ */
+Uint atomSymbolLabel(const MultiLabeledGraph& graph)
+{
+  for (Uint i = 0; i < graph.getLabelNameSize(); ++i)
+    if (graph.getLabelName(i) == "Atom symbol")
+      return i;
+  return graph.getLabelNameSize();
+} // function atomSymbolLabel
+
+/**
+ * Function atomSymbol
+ *
+ * Returns the atom symbol of the vertex n of the graph, given the index of
+ * the atom symbol label (see atomSymbolLabel), or an empty string if the
+ * vertex has no such label.
+ */
+const std::string& atomSymbol
+(
+    const MultiLabeledGraph& graph,
+    Uint label,
+    Uint n
+)
+{
+  static const std::string no_symbol;
+  const LabelSet& labels = graph.getVertexItem(n);
+  return label < labels.size() ? labels[label] : no_symbol;
+} // function atomSymbol
+
+} // namespace
+
 /**
  * Constructor
  *
@@ -619,6 +831,10 @@ util::Info<std::string> GraphEsnSom::info() const
       "reservoir_size",
       "Reservoir size",
       Global::toString(getReservoirSize()));
+  inf.pushBack(
+      "reservoir_ensemble_size",
+      "Reservoir ensemble size",
+      Global::toString(m_reservoir.getEnsembleSize()));
   inf.pushBack(
       "reservoir_input_scaling",
       "Reservoir input scaling",
@@ -628,10 +844,22 @@ util::Info<std::string> GraphEsnSom::info() const
       "Reservoir connectivity",
       Global::toString(m_reservoir.getReservoirConnectivity() * 100),
       "%");
+  inf.pushBack(
+      "reservoir_sparse_matrix",
+      "Reservoir sparse matrix",
+      Global::toString(m_reservoir.isReservoirMatrixSparse()));
   inf.pushBack(
       "reservoir_sigma",
       "Reservoir sigma",
       Global::toString(m_reservoir.getSigma()));
+  inf.pushBack(
+      "reservoir_norm_tolerance",
+      "Reservoir norm tolerance",
+      Global::toString(m_reservoir.getNormTolerance()));
+  inf.pushBack(
+      "reservoir_matrix_norm2",
+      "W_hat 2-norm before scaling",
+      Global::toString(m_reservoir.getReservoirMatrixNorm()));
   inf.pushBack(
       "reservoir_epsilon",
       "Reservoir epsilon",
@@ -640,6 +868,36 @@ util::Info<std::string> GraphEsnSom::info() const
       "reservoir_max_degree",
       "Reservoir max degree (k)",
       Global::toString(m_reservoir.getMaxDegree()));
+  inf.pushBack(
+      "reservoir_encoding",
+      "Reservoir encoding mode",
+      Reservoir::encmToStr(m_reservoir.getEncodingMode()));
+  inf.pushBack(
+      "reservoir_solver",
+      "Reservoir solver",
+      Reservoir::solvToStr(m_reservoir.getSolver()));
+  inf.pushBack(
+      "reservoir_precision",
+      "Reservoir precision",
+      Math::precToStr(m_reservoir.getPrecision()));
+  inf.pushBack(
+      "reservoir_tanh",
+      "Reservoir tanh",
+      m_reservoir.isFastTanh() ?
+        "fast (" + FastTanh::instToStr(FastTanh::getInstructionSet()) + ")" :
+        std::string("exact"));
+  inf.pushBack(
+      "encoding_threads",
+      "Encoding threads",
+      Global::toString(m_encoding_threads));
+  inf.pushBack(
+      "reservoir_state_cache",
+      "Reservoir state cache",
+      Global::toString(m_state_cache.get() != NULL));
+  inf.pushBack(
+      "reservoir_warm_start",
+      "Reservoir warm start",
+      Global::toString(m_label_states.get() != NULL));
   inf.pushBack(
       "input_matrix_fnorm",
       "W_in frobenius norm",
@@ -673,6 +931,14 @@ util::Info<std::string> GraphEsnSom::info() const
       "som_no_units",
       "SOM units",
       Global::toString(m_som.getNoUnits()));
+  inf.pushBack(
+      "som_precision",
+      "SOM precision",
+      Math::precToStr(m_som.getPrecision()));
+  inf.pushBack(
+      "som_indexed_search",
+      "SOM indexed search",
+      Global::toString(m_som.isIndexedSearch()));
 
   if (m_som_load_file.empty())
   {
@@ -714,6 +980,10 @@ util::Info<std::string> GraphEsnSom::info() const
         Global::toString(m_som.getSigmaFinal2()) + " (2nd), " +
         Global::toString(m_som.getSigmaFinal3()) + " (3rd) "
       ));
+  inf.pushBack(
+      "som_local_search_radius",
+      "SOM local search radius",
+      Global::toString(m_som.getLocalSearchRadius()));
 
   inf.pushBack(
       "state_vector_type",
@@ -795,6 +1065,17 @@ void GraphEsnSom::init()
     // Reservoir init
     m_reservoir.init();
 
+    // States cache (a new one, since the reservoir is changed)
+    m_state_cache.reset();
+    if (getParameters().getBool("reservoir-state-cache", false))
+      m_state_cache.reset(new StateCache());
+
+    // Per-label states for the warm start (a new empty table, filled by the
+    // first training, see initLabelStates)
+    m_label_states.reset();
+    if (getParameters().getBool("reservoir-warm-start", false))
+      m_label_states.reset(new LabelStates());
+
     // If required try to load the SOM from file
     if (!m_som_load_file.empty())
       m_som.loadFromFile(m_som_load_file);
@@ -802,7 +1083,7 @@ void GraphEsnSom::init()
     // Readout init (+ 1 in the vector size is for the bias)
     if (m_state_vect_type == reservoir_state_vect)
       m_readout.setStateVectorSize(
-            m_som.getNoUnits() * m_reservoir.getReservoirSize() + 1);
+            m_som.getNoUnits() * m_reservoir.getStateSize() + 1);
     else
       m_readout.setStateVectorSize(m_som.getNoUnits() + 1);
     m_readout.init();
@@ -947,7 +1228,10 @@ const GraphEsnSom::NumericResults& GraphEsnSom::test()
   // Collects outputs
   for (Uint i = 0; i < m_trainingset->getTestFoldSize(); ++i)
   {
-    compute(m_trainingset->tsAt(i).getInput());
+    outputProcess(
+        stateMappingFunctionProcess(
+          cachedEncodingProcess(
+            *m_trainingset, m_trainingset->tsAt(i).getInput())));
     std::copy(
         getLastOutput().begin(),
         getLastOutput().end(),
@@ -1055,7 +1339,10 @@ const GraphEsnSom::NumericResults& GraphEsnSom::testOn(const Dataset& testset)
   // Collects the reservoir states
   for (Uint i = 0; i < mlg_dataset->getSize(); ++i)
   {
-    compute(mlg_dataset->at(i).getInput());
+    outputProcess(
+        stateMappingFunctionProcess(
+          cachedEncodingProcess(
+            *mlg_dataset, mlg_dataset->at(i).getInput())));
     std::copy(
         getLastOutput().begin(),
         getLastOutput().end(),
@@ -1283,7 +1570,7 @@ const GraphEsnSom::NumericResults& GraphEsnSom::train()
   if (m_state_vect_type == reservoir_state_vect)
   {
     Uint null_clusters_count = 0;
-    Uint readout_cols = m_reservoir.getReservoirSize() * m_som.getNoUnits() + 1;
+    Uint readout_cols = m_reservoir.getStateSize() * m_som.getNoUnits() + 1;
     const LinearReadout::Matrix &readout_mat = m_readout.getReadoutMatrix();
 
     // a check to be sure
@@ -1293,8 +1580,8 @@ const GraphEsnSom::NumericResults& GraphEsnSom::train()
     else
       for (size_t i = 0; i < m_som.getNoUnits(); ++i)
       {
-        size_t first_c = (i * m_reservoir.getReservoirSize()) + 1;
-        size_t last_c = (i + 1) * m_reservoir.getReservoirSize();
+        size_t first_c = (i * m_reservoir.getStateSize()) + 1;
+        size_t last_c = (i + 1) * m_reservoir.getStateSize();
         if (arma::norm(readout_mat.cols(first_c, last_c), "fro") == 0)
           ++null_clusters_count;
       }
@@ -1488,6 +1775,9 @@ void GraphEsnSom::clearObjectForInit(bool clear_base_model)
 
   // Reservoir
   m_reservoir.clear();
+  m_encoding_threads = 1;
+  m_state_cache.reset();
+  m_label_states.reset();
 
   // SOM
   m_som.clear();
@@ -1532,6 +1822,9 @@ void GraphEsnSom::copyObject(const GraphEsnSom& graphesnsom)
 
   // Reservoir
   m_reservoir = graphesnsom.m_reservoir;
+  m_encoding_threads = graphesnsom.m_encoding_threads;
+  m_state_cache = graphesnsom.m_state_cache;
+  m_label_states = graphesnsom.m_label_states;
 
   // SOM
   m_som = graphesnsom.m_som;
@@ -1562,6 +1855,122 @@ void GraphEsnSom::copyObject(const GraphEsnSom& graphesnsom)
 // PRIVATE METHODS
 // ===============
 
+/**
+ * Method buildInitialStates
+ *
+ * Builds the initial states for the warm start of the encoding of the input
+ * graph (see <reservoir-warm-start>): each vertex takes the state stored for
+ * its atom symbol (see initLabelStates), or the null state if the symbol
+ * doesn't appear in the training set.
+ * Returns false (and the initial graph is not built) if the warm start is
+ * disabled or if the per-label states are not computed yet.
+ */
+bool GraphEsnSom::buildInitialStates
+(
+    const MultiLabeledGraph& input,
+    MultiLabeledGraph& initial_graph
+) const
+{
+  if (!m_label_states || m_label_states->empty())
+    return false;
+
+  initial_graph.buildFrom(input, arma::zeros(m_reservoir.getStateSize()));
+  const Uint label = atomSymbolLabel(input);
+  for (Uint n = 0; n < input.getSize(); ++n)
+  {
+    LabelStates::const_iterator it =
+        m_label_states->find(atomSymbol(input, label, n));
+    if (it != m_label_states->end())
+      initial_graph.setVertexElement(n, it->second);
+  } // for n
+
+  return true;
+} // method buildInitialStates
+
+/**
+ * Method cacheStates
+ *
+ * Stores the state graph of the instance of the dataset "ds" with input graph
+ * "input" in the states cache (if the cache is enabled, see
+ * <reservoir-state-cache>), along with the iterations computed in its
+ * encoding.
+ */
+void GraphEsnSom::cacheStates
+(
+    const Dataset& ds,
+    const MultiLabeledGraph& input,
+    const MultiLabeledGraph& state_graph,
+    Uint iterations
+)
+{
+  if (!m_state_cache)
+    return;
+
+  StateCacheKey key(
+      ds.getGeneration(), StateCacheId(&input, m_reservoir.getRandomSeed()));
+  StateCacheEntry& entry = (*m_state_cache)[key];
+  entry.first = state_graph;
+  entry.second = iterations;
+
+  return;
+} // method cacheStates
+
+/**
+ * Method cachedEncodingProcess
+ *
+ * Like encodingProcess, but if the cache is enabled (see
+ * <reservoir-state-cache>) the state graph of the input graph is taken from
+ * the cache, or it is stored in the cache after the encoding. The input graph
+ * must be the input of an instance of the dataset "ds" (not a copy).
+ */
+const MultiLabeledGraph& GraphEsnSom::cachedEncodingProcess
+(
+    const Dataset& ds,
+    const MultiLabeledGraph& input
+)
+{
+  const StateCacheEntry *entry = cachedStates(ds, input);
+  if (entry)
+    return entry->first;
+
+  const MultiLabeledGraph& state_graph = encodingProcess(input);
+  cacheStates(
+      ds, input, state_graph, m_reservoir.getLastNumberOfIterations());
+
+  return state_graph;
+} // method cachedEncodingProcess
+
+/**
+ * Method cachedStates
+ *
+ * Returns the cache entry of the instance of the dataset "ds" with input
+ * graph "input" for the current reservoir, NULL if the cache is disabled or
+ * if the states of the instance are not in the cache. The entries are stored
+ * by the generation of the dataset (see Dataset::getGeneration) and by the
+ * address of the input graph of the instance: the instances of a dataset are
+ * neither moved nor deleted until the dataset takes a new generation, so
+ * within a generation such address identifies the instance (the instance ids
+ * are free text, that can be empty or repeated), while the entries of a
+ * dataset cleared, loaded again or released are never returned.
+ */
+const GraphEsnSom::StateCacheEntry* GraphEsnSom::cachedStates
+(
+    const Dataset& ds,
+    const MultiLabeledGraph& input
+) const
+{
+  if (!m_state_cache)
+    return NULL;
+
+  StateCacheKey key(
+      ds.getGeneration(), StateCacheId(&input, m_reservoir.getRandomSeed()));
+  StateCache::const_iterator it = m_state_cache->find(key);
+  if (it == m_state_cache->end())
+    return NULL;
+
+  return &(it->second);
+} // method cachedStates
+
 /**
  * Method checkDatasetCompatibility
  *
@@ -1626,6 +2035,10 @@ bool GraphEsnSom::checkParameters()
             "reservoir-connectivity",
             Prm::optional | Prm::real | Prm::in_range, "0.0", "1.0")
         &&
+        parameters.check(
+            "reservoir-sparse-threshold",
+            Prm::optional | Prm::real | Prm::in_range, "0.0", "1.0")
+        &&
         parameters.check(
             "reservoir-input-scaling",
             Prm::optional | Prm::real |  Prm::positive)
@@ -1636,18 +2049,66 @@ bool GraphEsnSom::checkParameters()
         parameters.check(
             "reservoir-sigma", Prm::optional | Prm::real | Prm::positive)
         &&
+        parameters.check(
+            "reservoir-norm-tolerance",
+            Prm::optional | Prm::real | Prm::non_negative)
+        &&
+        parameters.check(
+            "reservoir-ensemble-size",
+            Prm::optional | Prm::uint | Prm::positive)
+        &&
         parameters.check(
             "reservoir-epsilon", Prm::optional | Prm::real | Prm::non_negative)
         &&
         parameters.check(
             "reservoir-max-iters", Prm::optional | Prm::uint | Prm::positive)
         &&
+        parameters.check(
+            "reservoir-anderson-depth", Prm::optional | Prm::uint)
+        &&
         parameters.check("reservoir-rseed", Prm::optional | Prm::uint)
+        &&
+        parameters.check("encoding-threads", Prm::optional | Prm::uint)
       ); // reservoir_parameters_check
 
   if (!reservoir_parameters_check)
     return false;
 
+  if (parameters.contains("reservoir-encoding")) try
+  {
+    Reservoir::strToEncm(parameters.get("reservoir-encoding"));
+  }
+  catch (std::exception& ex)
+  {
+    Log::out << "GraphEsnSom: invalid value on parameter <reservoir-encoding> "
+             << "(" << parameters.get("reservoir-encoding") << ")" << Log::endl;
+    return false;
+  }
+
+  if (parameters.contains("reservoir-solver")) try
+  {
+    Reservoir::strToSolv(parameters.get("reservoir-solver"));
+  }
+  catch (std::exception& ex)
+  {
+    Log::out << "GraphEsnSom: invalid value on parameter <reservoir-solver> "
+             << "(" << parameters.get("reservoir-solver") << ")" << Log::endl;
+    return false;
+  }
+
+  if (parameters.contains("reservoir-precision")) try
+  {
+    Math::strToPrec(parameters.get("reservoir-precision"));
+  }
+  catch (std::exception& ex)
+  {
+    Log::out << "GraphEsnSom: invalid value on parameter "
+             << "<reservoir-precision> "
+             << "(" << parameters.get("reservoir-precision") << ")"
+             << Log::endl;
+    return false;
+  }
+
   // SOM parameters
   bool som_parameters_check =
       (
@@ -1693,6 +2154,10 @@ bool GraphEsnSom::checkParameters()
         parameters.check(
             "som-sigma-fin-3", Prm::optional | Prm::real | Prm::non_negative)
         &&
+        parameters.check(
+            "som-local-search-radius",
+            Prm::optional | Prm::uint | Prm::non_negative)
+        &&
         parameters.check("som-save-file", Prm::optional | Prm::non_empty)
         &&
         parameters.check("som-load-file", Prm::optional | Prm::non_empty)
@@ -1723,6 +2188,17 @@ bool GraphEsnSom::checkParameters()
     }
   } // if parameters.contains("som-alpha-decay")
 
+  if (parameters.contains("som-precision")) try
+  {
+    Math::strToPrec(parameters.get("som-precision"));
+  }
+  catch (std::exception& ex)
+  {
+    Log::out << "GraphEsnSom: invalid value on <som-precision> "
+             << "(" << parameters.get("som-precision") << ")" << Log::endl;
+    som_parameters_check = false;
+  }
+
   if (!som_parameters_check)
     return false;
 
@@ -1801,6 +2277,14 @@ bool GraphEsnSom::checkParameters()
  *
  * Method used during the training procedure (method train). If the encoding
  * procedure fails an exception will be thrown.
+ *
+ * The training graphs are encoded in parallel (see encodeGraphs), while the
+ * state graphs and the states are collected in the training set order. The
+ * state graphs already in the cache are not encoded again (see
+ * <reservoir-state-cache>), with the number of iterations of their first
+ * encoding. If the warm start is enabled and the per-label states are not
+ * computed yet, they are computed from the collected state graphs (see
+ * initLabelStates).
  */
 void GraphEsnSom::collectReservoirStates
 (
@@ -1811,27 +2295,72 @@ void GraphEsnSom::collectReservoirStates
     Real& avg_iterations
 )
 {
-  avg_iterations = 0.0;
+  const Uint size = training_set.getTrSetSize();
+
+  // Makes a slot for each state graph at the end of the list
+  std::vector<MultiLabeledGraph*> slots(size);
+  state_graphs.resize(state_graphs.size() + size);
+  std::list<MultiLabeledGraph>::iterator slot_it = state_graphs.end();
+  std::advance(slot_it, -((Int)size));
+  for (Uint i = 0; i < size; ++i, ++slot_it)
+    slots[i] = &(*slot_it);
+
+  // Takes the state graphs already in the cache and selects the graphs to
+  // encode
+  std::vector<Uint> iterations(size, 0);
+  std::vector<Uint> to_encode;
+  std::vector<const MultiLabeledGraph*> inputs;
+  std::vector<MultiLabeledGraph*> outputs;
+  for (Uint i = 0; i < size; ++i)
+  {
+    const StateCacheEntry *entry =
+        cachedStates(training_set, training_set.trAt(i).getInput());
+    if (entry)
+    {
+      *slots[i] = entry->first;
+      iterations[i] = entry->second;
+    }
+    else
+    {
+      to_encode.push_back(i);
+      inputs.push_back(&training_set.trAt(i).getInput());
+      outputs.push_back(slots[i]);
+    } // if-else
+  } // for i
 
-  // Computes and collects all the state graphs from the training set
-  for (Uint i = 0; i < training_set.getTrSetSize(); ++i)
+  // Computes the other state graphs
+  std::vector<Uint> encoding_iterations;
+  if (!encodeGraphs(inputs, outputs, encoding_iterations))
+    throw moka::GenericException("the encoding process is failed");
+
+  for (Uint k = 0; k < to_encode.size(); ++k)
   {
-    if (!m_reservoir.encoding(training_set.trAt(i).getInput()))
-      throw moka::GenericException("the encoding process is failed");
-    state_graphs.push_back(m_reservoir.getLastStateGraph());
-    avg_iterations += m_reservoir.getLastNumberOfIterations();
+    Uint i = to_encode[k];
+    iterations[i] = encoding_iterations[k];
+    cacheStates(
+        training_set, training_set.trAt(i).getInput(), *slots[i],
+        iterations[i]);
+  } // for k
 
-    // Collects all the states
-    Uint n_states = state_graphs.back().getSize();
+  // Collects all the states (in the training set order)
+  avg_iterations = 0.0;
+  for (Uint i = 0; i < size; ++i)
+  {
+    avg_iterations += iterations[i];
+
+    Uint n_states = slots[i]->getSize();
     for (Uint st = 0; st < n_states; ++st)
     {
-      states_container.push_back(state_graphs.back().getVertexElement(st));
+      states_container.push_back(slots[i]->getVertexElement(st));
       states_class.push_back(training_set.trAt(i).getOutput()[0]);
     }
 
   } // for i
 
-  avg_iterations = avg_iterations / (Real)(training_set.getTrSetSize());
+  avg_iterations = avg_iterations / (Real)(size);
+
+  if (m_label_states && m_label_states->empty())
+    initLabelStates(training_set, slots);
 
   return;
 } // method collectReservoirStates
@@ -1850,11 +2379,13 @@ void GraphEsnSom::computeReservoirStateVector(
 
   std::vector< std::vector<Vector> > clusters(m_som.getNoUnits());
 
+  std::vector<SuperSOM::UnitIndex> winners;
+  winnerUnits(state_graph, winners);
+
   Uint verteces = state_graph.getSize();
   for (Uint vertex = 0; vertex < verteces; ++vertex)
   {
-    SuperSOM::UnitIndex wu =
-        m_som.winnerUnit(state_graph.getVertexElement(vertex));
+    const SuperSOM::UnitIndex& wu = winners[vertex];
 
     size_t cluster_index = (wu.first * m_som.getNoColumns()) + wu.second;
     clusters[cluster_index].push_back(state_graph.getVertexElement(vertex));
@@ -1895,12 +2426,16 @@ void GraphEsnSom::computeStateVector(
   std::vector< std::vector<Real> > clusters(m_som.getNoUnits());
 
   // Each vertex of the graph is inserted in the cluster that best represents
-  // it, as determined by the SOM mapping.
-  Uint verteces = state_graph.getSize();
+  // it, as determined by the SOM mapping (all the verteces at once).
+  std::vector<SuperSOM::UnitIndex> winners;
+  winnerUnits(state_graph, winners);
+
+  const MultiLabeledGraph::View graph(state_graph);
+  Uint verteces = graph.getSize();
   for (Uint vertex = 0; vertex < verteces; ++vertex)
   {
-    SuperSOM::UnitIndex wu =
-        m_som.winnerUnit(state_graph.getVertexElement(vertex));
+    const Vector& state = graph.getVertexElement(vertex);
+    const SuperSOM::UnitIndex& wu = winners[vertex];
 
     // Puts the vector in its cluster. The cluster index is converted from map
     // to vector taking elements by rows, i.e. first all the first row (from
@@ -1911,13 +2446,13 @@ void GraphEsnSom::computeStateVector(
     switch (m_state_vect_type)
     {
     case cauchy_state_vect:
-      cls_value = m_som.activate(wu, state_graph.getVertexElement(vertex));
+      cls_value = m_som.activate(wu, state);
       break;
     case binary_state_vect:
       cls_value = 1.0;
       break;
     case sum_state_vect:
-      cls_value = Math::sum(state_graph.getVertexElement(vertex));
+      cls_value = Math::sum(state);
       break;
     default:
       throw moka::GenericException(
@@ -1961,21 +2496,156 @@ void GraphEsnSom::computeStateVector(
   return;
 } // method computeStateVector
 
+/**
+ * Method encodeGraphs
+ *
+ * Computes the encoding of all the input graphs, storing the i-th state graph
+ * in the graph pointed by state_graphs[i] and the number of iterations in
+ * iterations[i] (the vector is resized). The graphs are encoded by a pool of
+ * <encoding-threads> threads that share the reservoir (see the reentrant
+ * method GraphReservoir::encoding), then the results don't depend on the
+ * number of threads. If the warm start is enabled (see
+ * <reservoir-warm-start>) the initial states of all the graphs are built
+ * before the encodings, so they don't depend on the threads too.
+ *
+ * Returns true if the fixed point is reached for all the graphs, false
+ * otherwise. A moka::GenericException will be thrown if the encoding of a
+ * graph throws an exception.
+ */
+bool GraphEsnSom::encodeGraphs
+(
+    const std::vector<const MultiLabeledGraph*>& inputs,
+    const std::vector<MultiLabeledGraph*>& state_graphs,
+    std::vector<Uint>& iterations
+) const
+{
+  const Uint size = inputs.size();
+  iterations.assign(size, 0);
+  std::vector<char> converged(size, 0);
+
+  // Number of threads (at most one for each graph)
+  Uint no_threads = m_encoding_threads;
+  if (no_threads == 0)
+    no_threads = boost::thread::hardware_concurrency();
+  no_threads = std::max<Uint>(1, std::min<Uint>(no_threads, size));
+
+  // Initial states for the warm start (none if it is disabled)
+  std::vector<MultiLabeledGraph> initial_states;
+  std::vector<const MultiLabeledGraph*> initial_graphs;
+  if (m_label_states)
+  {
+    initial_states.resize(size);
+    initial_graphs.resize(size);
+    for (Uint i = 0; i < size; ++i)
+    {
+      buildInitialStates(*inputs[i], initial_states[i]);
+      initial_graphs[i] = &initial_states[i];
+    } // for i
+  } // if
+
+  ParallelEncoding encoding(
+      m_reservoir,
+      inputs,
+      initial_graphs,
+      state_graphs,
+      iterations,
+      converged);
+  if (!encoding.run(no_threads))
+    throw moka::GenericException(
+        "GraphEsnSom::encodeGraphs: encoding failed: " + encoding.getError());
+
+  if (no_threads > 1)
+  {
+    const std::vector<Uint>& thread_iterations =
+        encoding.getThreadIterations();
+    for (Uint t = 0; t < no_threads; ++t)
+      Log::vrb << "GraphEsnSom::encodeGraphs: thread " << t << ": "
+               << thread_iterations[t] << " iterations." << Log::endl;
+  } // if
+
+  bool return_value = true;
+  for (Uint i = 0; i < size; ++i)
+  {
+    if (!converged[i])
+    {
+      Log::vrb << "GraphEsnSom::encodeGraphs: reached the maximum number of "
+               << "iterations on the graph " << i << " (the fixed point has "
+               << "not been reached)." << Log::endl;
+      return_value = false;
+    }
+  } // for i
+
+  return return_value;
+} // method encodeGraphs
+
 /**
  * Method encodingProcess
  *
  * Given an input graph computes the encoding process by using the reservoir
- * and return the resulting state graph.
+ * and return the resulting state graph. If the warm start is enabled (see
+ * <reservoir-warm-start>) the encoding starts from the per-label states.
  */
 const MultiLabeledGraph& GraphEsnSom::encodingProcess
 (
     const MultiLabeledGraph& input
 )
 {
-  m_reservoir.encoding(input);
+  MultiLabeledGraph initial_graph;
+  if (buildInitialStates(input, initial_graph))
+    m_reservoir.encoding(input, initial_graph);
+  else
+    m_reservoir.encoding(input);
+
   return m_reservoir.getLastStateGraph();
 } // method encodingProcess
 
+/**
+ * Method initLabelStates
+ *
+ * Computes the per-label states for the warm start (see
+ * <reservoir-warm-start>) from the state graphs of the training graphs, that
+ * are encoded from the null states since the per-label states are not
+ * computed yet: the state of each atom symbol is the mean of the states of
+ * the vertices with such symbol (the vertices without the atom symbol label
+ * share the mean of their states). The states are computed once at each
+ * init and they are not changed by the following encodings, so the result
+ * of an encoding doesn't depend on the graphs encoded before it (nor on the
+ * number of threads).
+ */
+void GraphEsnSom::initLabelStates
+(
+    const MultiLabeledGraphDataset& training_set,
+    const std::vector<MultiLabeledGraph*>& state_graphs
+)
+{
+  typedef std::map<std::string, Uint> LabelCounts;
+
+  LabelStates& label_states = *m_label_states;
+  LabelCounts label_counts;
+
+  // Sums the states of each atom symbol in the training set order
+  for (Uint i = 0; i < state_graphs.size(); ++i)
+  {
+    const MultiLabeledGraph& input = training_set.trAt(i).getInput();
+    const Uint label = atomSymbolLabel(input);
+    for (Uint n = 0; n < state_graphs[i]->getSize(); ++n)
+    {
+      const std::string& symbol = atomSymbol(input, label, n);
+      Vector& state = label_states[symbol];
+      if (state.n_elem == 0)
+        state.zeros(m_reservoir.getStateSize());
+      state += state_graphs[i]->getVertexElement(n);
+      ++label_counts[symbol];
+    } // for n
+  } // for i
+
+  LabelStates::iterator it = label_states.begin();
+  for (/* nop */; it != label_states.end(); ++it)
+    it->second /= label_counts[it->first];
+
+  return;
+} // method initLabelStates
+
 /**
  * Method initResultsContainers
  *
@@ -2098,13 +2768,50 @@ void GraphEsnSom::parseParameters()
   m_reservoir.setReservoirSize(parameters.getUint("reservoir-size"));
   m_reservoir.setReservoirConnectivity(
       parameters.getReal("reservoir-connectivity", 1.0));
+  m_reservoir.setSparseThreshold(
+      parameters.getReal("reservoir-sparse-threshold", 0.3));
   m_reservoir.setMaxDegree(parameters.getUint("reservoir-max-degree"));
   m_reservoir.setInputScaling(
       parameters.getReal("reservoir-input-scaling", 0.1));
   m_reservoir.setSigma(parameters.getReal("reservoir-sigma", 0.9));
+  m_reservoir.setNormTolerance(
+      parameters.getReal("reservoir-norm-tolerance", 0.0));
+  m_reservoir.setEnsembleSize(
+      parameters.getUint("reservoir-ensemble-size", 1));
   m_reservoir.setEpsilon(parameters.getReal("reservoir-epsilon", 1e-2));
   m_reservoir.setMaxIterations(
       parameters.getUint("reservoir-max-iters", 10000));
+  m_encoding_threads = parameters.getUint("encoding-threads", 1);
+
+  m_reservoir.setEncodingMode(Reservoir::vertex_encoding); // default value
+  if (parameters.contains("reservoir-encoding")) try
+  {
+    m_reservoir.setEncodingMode(
+        Reservoir::strToEncm(parameters.get("reservoir-encoding")));
+  }
+  catch(std::exception& ex)
+  { /* leave the default value */ }
+
+  m_reservoir.setSolver(Reservoir::picard_solver); // default value
+  if (parameters.contains("reservoir-solver")) try
+  {
+    m_reservoir.setSolver(
+        Reservoir::strToSolv(parameters.get("reservoir-solver")));
+  }
+  catch(std::exception& ex)
+  { /* leave the default value */ }
+  m_reservoir.setAndersonDepth(
+      parameters.getUint("reservoir-anderson-depth", 5));
+
+  m_reservoir.setPrecision(Math::double_precision); // default value
+  if (parameters.contains("reservoir-precision")) try
+  {
+    m_reservoir.setPrecision(
+        Math::strToPrec(parameters.get("reservoir-precision")));
+  }
+  catch(std::exception& ex)
+  { /* leave the default value */ }
+  m_reservoir.setFastTanh(parameters.getBool("reservoir-fast-tanh", false));
 
   // SOM parameters
   m_som_load_file = parameters.get("som-load-file", "");
@@ -2170,6 +2877,11 @@ void GraphEsnSom::parseParameters()
     if (parameters.contains("som-sigma-fin-3"))
       m_som.setSigmaFinal3(parameters.getReal("som-sigma-fin-3"));
 
+    // SOM local winner unit search (phases 2 and 3)
+    if (parameters.contains("som-local-search-radius"))
+      m_som.setLocalSearchRadius(
+          parameters.getUint("som-local-search-radius"));
+
     // SOM training type
     if (parameters.contains("som-training-type"))
       m_som_training_type = parameters.get("som-training-type");
@@ -2178,6 +2890,18 @@ void GraphEsnSom::parseParameters()
 
   } // if (m_som_load_file.empty())
 
+  // SOM precision (also for a SOM loaded from file)
+  m_som.setPrecision(Math::double_precision); // default value
+  if (parameters.contains("som-precision")) try
+  {
+    m_som.setPrecision(Math::strToPrec(parameters.get("som-precision")));
+  }
+  catch(std::exception& ex)
+  { /* leave the default value */ }
+
+  // SOM nearest neighbor index (also for a SOM loaded from file)
+  m_som.setIndexedSearch(parameters.getBool("som-indexed-search", false));
+
   // SOM save files
   m_som_save_file = parameters.get("som-save-file");
   m_som_data_save_file = parameters.get("som-data-save-file");
@@ -2479,8 +3203,11 @@ bool GraphEsnSom::saveUnitInfo
   // Number of labels: each vertex must have the same number of labels
   Uint n_labels = state_graphs.back().getLabelNameSize();
 
-  // Labeling process: for each vertex label is built a label map.
-  typedef std::vector< std::vector< std::map<std::string, Uint> > > LabelMap;
+  // Labeling process: for each vertex label is built a label map, that
+  // counts the labels by their pool and their id in it (see
+  // LabelSet::getLabelId).
+  typedef std::pair<const LabelSet::Pool*, Uint> LabelKey;
+  typedef std::vector< std::vector< std::map<LabelKey, Uint> > > LabelMap;
   std::vector<LabelMap> label_maps(n_labels);
 
   // Init each label map
@@ -2493,7 +3220,7 @@ bool GraphEsnSom::saveUnitInfo
 
   // Fill label maps
   std::list<MultiLabeledGraph>::const_iterator graph = state_graphs.begin();
-  typename MultiLabeledGraph::Vertices::const_iterator vertex;
+  std::vector<SuperSOM::UnitIndex> winners;
 
   for (/* nop */; graph != state_graphs.end(); ++graph)
   {
@@ -2505,32 +3232,30 @@ bool GraphEsnSom::saveUnitInfo
       return false;
     }
 
-    vertex = graph->getVertexBegin();
-    for (/* nop */; vertex != graph->getVertexEnd(); ++vertex)
+    // Get the winner units
+    winnerUnits(*graph, winners);
+
+    const MultiLabeledGraph::View view(*graph);
+    for (Uint vertex = 0; vertex < view.getSize(); ++vertex)
     {
+      const MultiLabeledGraph::ItemType& item = view.getVertexItem(vertex);
+
       // Check the number of labels in the vertex
-      if (vertex->getItem().size() != n_labels)
+      if (item.size() != n_labels)
       {
         Log::err << "GraphEsnSom::saveUnitInfo: wrong number of labels in "
                  << "one vertex. The process is interrupted." << Log::endl;
         return false;
       }
 
-      // Get the winner unit
-      SuperSOM::UnitIndex wu = m_som.winnerUnit(vertex->getElement());
+      const SuperSOM::UnitIndex& wu = winners[vertex];
 
       // Update the map for each labels
       for (size_t m = 0; m < n_labels; ++m)
       {
-        std::string label_value = vertex->getItem().at(m);
-
-        if (!label_value.empty())
-        {
-          if (label_maps[m][wu.first][wu.second].count(label_value))
-            label_maps[m][wu.first][wu.second][label_value] += 1;
-          else
-            label_maps[m][wu.first][wu.second][label_value] = 1;
-        }
+        if (!item[m].empty())
+          ++label_maps[m][wu.first][wu.second][
+              LabelKey(item.getPool(), item.getLabelId(m))];
       } // for m
 
     } // for vertex
@@ -2552,8 +3277,8 @@ bool GraphEsnSom::saveUnitInfo
       // weight
       if (m_state_vect_type == reservoir_state_vect)
       {
-        size_t first_c = (i * m_reservoir.getReservoirSize()) + 1;
-        size_t last_c = (i + 1) * m_reservoir.getReservoirSize();
+        size_t first_c = (i * m_reservoir.getStateSize()) + 1;
+        size_t last_c = (i + 1) * m_reservoir.getStateSize();
         if (last_c - first_c != m_som.getCodebookSize())
         {
           Log::err << "GraphEsnSom::saveUnitInfo: wrong state vector size. "
@@ -2574,8 +3299,18 @@ bool GraphEsnSom::saveUnitInfo
       {
         ofs << state_graphs.back().getLabelName(lbl) << std::endl;
 
+        // Back from the ids to the labels (in order to sort them as strings
+        // when their counts are equal), merging the same label of different
+        // pools
+        std::map<std::string, Uint> label_counts;
+        std::map<LabelKey, Uint>::const_iterator id_count =
+            label_maps[lbl][row][col].begin();
+        for (/* nop */; id_count != label_maps[lbl][row][col].end(); ++id_count)
+          label_counts[id_count->first.first->getLabel(
+              id_count->first.second)] += id_count->second;
+
         std::list< std::pair<std::string, Uint> > label_values;
-        Global::sortMapBySecond(label_maps[lbl][row][col], label_values);
+        Global::sortMapBySecond(label_counts, label_values);
 
         ofs << label_values.size() << std::endl;
 
@@ -2691,6 +3426,36 @@ std::string GraphEsnSom::stvToStr(const StateVectorType& stv) const
   // return "";
 } // method stvToStr
 
+/**
+ * Method winnerUnits
+ *
+ * Fills the vector WINNERS with the winner unit of each vertex of the passed
+ * state graph (in the order of the verteces), computed for all the verteces
+ * at once through the batch search of the SOM (see SuperSOM::winnerUnits).
+ * With the single precision search of the SOM (see <som-precision>) the
+ * states are gathered directly in a single precision matrix.
+ */
+void GraphEsnSom::winnerUnits(
+    const structure::MultiLabeledGraph& state_graph,
+    std::vector<SuperSOM::UnitIndex>& winners) const
+{
+  if (m_som.getPrecision() == Math::single_precision &&
+      !m_som.isIndexedSearch())
+  {
+    Math::SingleMatrix states;
+    gatherStates(state_graph, states);
+    m_som.winnerUnits(states, winners);
+  }
+  else
+  {
+    Matrix states;
+    gatherStates(state_graph, states);
+    m_som.winnerUnits(states, winners);
+  } // if-else
+
+  return;
+} // method winnerUnits
+
 /**
  * Method writeInstanceEquation
  *
@@ -2708,7 +3473,7 @@ bool GraphEsnSom::writeInstanceEquation(
     return false;
   }
 
-  if (state_graph.getElementsSize() != getReservoirSize())
+  if (state_graph.getElementsSize() != m_reservoir.getStateSize())
   {
     Log::err << "GraphEsnSom::writeInstanceEquation: wrong vertex size in the "
              << "state graph. :(" << Log::endl;
@@ -2724,12 +3489,11 @@ bool GraphEsnSom::writeInstanceEquation(
   std::map<size_t, Uint>::iterator cm_it;
 
   // For each vertex is retrived its weight index, and stored the winner unit.
+  winnerUnits(state_graph, winner_unit);
   for (Uint vertex = 0; vertex < n_vertices; ++vertex)
   {
-    SuperSOM::UnitIndex wu =
-        m_som.winnerUnit(state_graph.getVertexElement(vertex));
+    const SuperSOM::UnitIndex& wu = winner_unit[vertex];
     weights_index[vertex] = (wu.first * m_som.getNoColumns()) + wu.second;
-    winner_unit[vertex] = wu;
     cm_it = collision_map.find(weights_index[vertex]);
     if (cm_it == collision_map.end())
       collision_map[weights_index[vertex]] = 1;
@@ -2809,7 +3573,7 @@ bool GraphEsnSom::writeVerticesInfo
     return false;
   }
 
-  if (state_graph.getElementsSize() != getReservoirSize())
+  if (state_graph.getElementsSize() != m_reservoir.getStateSize())
   {
     Log::err << "GraphEsnSom::writeVerticesInfo: wrong vertex size in the "
              << "state graph. :(" << Log::endl;
@@ -2824,12 +3588,11 @@ bool GraphEsnSom::writeVerticesInfo
   std::map<size_t, Uint>::iterator cm_it;
 
   // For each vertex is retrived its weight index, and stored the winner unit.
+  winnerUnits(state_graph, winner_unit);
   for (Uint vertex = 0; vertex < n_vertices; ++vertex)
   {
-    SuperSOM::UnitIndex wu =
-        m_som.winnerUnit(state_graph.getVertexElement(vertex));
+    const SuperSOM::UnitIndex& wu = winner_unit[vertex];
     weights_index[vertex] = (wu.first * m_som.getNoColumns()) + wu.second;
-    winner_unit[vertex] = wu;
     cm_it = collision_map.find(weights_index[vertex]);
     if (cm_it == collision_map.end())
       collision_map[weights_index[vertex]] = 1;
@@ -3127,8 +3890,8 @@ void GraphEsnSom::writeSelectedFragments
       Real weight = 0.0;
       if (m_state_vect_type == reservoir_state_vect)
       {
-        size_t first_c = (i * m_reservoir.getReservoirSize()) + 1;
-        size_t last_c = (i + 1) * m_reservoir.getReservoirSize();
+        size_t first_c = (i * m_reservoir.getStateSize()) + 1;
+        size_t last_c = (i + 1) * m_reservoir.getStateSize();
         if (last_c - first_c != m_som.getCodebookSize())
         {
           Log::err << "GraphEsnSom::writeSelectedFragments: wrong state vector "
@@ -1,7 +1,11 @@
 #ifndef MOKA_MODEL_GRAPHESNSOM_H
 #define MOKA_MODEL_GRAPHESNSOM_H
 
+#include <map>
+#include <string>
+#include <utility>
 #include <vector>
+#include <boost/shared_ptr.hpp>
 #include <boost/lambda/bind.hpp>
 #include <boost/lambda/lambda.hpp>
 #include <moka/dataset/multilabeledgraphdataset.h>
@@ -36,6 +40,10 @@ namespace model {
  *       connectivity value of 0.4 is setted this mean that there are only
  *       the 40% of connections; in other words the reservoir matrix What is
  *       sparse to 40%.
+ *   - <reservoir-sparse-threshold>: when the reservoir connectivity is lower
+ *       than this value (in [0,1]) the reservoir matrix What is also stored
+ *       in a sparse format, that is used in the encoding process. By default
+ *       is 0.3, set 0 to use always the dense matrix.
  *   - <reservoir-input-scaling>: the (positive) real number w_in: the weights
  *       of the input-to-reservoir connections are initialized in the range
  *       [-w_in, +w_in]; by default is 0.1.
@@ -48,11 +56,84 @@ namespace model {
  *       sigma) is taken as in [2] and different from that in [1]. In this case
  *       is taken the local contractivity while in [1] is taken a "global"
  *       contractivity.
+ *   - <reservoir-norm-tolerance>: the reservoir weights are scaled by the
+ *       2-norm of the random reservoir matrix. If this value is 0 (the
+ *       default) the 2-norm is computed exactly (by a SVD, O(N_r^3)),
+ *       otherwise it is replaced by a certified upper bound within this
+ *       relative tolerance (e.g. 1e-6), computed through the Lanczos
+ *       iteration (see GraphReservoir): the contraction coefficient is held
+ *       as with the exact norm.
+ *   - <reservoir-ensemble-size>: number K of reservoirs encoded together in
+ *       a single traversal of each graph (see GraphReservoir). The member m
+ *       is the reservoir built with the seed <reservoir-rseed> + m; the state
+ *       of each vertex is the concatenation of the K member states (K * Nr
+ *       values), so the SOM and the readout work on the ensemble states. By
+ *       default is 1.
  *   - <reservoir-epsilon>: threshold of the fixed point in the encoding
  *       process [2]. By default is 1e-2.
  *   - <reservoir-max-iters>: sets the max number of iterations in the encoding
  *       process in order to avoid infinite loop if the computation does not
  *       converge. By default is 10000.
+ *   - <reservoir-encoding>: the way the encoding process is computed, it
+ *       doesn't change the result (within epsilon) but only the computation
+ *       time:
+ *         - "vertex": the state of each vertex is computed separately (one
+ *             matrix-vector product for each edge). This is the default.
+ *         - "batched": the states of all the vertices of a graph are computed
+ *             together at each iteration (one matrix-matrix product and a
+ *             sparse product with the graph adjacency matrix).
+ *         - "active-set": as "vertex", but the state of a vertex is
+ *             recomputed only while some of its neighbors is still changing
+ *             by more than epsilon, with a final sweep over all the vertices
+ *             (same result within epsilon).
+ *         - "fixed-size": as "vertex", through a kernel specialized on the
+ *             reservoir sizes 10, 16, 20, 25, 30, 32, 40, 48, 50 and 64 (same
+ *             result up to the floating point rounding). With the other sizes
+ *             or with a sparse reservoir matrix "vertex" is used instead.
+ *   - <reservoir-solver>: the method used to compute the fixed point of the
+ *       encoding process, all of them reach the same fixed point (within the
+ *       threshold epsilon):
+ *         - "picard": the fixed point iteration x_t = F(x_{t-1}), computed as
+ *             setted by <reservoir-encoding>. This is the default.
+ *         - "anderson": Anderson acceleration of the fixed point iteration,
+ *             using the last <reservoir-anderson-depth> iterates.
+ *         - "gauss-seidel": the states of the vertices are updated in place,
+ *             each one using the states of its neighbors already updated.
+ *   - <reservoir-anderson-depth>: number of previous iterates used by the
+ *       "anderson" solver. By default is 5.
+ *   - <reservoir-precision>: floating point precision of the encoding process,
+ *       "double" (the default) or "single". In single precision the Picard
+ *       iteration ("vertex" and "batched" encodings) is computed on single
+ *       precision matrices, the other encodings and solvers always use the
+ *       double precision. The input drive and the initial states are still
+ *       computed in double precision and converted, and the resulting state
+ *       graphs are converted back to double precision. The epsilon should be
+ *       much larger than 1e-6.
+ *   - <reservoir-fast-tanh>: if "true" the double precision encodings use a
+ *       vectorised approximation of the tanh (see util::FastTanh), with an
+ *       absolute error lower than 1e-15 on each state component, instead of
+ *       std::tanh. By default is "false".
+ *   - <encoding-threads>: number of threads used to encode the training
+ *       graphs (they share the same reservoir). By default is 1, set 0 to use
+ *       a thread for each hardware thread. The results don't depend on this
+ *       value.
+ *   - <reservoir-state-cache>: if "true" the state graph of each instance is
+ *       stored the first time it is computed, and then reused in the
+ *       following calls of train, test and testOn (also after a reset, for
+ *       example in the folds of a cross validation). The states are stored by
+ *       dataset generation (see Dataset::getGeneration), instance (not by
+ *       instance id, since the ids can be repeated) and reservoir seed, and
+ *       they are discarded at each init. By default is "false".
+ *   - <reservoir-warm-start>: if "true" the encoding of each graph starts from
+ *       per-label states instead of the null states: the first training
+ *       after each init encodes its graphs from the null states, and each
+ *       atom symbol (see <add-lbl-atom-symbol> in MultiLabeledGraphDataset)
+ *       takes the mean state of the training vertices with such symbol. The
+ *       fixed point is the same (within epsilon), but the following
+ *       encodings (e.g. in the test and in the folds of a cross validation)
+ *       require fewer iterations. The per-label states are not changed until
+ *       the next init, so the results of the following encodings don't
+ *       depend on their order. By default is "false".
  *   - <reservoir-rseed>: the random number generator seed (optional). Random
  *       numbers are used in the initialization of the input weights and
  *       reservoir weights. By setting all the same parameters and the same
@@ -85,8 +166,26 @@ namespace model {
  *   - <som-sigma-3>: radius for the last phase / supervised train (optional).
  *   - <som-sigma-fin-3>: final radius in for the last phase / supervised
  *       train (optional).
+ *   - <som-local-search-radius>: if greater than 0, in the fine tune and in
+ *       the last phase the winner unit of each vertex is searched only
+ *       within this radius from its previous winner unit, and on the whole
+ *       map when the local search is inconclusive (optional). Faster on
+ *       large maps, but the winner unit may be approximated. By default is 0
+ *       (the winner unit is always searched on the whole map).
  *   - <som-act-fun-gamma>: parameter gamma for the unit activation function:
  *       f(x) = 1 / (1 + (x / gamma)^2). By default is 0.01.
+ *   - <som-precision>: floating point precision of the winner unit search in
+ *       the trained map (i.e. in the state mapping), "double" (the default) or
+ *       "single". In single precision the states of each graph are gathered
+ *       in a single precision matrix and compared with a single precision
+ *       copy of the codebooks. The state graphs, the codebooks, the training
+ *       and the readout always use the double precision.
+ *   - <som-indexed-search>: if "true" the winner unit search in the trained
+ *       map (i.e. in the state mapping) goes through an exact nearest
+ *       neighbor index built over the codebooks (see SuperSOM), instead of
+ *       comparing each state with all the units. The results are the same,
+ *       but the search is faster on large maps. Overrides <som-precision>. By
+ *       default is "false".
  *   - <som-load-file>: you can load a previous saved SOM from file. In
  *       this case all the above parameters are ignored.
  *   - <som-save-file>: if you want save the map after the training, you
@@ -216,6 +315,16 @@ class GraphEsnSom : public Model
       reservoir_state_vect
     };
 
+    // Reservoir states cache: (dataset generation, (instance input graph,
+    // reservoir seed)) -> (state graph, encoding iterations)
+    typedef std::pair<const structure::MultiLabeledGraph*, Uint> StateCacheId;
+    typedef std::pair<Uint, StateCacheId> StateCacheKey;
+    typedef std::pair<structure::MultiLabeledGraph, Uint> StateCacheEntry;
+    typedef std::map<StateCacheKey, StateCacheEntry> StateCache;
+
+    // Per-label states for the warm start: atom symbol -> mean state
+    typedef std::map<std::string, Vector> LabelStates;
+
     // Training set (bind)
     const dataset::MultiLabeledGraphDataset *m_trainingset;
 
@@ -224,6 +333,13 @@ class GraphEsnSom : public Model
 
     // Reservoir
     Reservoir m_reservoir;
+    Uint m_encoding_threads;
+
+    // Reservoir states cache (shared with the backup copy)
+    boost::shared_ptr<StateCache> m_state_cache;
+
+    // Per-label states for the warm start (shared with the backup copy)
+    boost::shared_ptr<LabelStates> m_label_states;
 
     // SOM
     ml::SuperSOM m_som;
@@ -245,9 +361,27 @@ class GraphEsnSom : public Model
     std::string m_unit_info_save_file;
 
     // Private methods
+    bool buildInitialStates(
+        const structure::MultiLabeledGraph& input,
+        structure::MultiLabeledGraph& initial_graph) const;
+
     bool checkDatasetCompatibility(
         const dataset::MultiLabeledGraphDataset& ds);
 
+    const StateCacheEntry* cachedStates(
+        const dataset::Dataset& ds,
+        const structure::MultiLabeledGraph& input) const;
+
+    const structure::MultiLabeledGraph& cachedEncodingProcess(
+        const dataset::Dataset& ds,
+        const structure::MultiLabeledGraph& input);
+
+    void cacheStates(
+        const dataset::Dataset& ds,
+        const structure::MultiLabeledGraph& input,
+        const structure::MultiLabeledGraph& state_graph,
+        Uint iterations);
+
     bool checkParameters();
 
     void collectReservoirStates(
@@ -263,9 +397,18 @@ class GraphEsnSom : public Model
     void computeStateVector(
         const structure::MultiLabeledGraph& state_graph);
 
+    bool encodeGraphs(
+        const std::vector<const structure::MultiLabeledGraph*>& inputs,
+        const std::vector<structure::MultiLabeledGraph*>& state_graphs,
+        std::vector<Uint>& iterations) const;
+
     const structure::MultiLabeledGraph& encodingProcess(
         const structure::MultiLabeledGraph& input);
 
+    void initLabelStates(
+        const dataset::MultiLabeledGraphDataset& training_set,
+        const std::vector<structure::MultiLabeledGraph*>& state_graphs);
+
     void initResultsContainers();
 
     void initTestResultsContainer();
@@ -300,6 +443,10 @@ class GraphEsnSom : public Model
 
     std::string stvToStr(const StateVectorType& stv) const;
 
+    void winnerUnits(
+        const structure::MultiLabeledGraph& state_graph,
+        std::vector<ml::SuperSOM::UnitIndex>& winners) const;
+
     bool writeInstanceEquation(
         std::ostream& os,
         const structure::MultiLabeledGraph& state_graph) const;
@@ -32,10 +32,12 @@ class Graph
 {
   public:
     class Vertex;
+    class View;
     typedef Global::Uint Uint;
     typedef Global::Real Real;
     typedef ItemTemplate ItemType;
     typedef util::Math::Vector Vector;
+    typedef std::vector<Uint> Neighbors;
     typedef std::vector<Vertex> Vertices;
 
     Graph();
@@ -72,11 +74,14 @@ class Graph
         std::vector<Uint> *neighs = NULL);
     virtual void setVertexElement(Uint v, const Vector& value);
     virtual void setVertexItem(Uint v, const ItemTemplate& item);
+    virtual void swap(Graph& g);
 
   private:
     Vertices m_vertices;
     Uint m_elements_size;
 
+    void resizeVertices(Uint size);
+
 }; // class Graph
 
 /**
@@ -199,6 +204,82 @@ class Graph<ItemTemplate>::Vertex
 
 }; // class Graph::Vertex
 
+/**
+ * Class Graph::View
+ *
+ * Read only view of a graph for the internal algorithms (e.g. the encoding
+ * of ml::GraphReservoir). The accessors have the same meaning of the ones of
+ * Graph, but they are not virtual (then they can be inlined) and they don't
+ * check the indexes: the graph must be consistent (see checkConsistence,
+ * that is checked once when a graph is read) and the indexes in range. The
+ * view is valid until the graph is changed (setVertexElement apart).
+ */
+template <typename ItemTemplate>
+class Graph<ItemTemplate>::View
+{
+  public:
+    typedef typename Neighbors::const_iterator NeighborIterator;
+
+    //! Constructor
+    explicit View(const Graph& graph) :
+      m_vertices(graph.m_vertices.empty() ? NULL : &graph.m_vertices[0]),
+      m_size(graph.m_vertices.size())
+    { }
+
+    //! Element of the i-th neighbor of the vertex v
+    const Vector& getNeighbor(Uint v, Uint i) const
+    {
+      return m_vertices[m_vertices[v].getNeighbors()[i]].getElement();
+    }
+
+    //! Index of the i-th neighbor of the vertex v
+    Uint getNeighborIndex(Uint v, Uint i) const
+    {
+      return m_vertices[v].getNeighbors()[i];
+    }
+
+    //! Iterator to the first neighbor index of the vertex v
+    NeighborIterator getNeighborsBegin(Uint v) const
+    {
+      return m_vertices[v].getNeighbors().begin();
+    }
+
+    //! Iterator referring to the past-the-end neighbor index of the vertex v
+    NeighborIterator getNeighborsEnd(Uint v) const
+    {
+      return m_vertices[v].getNeighbors().end();
+    }
+
+    //! Number of neighbors of the vertex v
+    Uint getNeighborsSize(Uint v) const
+    {
+      return m_vertices[v].getNeighbors().size();
+    }
+
+    //! Number of verteces
+    Uint getSize() const
+    {
+      return m_size;
+    }
+
+    //! Element of the vertex v
+    const Vector& getVertexElement(Uint v) const
+    {
+      return m_vertices[v].getElement();
+    }
+
+    //! Item of the vertex v
+    const ItemTemplate& getVertexItem(Uint v) const
+    {
+      return m_vertices[v].getItem();
+    }
+
+  private:
+    const Vertex *m_vertices;
+    Uint m_size;
+
+}; // class Graph::View
+
 } // namespace structure
 } // namespace moka
 
@@ -3,6 +3,7 @@
 
 #include "graph.h"
 
+#include <algorithm>
 #include <moka/exception.h>
 
 namespace moka {
@@ -61,19 +62,22 @@ Graph<T>::~Graph()
  * structure from the graph g and inits the elements with the passed element.
  * The results is a graph with the same structure of the passed graph g (and
  * same labels) and with verteces elements all equals to the argument elem.
+ *
+ * The vertices already present in this graph are reused (their items,
+ * elements and neighbors are overwritten by copy), so building again a graph
+ * with the same sizes doesn't allocate memory.
  */
 template <typename T>
 Graph<T>& Graph<T>::buildFrom(const Graph<T>& g, const Vector& elem)
 {
-  m_vertices.clear();
-  m_vertices.reserve(g.m_vertices.size());
+  resizeVertices(g.m_vertices.size());
+  typename Vertices::iterator it = m_vertices.begin();
   typename Vertices::const_iterator g_it = g.m_vertices.begin();
-  for (/* nop */; g_it != g.m_vertices.end(); ++g_it)
+  for (/* nop */; g_it != g.m_vertices.end(); ++g_it, ++it)
   {
-    m_vertices.push_back(Vertex());
-    m_vertices.back().setItem(g_it->getItem());
-    m_vertices.back().setElement(elem);
-    m_vertices.back().setNeighbors(g_it->getNeighbors());
+    it->setItem(g_it->getItem());
+    it->setElement(elem);
+    it->setNeighbors(g_it->getNeighbors());
   }
   m_elements_size = elem.n_rows;
   return (*this);
@@ -308,15 +312,18 @@ Uint Graph<T>::maxDegree() const
 
 /**
  * operator =
+ *
+ * As buildFrom, the vertices already present in this graph are reused (their
+ * items, elements and neighbors are overwritten by copy).
  */
 template <typename T>
 Graph<T>& Graph<T>::operator=(const Graph<T>& g)
 {
-  m_vertices.clear();
-  m_vertices.reserve(g.m_vertices.size());
-  typename Vertices::const_iterator v_it = g.m_vertices.begin();
-  for (/* nop */; v_it != g.m_vertices.end(); ++v_it)
-    m_vertices.push_back(Vertex(*v_it));
+  if (this == &g)
+    return (*this);
+
+  resizeVertices(g.m_vertices.size());
+  std::copy(g.m_vertices.begin(), g.m_vertices.end(), m_vertices.begin());
   m_elements_size = g.m_elements_size;
   return (*this);
 } // operator=
@@ -467,6 +474,43 @@ void Graph<ItemTemplate>::setVertexItem(Uint v, const ItemTemplate& item)
   return;
 } // method setVertexItem
 
+/**
+ * Method swap
+ *
+ * Swaps the verteces (and the elements size) of this graph with the ones of
+ * the graph g, in constant time: the verteces are not copied (e.g. in order
+ * to take a graph from a buffer that can then reuse the other graph).
+ */
+template <typename T>
+void Graph<T>::swap(Graph<T>& g)
+{
+  m_vertices.swap(g.m_vertices);
+  std::swap(m_elements_size, g.m_elements_size);
+  return;
+} // method swap
+
+// ===============
+// PRIVATE METHODS
+// ===============
+
+/**
+ * Method resizeVertices
+ *
+ * Resizes the verteces vector to "size" verteces, keeping the verteces
+ * already present if it is not reallocated (otherwise they are removed
+ * before, since the reallocation would copy all of them).
+ */
+template <typename T>
+void Graph<T>::resizeVertices(Uint size)
+{
+  if (m_vertices.size() == size)
+    return;
+  if (size > m_vertices.capacity())
+    m_vertices.clear();
+  m_vertices.resize(size);
+  return;
+} // method resizeVertices
+
 } // namespace structure
 } // namespace moka
 
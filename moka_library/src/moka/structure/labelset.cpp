@@ -0,0 +1,324 @@
+#include "labelset.h"
+
+#include <boost/thread/locks.hpp>
+#include <moka/exception.h>
+
+namespace moka {
+namespace structure {
+
+// ==============
+// PUBLIC METHODS
+// ==============
+
+/**
+ * Constructor
+ *
+ * Builds an empty label set (without a pool).
+ */
+LabelSet::LabelSet() :
+  m_entry(&emptyEntry())
+{ }
+
+/**
+ * Constructor
+ *
+ * Builds the label set of the passed labels in a new pool.
+ */
+LabelSet::LabelSet(const Labels& labels) :
+  m_entry(&emptyEntry())
+{
+  if (labels.empty())
+    return;
+
+  m_pool.reset(new Pool());
+  m_entry = &m_pool->intern(labels);
+}
+
+/**
+ * Constructor
+ *
+ * Builds the label set of the passed labels in the passed pool, adding it to
+ * the pool if no label set with the same labels was built on it before (if
+ * the pool is null the label set is built in a new pool).
+ */
+LabelSet::LabelSet
+(
+    const Labels& labels,
+    const boost::shared_ptr<Pool>& pool
+) :
+  m_pool(pool),
+  m_entry(&emptyEntry())
+{
+  if (!m_pool)
+  {
+    if (labels.empty())
+      return;
+    m_pool.reset(new Pool());
+  }
+
+  boost::lock_guard<boost::mutex> lock(m_pool->m_mutex);
+  m_entry = &m_pool->intern(labels);
+}
+
+/**
+ * Method at
+ *
+ * Returns the i-th label (throws std::out_of_range if i is out of range).
+ */
+const std::string& LabelSet::at(size_type i) const
+{
+  return m_entry->labels.at(i);
+} // method at
+
+/**
+ * Method begin
+ *
+ * Returns an iterator to the first label.
+ */
+LabelSet::const_iterator LabelSet::begin() const
+{
+  return m_entry->labels.begin();
+} // method begin
+
+/**
+ * Method empty
+ *
+ * Returns true if the label set has no labels.
+ */
+bool LabelSet::empty() const
+{
+  return m_entry->labels.empty();
+} // method empty
+
+/**
+ * Method end
+ *
+ * Returns an iterator referring to the past-the-end label.
+ */
+LabelSet::const_iterator LabelSet::end() const
+{
+  return m_entry->labels.end();
+} // method end
+
+/**
+ * Method getId
+ *
+ * Returns the id of the label set in its pool: two label sets of the same
+ * pool have the same id if and only if they have the same labels.
+ */
+LabelSet::Uint LabelSet::getId() const
+{
+  return m_entry->id;
+} // method getId
+
+/**
+ * Method getLabelId
+ *
+ * Returns the id of the i-th label in the pool (not checked): two labels of
+ * the same pool have the same id if and only if they are equal strings, and
+ * the label can be got back by Pool::getLabel.
+ */
+LabelSet::Uint LabelSet::getLabelId(size_type i) const
+{
+  return m_entry->label_ids[i];
+} // method getLabelId
+
+/**
+ * Method getLabels
+ *
+ * Returns the labels as a vector.
+ */
+const LabelSet::Labels& LabelSet::getLabels() const
+{
+  return m_entry->labels;
+} // method getLabels
+
+/**
+ * Method getPool
+ *
+ * Returns the pool of the label set (NULL for the empty label sets built
+ * without a pool).
+ */
+const LabelSet::Pool *LabelSet::getPool() const
+{
+  return m_pool.get();
+} // method getPool
+
+/**
+ * Operator const Labels&
+ *
+ * See getLabels.
+ */
+LabelSet::operator const Labels&() const
+{
+  return m_entry->labels;
+} // operator const Labels&
+
+/**
+ * Operator []
+ *
+ * Returns the i-th label (not checked).
+ */
+const std::string& LabelSet::operator[](size_type i) const
+{
+  return m_entry->labels[i];
+} // operator []
+
+/**
+ * Method size
+ *
+ * Returns the number of labels.
+ */
+LabelSet::size_type LabelSet::size() const
+{
+  return m_entry->labels.size();
+} // method size
+
+// ===============
+// PRIVATE METHODS
+// ===============
+
+/**
+ * Method emptyEntry
+ *
+ * Returns the entry of the empty label sets built without a pool.
+ */
+const LabelSet::Entry& LabelSet::emptyEntry()
+{
+  static const Entry entry = Entry();
+  return entry;
+} // method emptyEntry
+
+// ====================
+// CLASS LABELSET::POOL
+// ====================
+
+/**
+ * Constructor LabelSet::Pool
+ *
+ * Builds a pool with only the empty label set (id 0).
+ */
+LabelSet::Pool::Pool()
+{
+  intern(Labels());
+}
+
+/**
+ * Method Pool::getLabel
+ *
+ * Returns the label with the passed id (see LabelSet::getLabelId).
+ */
+const std::string& LabelSet::Pool::getLabel(Uint label_id) const
+{
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  if (label_id >= m_labels.size())
+    throw moka::GenericException("LabelSet::Pool::getLabel: id out of range.");
+  return m_labels[label_id];
+} // method getLabel
+
+/**
+ * Method Pool::getLabelSize
+ *
+ * Returns the number of distinct labels in the pool.
+ */
+LabelSet::Uint LabelSet::Pool::getLabelSize() const
+{
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  return m_labels.size();
+} // method getLabelSize
+
+/**
+ * Method Pool::getSize
+ *
+ * Returns the number of distinct label sets in the pool (the empty one
+ * included).
+ */
+LabelSet::Uint LabelSet::Pool::getSize() const
+{
+  boost::lock_guard<boost::mutex> lock(m_mutex);
+  return m_entries.size();
+} // method getSize
+
+/**
+ * Method Pool::intern
+ *
+ * Returns the entry of the passed labels, adding it if not present (the
+ * caller must hold the mutex, but on construction).
+ */
+const LabelSet::Entry& LabelSet::Pool::intern(const Labels& labels)
+{
+  std::map<const Labels*, const Entry*, PointeeLess>::const_iterator it =
+      m_entries_index.find(&labels);
+  if (it != m_entries_index.end())
+    return *it->second;
+
+  m_entries.push_back(Entry());
+  Entry& entry = m_entries.back();
+  entry.labels = labels;
+  entry.id = m_entries.size() - 1;
+  entry.label_ids.reserve(labels.size());
+  for (size_t i = 0; i < labels.size(); ++i)
+    entry.label_ids.push_back(internLabel(labels[i]));
+
+  m_entries_index[&entry.labels] = &entry;
+  return entry;
+} // method intern
+
+/**
+ * Method Pool::internLabel
+ *
+ * Returns the id of the passed label, adding it if not present (the caller
+ * must hold the mutex).
+ */
+LabelSet::Uint LabelSet::Pool::internLabel(const std::string& label)
+{
+  std::map<const std::string*, Uint, PointeeLess>::const_iterator it =
+      m_labels_index.find(&label);
+  if (it != m_labels_index.end())
+    return it->second;
+
+  m_labels.push_back(label);
+  m_labels_index[&m_labels.back()] = m_labels.size() - 1;
+  return m_labels.size() - 1;
+} // method internLabel
+
+// =========
+// OPERATORS
+// =========
+
+/**
+ * Operator ==
+ *
+ * Two label sets are equal if they have the same labels (compared by id if
+ * they are of the same pool).
+ */
+bool operator==(const LabelSet& a, const LabelSet& b)
+{
+  if (a.getPool() == b.getPool())
+    return a.getId() == b.getId();
+  return a.getLabels() == b.getLabels();
+} // operator ==
+
+/**
+ * Operator !=
+ */
+bool operator!=(const LabelSet& a, const LabelSet& b)
+{
+  return !(a == b);
+} // operator !=
+
+/**
+ * Operator <
+ *
+ * Orders the label sets lexicographically by their labels (as the vectors of
+ * the labels).
+ */
+bool operator<(const LabelSet& a, const LabelSet& b)
+{
+  if (a.getPool() == b.getPool() && a.getId() == b.getId())
+    return false;
+  return a.getLabels() < b.getLabels();
+} // operator <
+
+} // namespace structure
+} // namespace moka
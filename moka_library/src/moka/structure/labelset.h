@@ -0,0 +1,133 @@
+#ifndef MOKA_STRUCTURE_LABELSET_H
+#define MOKA_STRUCTURE_LABELSET_H
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <moka/global.h>
+
+namespace moka {
+namespace structure {
+
+/**
+ * Class LabelSet
+ *
+ * Represents an indexed collection of labels (strings) as an handle on an
+ * interned copy of it. The label sets and the single labels are stored once
+ * in a pool (see LabelSet::Pool), each with an integer id, and a LabelSet
+ * only keeps a pointer to its entry of the pool: two label sets of the same
+ * pool with the same labels share the same entry (so the same id), copying a
+ * label set doesn't allocate and the labels of the label sets of a pool can
+ * be compared (or counted) through their ids instead of comparing the
+ * strings.
+ *
+ * The pool is shared by the label sets built on it and it is released with
+ * the last of them: e.g. a MultiLabeledGraphDataset interns the labels of all
+ * its graphs in a pool of its own. A label set built without a pool gets a
+ * new pool. The ids are meaningful only within the same pool (see getPool),
+ * while label sets of different pools are compared by their labels.
+ *
+ * A LabelSet can be implicitly built from a std::vector<std::string>, and
+ * provides the read only interface of it (size, at, operator[], begin, end),
+ * so it can be used as the item of the verteces of a graph in place of the
+ * vector of labels (see MultiLabeledGraph).
+ */
+class LabelSet
+{
+  public:
+    typedef Global::Uint Uint;
+    typedef std::vector<std::string> Labels;
+    typedef Labels::const_iterator const_iterator;
+    typedef Labels::size_type size_type;
+
+    class Pool;
+
+    LabelSet();
+    LabelSet(const Labels& labels);
+    LabelSet(const Labels& labels, const boost::shared_ptr<Pool>& pool);
+
+    const std::string& at(size_type i) const;
+    const_iterator begin() const;
+    bool empty() const;
+    const_iterator end() const;
+    Uint getId() const;
+    Uint getLabelId(size_type i) const;
+    const Labels& getLabels() const;
+    const Pool *getPool() const;
+    operator const Labels&() const;
+    const std::string& operator[](size_type i) const;
+    size_type size() const;
+
+  private:
+    struct Entry
+    {
+      Labels labels;
+      std::vector<Uint> label_ids;
+      Uint id;
+    };
+
+    boost::shared_ptr<Pool> m_pool;
+    const Entry *m_entry;
+
+    static const Entry& emptyEntry();
+
+}; // class LabelSet
+
+/**
+ * Class LabelSet::Pool
+ *
+ * The pool of the interned label sets and labels, shared by the label sets
+ * built on it through a boost::shared_ptr. The entries are stored in deques
+ * so the pointers to them stay valid while the pool grows; the entry with id
+ * 0 is the empty label set. Adding the label sets and reading the labels are
+ * serialized by a mutex of the pool, so different pools don't contend.
+ */
+class LabelSet::Pool
+{
+  public:
+    Pool();
+
+    const std::string& getLabel(Uint label_id) const;
+    Uint getLabelSize() const;
+    Uint getSize() const;
+
+  private:
+    friend class LabelSet;
+
+    //! Compares the pointed objects (the indexes refer to the pool entries,
+    //! so each label set and each label is stored only once)
+    struct PointeeLess
+    {
+      template <typename Type>
+      bool operator()(const Type *a, const Type *b) const
+      {
+        return *a < *b;
+      }
+    };
+
+    std::deque<Entry> m_entries;
+    std::map<const Labels*, const Entry*, PointeeLess> m_entries_index;
+    std::deque<std::string> m_labels;
+    std::map<const std::string*, Uint, PointeeLess> m_labels_index;
+    mutable boost::mutex m_mutex;
+
+    const Entry& intern(const Labels& labels);
+    Uint internLabel(const std::string& label);
+
+    // Copy constructor and the assignment operator are turned off.
+    Pool(const Pool&);
+    Pool& operator=(const Pool&);
+
+}; // class LabelSet::Pool
+
+bool operator==(const LabelSet& a, const LabelSet& b);
+bool operator!=(const LabelSet& a, const LabelSet& b);
+bool operator<(const LabelSet& a, const LabelSet& b);
+
+} // namespace structure
+} // namespace moka
+
+#endif // MOKA_STRUCTURE_LABELSET_H
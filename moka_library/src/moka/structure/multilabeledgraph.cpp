@@ -83,9 +83,24 @@ Uint MultiLabeledGraph::getLabelNameSize() const
 /**
  * Method read
  *
- * Reads graph from input stream.
+ * Reads graph from input stream (its label sets are interned in a new pool).
  */
 bool MultiLabeledGraph::read(std::istream& is)
+{
+  return read(is, boost::shared_ptr<LabelSet::Pool>(new LabelSet::Pool()));
+} // method read
+
+/**
+ * Method read
+ *
+ * Reads graph from input stream, interning its label sets in the passed
+ * pool (e.g. the one of the dataset the graph belongs to).
+ */
+bool MultiLabeledGraph::read
+(
+    std::istream& is,
+    const boost::shared_ptr<LabelSet::Pool>& pool
+)
 {
   this->clear();
 
@@ -107,7 +122,7 @@ bool MultiLabeledGraph::read(std::istream& is)
       mut::Math::read(is, *element);
       Global::readLines(is, *neighs);
 
-      this->pushBack(*item, element, neighs);
+      this->pushBack(LabelSet(*item, pool), element, neighs);
       delete item;
 
     } // for
@@ -150,6 +165,36 @@ void MultiLabeledGraph::setLabelName(size_t i, const std::string& name)
   return;
 } // method setLabelName
 
+/**
+ * Method swap
+ *
+ * Overrides Graph::swap, so the label names are swapped also through a
+ * reference to the base class (see the method below). The passed graph must
+ * be a MultiLabeledGraph, otherwise an exception of type
+ * moka::GenericException will be thrown (and nothing is swapped).
+ */
+void MultiLabeledGraph::swap(BaseClass& g)
+{
+  MultiLabeledGraph *mlg = dynamic_cast<MultiLabeledGraph*>(&g);
+  if (mlg == NULL)
+    throw moka::GenericException(
+        "MultiLabeledGraph::swap: the passed graph is not a MultiLabeledGraph");
+  swap(*mlg);
+  return;
+} // method swap
+
+/**
+ * Method swap
+ *
+ * See Graph::swap (the label names are swapped too).
+ */
+void MultiLabeledGraph::swap(MultiLabeledGraph& g)
+{
+  BaseClass::swap(g);
+  m_label_names.swap(g.m_label_names);
+  return;
+} // method swap
+
 /**
  * Method write
  *
@@ -162,7 +207,7 @@ void MultiLabeledGraph::write(std::ostream& os) const
   Vertices::const_iterator vit;
   for (vit = this->getVertexBegin(); vit != this->getVertexEnd(); ++vit)
   {
-    Global::write(os, vit->getItem());
+    Global::write(os, vit->getItem().getLabels());
     mut::Math::write(os, vit->getElement());
     Global::write(os, vit->getNeighbors());
   } // for
@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include <moka/structure/graph.h>
+#include <moka/structure/labelset.h>
 
 namespace moka {
 namespace structure {
@@ -19,12 +20,21 @@ namespace structure {
  * is not checked, but it could be done in the future, so each label can have a
  * name (to represent its content) that can be setted and retrived using the
  * methods setLabelName and getLabelName.
+ *
+ * The labels of each vertex are stored as a LabelSet, that is an handle on an
+ * interned copy of them in a pool shared by the graphs built on it (e.g. all
+ * the graphs of a MultiLabeledGraphDataset and the state graphs built from
+ * them): it can be built from and used as a std::vector<std::string>, while
+ * copying it doesn't copy the labels and each label has an integer id in its
+ * pool.
  */
-class MultiLabeledGraph : public Graph< std::vector<std::string> >
+class MultiLabeledGraph : public Graph<LabelSet>
 {
   public:
     typedef Graph<ItemType> BaseClass;
 
+    using BaseClass::swap;
+
     MultiLabeledGraph() { }
     virtual ~MultiLabeledGraph() { }
 
@@ -35,7 +45,11 @@ class MultiLabeledGraph : public Graph< std::vector<std::string> >
     virtual std::string& getLabelName(size_t i);
     virtual Uint getLabelNameSize() const;
     virtual bool read(std::istream& is);
+    virtual bool read(
+        std::istream& is, const boost::shared_ptr<LabelSet::Pool>& pool);
     virtual void setLabelName(size_t i, const std::string& name);
+    virtual void swap(BaseClass& g);
+    virtual void swap(MultiLabeledGraph& g);
     virtual void write(std::ostream& os) const;
 
   private:
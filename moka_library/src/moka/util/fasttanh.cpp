@@ -0,0 +1,445 @@
+#include "fasttanh.h"
+
+#include <cmath>
+#include <cstring>
+#include <boost/cstdint.hpp>
+#include <moka/exception.h>
+
+#if !defined(MOKA_NO_SIMD) && defined(__GNUC__) && !defined(__clang__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define MOKA_FASTTANH_X86
+#include <immintrin.h>
+#if __GNUC__ >= 5
+#define MOKA_FASTTANH_AVX512
+#endif
+#endif
+
+namespace moka {
+namespace util {
+
+typedef FastTanh::Real Real;
+typedef FastTanh::Uint Uint;
+
+namespace {
+
+// |x| is clamped to this value, where tanh(x) is 1 in double precision
+const Real clamp_value = 20.0;
+
+// Constants of the range reduction y = k * ln(2) + r (ln(2) is split in two
+// parts, ln2_hi has the lowest bits null so k * ln2_hi is exact)
+const Real inv_ln2 = 1.44269504088896338700e+00;
+const Real ln2_hi = 6.93147180369123816490e-01;
+const Real ln2_lo = 1.90821492927058770002e-10;
+
+// Adding this value a real in [0, 2^31) is rounded to the nearest integer,
+// that is stored in the lowest bits of the sum
+const Real round_magic = 6755399441055744.0; // 1.5 * 2^52
+
+// Coefficients 1 / i! of the polynomial for exp(r), |r| <= ln(2) / 2
+const Real c0 = 1.0;
+const Real c1 = 1.0;
+const Real c2 = 1.0 / 2.0;
+const Real c3 = 1.0 / 6.0;
+const Real c4 = 1.0 / 24.0;
+const Real c5 = 1.0 / 120.0;
+const Real c6 = 1.0 / 720.0;
+const Real c7 = 1.0 / 5040.0;
+const Real c8 = 1.0 / 40320.0;
+const Real c9 = 1.0 / 362880.0;
+const Real c10 = 1.0 / 3628800.0;
+const Real c11 = 1.0 / 39916800.0;
+const Real c12 = 1.0 / 479001600.0;
+
+/**
+ * Function scalarTanh
+ *
+ * Generic (scalar) version of the approximation of tanh(x) (see the class
+ * FastTanh).
+ */
+inline Real scalarTanh(Real x)
+{
+  Real a = std::fabs(x);
+  if (a > clamp_value)
+    a = clamp_value;
+  Real y = a + a;
+
+  // y = k * ln(2) + r
+  Real k = y * inv_ln2 + round_magic;
+  boost::uint64_t k_bits;
+  std::memcpy(&k_bits, &k, sizeof(k));
+  k -= round_magic;
+  Real r = (y - k * ln2_hi) - k * ln2_lo;
+
+  // exp(r)
+  Real p = c12;
+  p = p * r + c11;
+  p = p * r + c10;
+  p = p * r + c9;
+  p = p * r + c8;
+  p = p * r + c7;
+  p = p * r + c6;
+  p = p * r + c5;
+  p = p * r + c4;
+  p = p * r + c3;
+  p = p * r + c2;
+  p = p * r + c1;
+  p = p * r + c0;
+
+  // exp(y) = 2^k * exp(r), adding k to the exponent of exp(r)
+  boost::uint64_t p_bits;
+  std::memcpy(&p_bits, &p, sizeof(p));
+  p_bits += (k_bits - 0x4338000000000000ULL) << 52;
+  Real e;
+  std::memcpy(&e, &p_bits, sizeof(e));
+
+  Real t = 1.0 - 2.0 / (e + 1.0);
+  return x < 0 ? -t : t;
+} // function scalarTanh
+
+/**
+ * Function genericTanhSum
+ *
+ * Generic version of FastTanh::tanhSum.
+ */
+void genericTanhSum(const Real *a, const Real *b, Real *y, Uint size)
+{
+  for (Uint i = 0; i < size; ++i)
+    y[i] = scalarTanh(a[i] + b[i]);
+  return;
+} // function genericTanhSum
+
+#ifdef MOKA_FASTTANH_X86
+
+/**
+ * Function sse2TanhSum
+ *
+ * SSE2 version of FastTanh::tanhSum (2 elements at a time), the same
+ * computation of scalarTanh.
+ */
+__attribute__((target("sse2")))
+void sse2TanhSum(const Real *a, const Real *b, Real *y, Uint size)
+{
+  const __m128d sign_mask = _mm_set1_pd(-0.0);
+  const __m128d clamp = _mm_set1_pd(clamp_value);
+  const __m128d magic = _mm_set1_pd(round_magic);
+  const __m128i magic_bits = _mm_castpd_si128(magic);
+  const __m128d one = _mm_set1_pd(1.0);
+  const __m128d two = _mm_set1_pd(2.0);
+
+  Uint i = 0;
+  for (; i + 2 <= size; i += 2)
+  {
+    __m128d x = _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i));
+    __m128d sign = _mm_and_pd(x, sign_mask);
+    __m128d abs_x = _mm_min_pd(clamp, _mm_andnot_pd(sign_mask, x));
+    __m128d v = _mm_add_pd(abs_x, abs_x);
+
+    __m128d k = _mm_add_pd(_mm_mul_pd(v, _mm_set1_pd(inv_ln2)), magic);
+    __m128i k_bits = _mm_castpd_si128(k);
+    k = _mm_sub_pd(k, magic);
+    __m128d r = _mm_sub_pd(v, _mm_mul_pd(k, _mm_set1_pd(ln2_hi)));
+    r = _mm_sub_pd(r, _mm_mul_pd(k, _mm_set1_pd(ln2_lo)));
+
+    __m128d p = _mm_set1_pd(c12);
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(c11));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(c10));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(c9));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(c8));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(c7));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(c6));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(c5));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(c4));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(c3));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(c2));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(c1));
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(c0));
+
+    __m128i shift = _mm_slli_epi64(_mm_sub_epi64(k_bits, magic_bits), 52);
+    __m128d e = _mm_castsi128_pd(_mm_add_epi64(_mm_castpd_si128(p), shift));
+
+    __m128d t = _mm_sub_pd(one, _mm_div_pd(two, _mm_add_pd(e, one)));
+    _mm_storeu_pd(y + i, _mm_or_pd(t, sign));
+  } // for i
+
+  for (; i < size; ++i)
+    y[i] = scalarTanh(a[i] + b[i]);
+
+  return;
+} // function sse2TanhSum
+
+/**
+ * Function avx2TanhSum
+ *
+ * AVX2 version of FastTanh::tanhSum (4 elements at a time, with fused
+ * multiply-add), the same computation of scalarTanh.
+ */
+__attribute__((target("avx2,fma")))
+void avx2TanhSum(const Real *a, const Real *b, Real *y, Uint size)
+{
+  const __m256d sign_mask = _mm256_set1_pd(-0.0);
+  const __m256d clamp = _mm256_set1_pd(clamp_value);
+  const __m256d magic = _mm256_set1_pd(round_magic);
+  const __m256i magic_bits = _mm256_castpd_si256(magic);
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d two = _mm256_set1_pd(2.0);
+
+  Uint i = 0;
+  for (; i + 4 <= size; i += 4)
+  {
+    __m256d x = _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+    __m256d sign = _mm256_and_pd(x, sign_mask);
+    __m256d abs_x = _mm256_min_pd(clamp, _mm256_andnot_pd(sign_mask, x));
+    __m256d v = _mm256_add_pd(abs_x, abs_x);
+
+    __m256d k = _mm256_fmadd_pd(v, _mm256_set1_pd(inv_ln2), magic);
+    __m256i k_bits = _mm256_castpd_si256(k);
+    k = _mm256_sub_pd(k, magic);
+    __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(ln2_hi), v);
+    r = _mm256_fnmadd_pd(k, _mm256_set1_pd(ln2_lo), r);
+
+    __m256d p = _mm256_set1_pd(c12);
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(c11));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(c10));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(c9));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(c8));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(c7));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(c6));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(c5));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(c4));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(c3));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(c2));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(c1));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(c0));
+
+    __m256i shift =
+        _mm256_slli_epi64(_mm256_sub_epi64(k_bits, magic_bits), 52);
+    __m256d e =
+        _mm256_castsi256_pd(_mm256_add_epi64(_mm256_castpd_si256(p), shift));
+
+    __m256d t = _mm256_sub_pd(one, _mm256_div_pd(two, _mm256_add_pd(e, one)));
+    _mm256_storeu_pd(y + i, _mm256_or_pd(t, sign));
+  } // for i
+
+  for (; i < size; ++i)
+    y[i] = scalarTanh(a[i] + b[i]);
+
+  return;
+} // function avx2TanhSum
+
+#ifdef MOKA_FASTTANH_AVX512
+
+/**
+ * Function avx512TanhSum
+ *
+ * AVX-512 version of FastTanh::tanhSum (8 elements at a time, with fused
+ * multiply-add), the same computation of scalarTanh. Only AVX-512F
+ * instructions are used (the logical operations are on integers).
+ */
+__attribute__((target("avx512f")))
+void avx512TanhSum(const Real *a, const Real *b, Real *y, Uint size)
+{
+  const __m512i sign_mask = _mm512_set1_epi64(0x8000000000000000LL);
+  const __m512d clamp = _mm512_set1_pd(clamp_value);
+  const __m512d magic = _mm512_set1_pd(round_magic);
+  const __m512i magic_bits = _mm512_castpd_si512(magic);
+  const __m512d one = _mm512_set1_pd(1.0);
+  const __m512d two = _mm512_set1_pd(2.0);
+
+  Uint i = 0;
+  for (; i + 8 <= size; i += 8)
+  {
+    __m512d x = _mm512_add_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i));
+    __m512i x_bits = _mm512_castpd_si512(x);
+    __m512i sign = _mm512_and_si512(x_bits, sign_mask);
+    __m512d abs_x = _mm512_min_pd(
+        clamp, _mm512_castsi512_pd(_mm512_andnot_si512(sign_mask, x_bits)));
+    __m512d v = _mm512_add_pd(abs_x, abs_x);
+
+    __m512d k = _mm512_fmadd_pd(v, _mm512_set1_pd(inv_ln2), magic);
+    __m512i k_bits = _mm512_castpd_si512(k);
+    k = _mm512_sub_pd(k, magic);
+    __m512d r = _mm512_fnmadd_pd(k, _mm512_set1_pd(ln2_hi), v);
+    r = _mm512_fnmadd_pd(k, _mm512_set1_pd(ln2_lo), r);
+
+    __m512d p = _mm512_set1_pd(c12);
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(c11));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(c10));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(c9));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(c8));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(c7));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(c6));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(c5));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(c4));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(c3));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(c2));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(c1));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(c0));
+
+    __m512i shift =
+        _mm512_slli_epi64(_mm512_sub_epi64(k_bits, magic_bits), 52);
+    __m512d e =
+        _mm512_castsi512_pd(_mm512_add_epi64(_mm512_castpd_si512(p), shift));
+
+    __m512d t = _mm512_sub_pd(one, _mm512_div_pd(two, _mm512_add_pd(e, one)));
+    _mm512_storeu_pd(
+        y + i, _mm512_castsi512_pd(
+            _mm512_or_si512(_mm512_castpd_si512(t), sign)));
+  } // for i
+
+  for (; i < size; ++i)
+    y[i] = scalarTanh(a[i] + b[i]);
+
+  return;
+} // function avx512TanhSum
+
+#endif // MOKA_FASTTANH_AVX512
+
+#endif // MOKA_FASTTANH_X86
+
+/**
+ * Function bestInstructionSet
+ *
+ * Returns the best instruction set supported by the CPU (and by this build)
+ * for FastTanh::tanhSum.
+ */
+FastTanh::InstructionSet bestInstructionSet()
+{
+#ifdef MOKA_FASTTANH_X86
+  __builtin_cpu_init();
+#ifdef MOKA_FASTTANH_AVX512
+  if (__builtin_cpu_supports("avx512f"))
+    return FastTanh::avx512_instructions;
+#endif
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return FastTanh::avx2_instructions;
+  if (__builtin_cpu_supports("sse2"))
+    return FastTanh::sse2_instructions;
+#endif
+  return FastTanh::generic_instructions;
+} // function bestInstructionSet
+
+// Best instruction set (detected when the library is loaded) and the one
+// currently used by tanhSum
+const FastTanh::InstructionSet best_instruction_set = bestInstructionSet();
+FastTanh::InstructionSet current_instruction_set = best_instruction_set;
+
+} // namespace
+
+/**
+ * Method exactTanhSum
+ *
+ * Computes y_i = tanh(a_i + b_i), for i = 0, ..., size - 1, through std::tanh.
+ * The output array y may be the same array of a or b.
+ */
+void FastTanh::exactTanhSum(const Real *a, const Real *b, Real *y, Uint size)
+{
+  for (Uint i = 0; i < size; ++i)
+    y[i] = std::tanh(a[i] + b[i]);
+  return;
+} // method exactTanhSum
+
+/**
+ * Method getInstructionSet
+ *
+ * Returns the instruction set currently used by tanhSum: by default the best
+ * one supported by the CPU.
+ */
+FastTanh::InstructionSet FastTanh::getInstructionSet()
+{
+  return current_instruction_set;
+} // method getInstructionSet
+
+/**
+ * Method instToStr
+ *
+ * Converts an InstructionSet value into an std::string. If the InstructionSet
+ * value is not recognized throws an exception of type moka::GenericException.
+ */
+std::string FastTanh::instToStr(const InstructionSet& instruction_set)
+{
+  switch (instruction_set)
+  {
+  case generic_instructions:
+    return "generic";
+    break;
+  case sse2_instructions:
+    return "sse2";
+    break;
+  case avx2_instructions:
+    return "avx2";
+    break;
+  case avx512_instructions:
+    return "avx512";
+    break;
+  default:
+    throw moka::GenericException(
+          "FastTanh::instToStr: invalid InstructionSet value");
+  }
+  // return "";
+} // method instToStr
+
+/**
+ * Method isSupported
+ *
+ * Returns true if the instruction set is supported by the CPU (and by this
+ * build of the library). The generic instructions are always supported.
+ */
+bool FastTanh::isSupported(const InstructionSet& instruction_set)
+{
+  return instruction_set <= best_instruction_set;
+} // method isSupported
+
+/**
+ * Method setInstructionSet
+ *
+ * Sets the instruction set used by tanhSum (e.g. in order to compare the
+ * implementations). It is a global setting, and should not be changed while
+ * tanhSum is running on other threads.
+ * A moka::GenericException will be thrown if the instruction set is not
+ * supported (see isSupported).
+ */
+void FastTanh::setInstructionSet(const InstructionSet& instruction_set)
+{
+  if (!isSupported(instruction_set))
+    throw moka::GenericException(
+        "FastTanh::setInstructionSet: instruction set not supported (" +
+        instToStr(instruction_set) + ")");
+
+  current_instruction_set = instruction_set;
+  return;
+} // method setInstructionSet
+
+/**
+ * Method tanhSum
+ *
+ * Computes y_i = tanh(a_i + b_i), for i = 0, ..., size - 1, with the
+ * approximation described in the class doc (the absolute error is lower than
+ * errorBound()), using the current instruction set (see getInstructionSet).
+ * The output array y may be the same array of a or b.
+ */
+void FastTanh::tanhSum(const Real *a, const Real *b, Real *y, Uint size)
+{
+  switch (current_instruction_set)
+  {
+#ifdef MOKA_FASTTANH_X86
+#ifdef MOKA_FASTTANH_AVX512
+  case avx512_instructions:
+    avx512TanhSum(a, b, y, size);
+    break;
+#endif
+  case avx2_instructions:
+    avx2TanhSum(a, b, y, size);
+    break;
+  case sse2_instructions:
+    sse2TanhSum(a, b, y, size);
+    break;
+#endif
+  default:
+    genericTanhSum(a, b, y, size);
+  }
+  return;
+} // method tanhSum
+
+} // namespace util
+} // namespace moka
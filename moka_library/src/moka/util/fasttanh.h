@@ -0,0 +1,82 @@
+#ifndef MOKA_UTIL_FASTTANH_H
+#define MOKA_UTIL_FASTTANH_H
+
+#include <string>
+#include <moka/global.h>
+
+namespace moka {
+namespace util {
+
+/**
+ * Class FastTanh
+ *
+ * Computes the hyperbolic tangent of the sum of two arrays
+ *    y_i = tanh(a_i + b_i)
+ * in a single pass and without temporaries, as required by the state
+ * transition function of the reservoirs.
+ *
+ * The method tanhSum computes an approximation of the tanh, using the vector
+ * instructions of the CPU: the instruction set (SSE2, AVX2 with FMA or
+ * AVX-512) is selected at runtime, when the library is loaded, as the best
+ * one supported by the CPU, otherwise a generic (scalar) implementation is
+ * used. The approximation is computed as
+ *    tanh(x) = sign(x) * (1 - 2 / (exp(2|x|) + 1))
+ * with |x| clamped to 20 (where tanh(x) is 1 in double precision) and the
+ * exponential computed by a range reduction exp(y) = 2^k * exp(r), with
+ * |r| <= ln(2) / 2, and a polynomial of degree 12 for exp(r). The absolute
+ * error is lower than FastTanh::errorBound() (1e-15) for any x, but the
+ * relative error grows near 0 (where tanh(x) is about x). The results may
+ * differ by few units in the last place with different instruction sets (the
+ * AVX2 and AVX-512 versions use the fused multiply-add).
+ *
+ * The method exactTanhSum computes the same sum through std::tanh, and is the
+ * exact fallback of tanhSum.
+ *
+ * The vector instructions are used only with GCC (version 4.9 or later) on
+ * x86 processors, and can be disabled by defining MOKA_NO_SIMD.
+ */
+class FastTanh
+{
+  public:
+    typedef Global::Real Real;
+    typedef Global::Uint Uint;
+
+    //! Instruction sets used by tanhSum
+    enum InstructionSet
+    {
+      generic_instructions,
+      sse2_instructions,
+      avx2_instructions,
+      avx512_instructions
+    };
+
+    //! Bound of the absolute error of tanhSum
+    static Real errorBound()
+    {
+      return 1e-15;
+    }
+
+    //! Computes y_i = tanh(a_i + b_i) through std::tanh
+    static void exactTanhSum(const Real *a, const Real *b, Real *y, Uint size);
+
+    //! Instruction set currently used by tanhSum
+    static InstructionSet getInstructionSet();
+
+    //! InstructionSet to std::string conversion
+    static std::string instToStr(const InstructionSet& instruction_set);
+
+    //! True if the instruction set is supported by the CPU
+    static bool isSupported(const InstructionSet& instruction_set);
+
+    //! Sets the instruction set used by tanhSum
+    static void setInstructionSet(const InstructionSet& instruction_set);
+
+    //! Computes y_i = tanh(a_i + b_i) with the approximation
+    static void tanhSum(const Real *a, const Real *b, Real *y, Uint size);
+
+}; // class FastTanh
+
+} // namespace util
+} // namespace moka
+
+#endif // MOKA_UTIL_FASTTANH_H
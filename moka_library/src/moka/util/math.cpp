@@ -1,5 +1,7 @@
 #include "math.h"
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <vector>
 #include <mlpack/methods/lars/lars.hpp>
@@ -8,6 +10,255 @@
 namespace moka {
 namespace util {
 
+namespace {
+
+/**
+ * Function isNorm2Bound
+ *
+ * Returns true if the 2-norm of the matrix is certainly not greater than
+ * bound, that is if bound^2 * I - trans(M) * M is positive definite: it is
+ * checked by its Cholesky factorization (that fails on a non positive pivot),
+ * on bound^2 decreased by a margin covering the rounding errors of the
+ * product and of the factorization. It costs about a tenth of a SVD.
+ */
+bool isNorm2Bound(const Math::Matrix& matrix, Math::Real bound)
+{
+  typedef Math::Real Real;
+  typedef Math::Uint Uint;
+
+  const Uint n = matrix.n_cols;
+  const Real margin = 16 * (n + 1) * std::numeric_limits<Real>::epsilon();
+  const Real shift = bound * bound * (1 - margin);
+
+  // A = shift * I - trans(M) * M (only the lower triangle is used)
+  Math::Matrix a = arma::trans(matrix) * matrix;
+  a *= -1;
+  for (Uint i = 0; i < n; ++i)
+    a(i, i) += shift;
+
+  // Cholesky factorization A = L * trans(L), in place by columns
+  for (Uint j = 0; j < n; ++j)
+  {
+    Real *a_j = a.colptr(j);
+    for (Uint k = 0; k < j; ++k)
+    {
+      const Real *a_k = a.colptr(k);
+      const Real l_jk = a_k[j];
+      for (Uint i = j; i < n; ++i)
+        a_j[i] -= a_k[i] * l_jk;
+    } // for k
+
+    if (!(a_j[j] > 0))
+      return false;
+    const Real pivot = std::sqrt(a_j[j]);
+    for (Uint i = j; i < n; ++i)
+      a_j[i] /= pivot;
+  } // for j
+
+  return true;
+} // function isNorm2Bound
+
+} // namespace
+
+/**
+ * Method norm2Bound
+ *
+ * Returns an upper bound of the 2-norm of the matrix, not greater than
+ * sqrt(1 + tolerance) times the 2-norm, without a full SVD in most cases.
+ * The candidate bound is the Lanczos estimate increased by its error bound
+ * (see norm2Estimate), or the Frobenius norm if lower (that is always an
+ * upper bound of the 2-norm). The estimate is an upper bound when the Lanczos
+ * iteration finds the largest singular value, as it usually does, but this is
+ * not guaranteed: then it is certified by a Cholesky factorization (see
+ * isNorm2Bound), and the exact 2-norm (arma::norm) is returned if the
+ * certification fails.
+ */
+Math::Real Math::norm2Bound(const Matrix& matrix, Real tolerance)
+{
+  if (matrix.n_elem == 0)
+    return 0;
+
+  const Real frobenius = arma::norm(matrix, "fro");
+  const Real estimate =
+      std::sqrt(1 + tolerance) * norm2Estimate(matrix, tolerance);
+  if (frobenius <= estimate)
+    return frobenius;
+  if (isNorm2Bound(matrix, estimate))
+    return estimate;
+
+  return arma::norm(matrix, 2);
+} // method norm2Bound
+
+/**
+ * Method norm2Estimate
+ *
+ * Estimates the 2-norm of the matrix (its largest singular value) without a
+ * full SVD, through the Lanczos iteration on trans(M) * M with full
+ * reorthogonalization: each step costs two matrix-vector products, and the
+ * largest eigenvalue of the tridiagonal Lanczos matrix (the Ritz value,
+ * computed by bisection) grows toward the largest eigenvalue of trans(M) * M.
+ * The iteration stops when the residual of the Ritz pair (theta, y)
+ *    || trans(M) * M * y - theta * y || = beta_{j+1} * |s_j|
+ * (where s is the eigenvector of the tridiagonal matrix, computed by inverse
+ * iteration) is not greater than tolerance * theta: then trans(M) * M has an
+ * eigenvalue within tolerance * theta from theta.
+ *
+ * The result is an estimate, not a bound: the returned sqrt(theta) is never
+ * greater than the 2-norm (theta is a Ritz value), but the residual only
+ * guarantees that some eigenvalue is near theta, not that it is the largest
+ * one. Usually it is the largest one (the extreme Ritz values converge first
+ * with a generic starting vector), and then sqrt(1 + tolerance) * sqrt(theta)
+ * is not lower than the 2-norm; if the starting vector is almost orthogonal
+ * to the largest singular vector the 2-norm can be underestimated instead
+ * (see norm2Bound for a certified upper bound).
+ * The Lanczos iteration converges fast also when the largest singular values
+ * are close (e.g. in random matrices).
+ *
+ * If the iteration doesn't converge within 300 steps the exact 2-norm is
+ * returned (arma::norm).
+ */
+Math::Real Math::norm2Estimate(const Matrix& matrix, Real tolerance)
+{
+  const Uint n = matrix.n_cols;
+  if (matrix.n_elem == 0)
+    return 0;
+
+  const Uint max_steps = std::min(n, Uint(300));
+  Matrix basis(n, max_steps);
+  std::vector<Real> alpha, beta;
+  alpha.reserve(max_steps);
+  beta.reserve(max_steps);
+
+  // Starting vector (pseudo-random and fixed, in order to be repeatable)
+  Vector q(n);
+  Uint seed = 12345;
+  for (Uint i = 0; i < n; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    q[i] = ((seed >> 16) & 0x7fff) / 32768.0 - 0.5;
+  } // for i
+  q /= arma::norm(q, 2);
+
+  Vector mq, w;
+  Real ritz = 0;
+  for (Uint j = 0; j < max_steps; ++j)
+  {
+    std::copy(q.begin(), q.end(), basis.begin_col(j));
+
+    // w = trans(M) * M * q_j - beta_j * q_{j-1}, orthogonalized against all
+    // the previous Lanczos vectors (twice, for the numerical stability)
+    mq = matrix * q;
+    w = arma::trans(matrix) * mq;
+    alpha.push_back(arma::dot(q, w));
+    for (Uint pass = 0; pass < 2; ++pass)
+      for (Uint i = 0; i <= j; ++i)
+      {
+        const Real *q_i = basis.colptr(i);
+        Real proj = 0;
+        for (Uint k = 0; k < n; ++k)
+          proj += q_i[k] * w[k];
+        for (Uint k = 0; k < n; ++k)
+          w[k] -= proj * q_i[k];
+      } // for i
+
+    // Largest eigenvalue of the tridiagonal matrix T_j (diagonal alpha and
+    // subdiagonal beta) by bisection, counting the eigenvalues lower than x
+    // through the Sturm sequence; the Ritz values grow at each step
+    Real low = ritz;
+    Real high = 0;
+    for (Uint i = 0; i <= j; ++i)
+    {
+      Real radius =
+          (i > 0 ? std::fabs(beta[i - 1]) : 0.0) +
+          (i < j ? std::fabs(beta[i]) : 0.0);
+      high = std::max(high, alpha[i] + radius);
+    } // for i
+    while (high - low > 1e-15 * high)
+    {
+      Real x = 0.5 * (low + high);
+      if (x <= low || x >= high)
+        break;
+      Uint lower_count = 0;
+      Real d = 1;
+      for (Uint i = 0; i <= j; ++i)
+      {
+        d = alpha[i] - x - (i > 0 ? beta[i - 1] * beta[i - 1] / d : 0.0);
+        if (d == 0)
+          d = -1e-300;
+        if (d < 0)
+          lower_count++;
+      } // for i
+      if (lower_count == j + 1)
+        high = x;
+      else
+        low = x;
+    } // while
+    ritz = high;
+
+    // Last component of the eigenvector s of T_j, by inverse iteration with
+    // the shift mu > ritz (T_j - mu * I is negative definite, and then its
+    // LDL' factorization is stable)
+    const Real mu = ritz * (1 + 1e-12) + 1e-300;
+    std::vector<Real> d(j + 1), l(j + 1), x(j + 1, 1.0);
+    d[0] = alpha[0] - mu;
+    for (Uint i = 1; i <= j; ++i)
+    {
+      l[i - 1] = beta[i - 1] / d[i - 1];
+      d[i] = alpha[i] - mu - l[i - 1] * beta[i - 1];
+    } // for i
+    Real x_norm = 1;
+    for (Uint pass = 0; pass < 2; ++pass)
+    {
+      for (Uint i = 1; i <= j; ++i)
+        x[i] -= l[i - 1] * x[i - 1];
+      for (Uint i = 0; i <= j; ++i)
+        x[i] /= d[i];
+      for (Uint i = j; i > 0; --i)
+        x[i - 1] -= l[i - 1] * x[i];
+      x_norm = 0;
+      for (Uint i = 0; i <= j; ++i)
+        x_norm += x[i] * x[i];
+      x_norm = std::sqrt(x_norm);
+      for (Uint i = 0; i <= j; ++i)
+        x[i] /= x_norm;
+    } // for pass
+
+    // Convergence (or invariant Krylov space: the Ritz value is exact)
+    Real w_norm = arma::norm(w, 2);
+    if (w_norm * std::fabs(x[j]) <= tolerance * ritz ||
+        w_norm <= 1e-14 * ritz)
+      return std::sqrt(ritz);
+
+    beta.push_back(w_norm);
+    q = w / w_norm;
+  } // for j
+
+  return arma::norm(matrix, 2);
+} // method norm2Estimate
+
+/**
+ * Method precToStr
+ *
+ * Converts a Precision value into an std::string. If the Precision value is
+ * not recognized throws an exception of type moka::GenericException.
+ */
+std::string Math::precToStr(const Precision& precision)
+{
+  switch (precision)
+  {
+  case double_precision:
+    return "double";
+    break;
+  case single_precision:
+    return "single";
+    break;
+  default:
+    throw moka::GenericException(
+          "Math::precToStr: invalid Precision value");
+  }
+  // return "";
+} // method precToStr
+
 /**
  * Method read
  *
@@ -202,6 +453,25 @@ void Math::solveTpRidgeRegression
   return;
 } // method solveTpRidgeRegression
 
+/**
+ * Method strToPrec
+ *
+ * Converts an std::string into a Precision value. If the string is not
+ * recognized throws an exception of type moka::GenericException.
+ */
+Math::Precision Math::strToPrec(const std::string& str)
+{
+  if (str == "double")
+    return double_precision;
+  else if (str == "single")
+    return single_precision;
+  else
+    throw moka::GenericException(
+        "Math::strToPrec: Invalid string representation of a Precision "
+        "value");
+  // return double_precision;
+} // method strToPrec
+
 /**
  * Method write
  *
@@ -1,6 +1,7 @@
 #ifndef MOKA_UTIL_MATH_H
 #define MOKA_UTIL_MATH_H
 
+#include <string>
 #include <vector>
 #include <armadillo>
 #include <moka/global.h>
@@ -24,6 +25,13 @@ class Math
     typedef arma::Col<Real> Vector;
     typedef arma::Mat<Real> Matrix;
 
+    typedef float SingleReal;
+    typedef arma::Col<SingleReal> SingleVector;
+    typedef arma::Mat<SingleReal> SingleMatrix;
+
+    //! Floating point precision of a computation
+    enum Precision { double_precision, single_precision };
+
     //! Max absolute value: Max_i( |x_i| )
     template <typename Container>
     static inline Real maxAbs(const Container& container);
@@ -40,6 +48,16 @@ class Math
     template <typename Container>
     static inline Real norm1(const Container& container);
 
+    //! Upper bound of the matrix 2-norm, within sqrt(1 + tolerance) of it
+    static Real norm2Bound(const Matrix& matrix, Real tolerance);
+
+    //! Estimate of the matrix 2-norm (largest singular value) by Lanczos,
+    //! never greater than the 2-norm
+    static Real norm2Estimate(const Matrix& matrix, Real tolerance);
+
+    //! Precision to std::string conversion
+    static std::string precToStr(const Precision& precision);
+
     //! Reads a matrix from input stream.
     static void read(std::istream& is, Matrix& matrix);
 
@@ -90,6 +108,9 @@ class Math
     template <typename Container>
     static inline Real stdev(const Container& container, const Real& average);
 
+    //! std::string to Precision conversion
+    static Precision strToPrec(const std::string& str);
+
     //! Sum of elements: Sum_i(x_i)
     template <typename Container>
     static inline Real sum(const Container& container);
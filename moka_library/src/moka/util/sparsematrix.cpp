@@ -0,0 +1,284 @@
+#include "sparsematrix.h"
+
+#include <moka/exception.h>
+
+namespace moka {
+namespace util {
+
+/**
+ * Constructor
+ */
+SparseMatrix::SparseMatrix()
+{
+  clear();
+}
+
+/**
+ * Constructor
+ */
+SparseMatrix::SparseMatrix(Uint no_columns)
+{
+  clear(no_columns);
+}
+
+/**
+ * Method append
+ *
+ * Appends the element (col, value) at the end of the last row of the matrix.
+ * The elements of a row should be appended in increasing order of column (a
+ * repeated column is allowed and its values are summed in the products).
+ * A moka::GenericException will be thrown if there are no rows or if the
+ * column is out of range.
+ */
+void SparseMatrix::append(Uint col, Real value)
+{
+  if (getNoRows() == 0)
+    throw moka::GenericException(
+        "SparseMatrix::append: no rows in the matrix (see appendRow)");
+
+  if (col >= m_no_columns)
+    throw moka::GenericException(
+        "SparseMatrix::append: column index out of range");
+
+  m_col_idx.push_back(col);
+  m_values.push_back(value);
+  m_row_ptr.back() = m_values.size();
+
+  return;
+} // method append
+
+/**
+ * Method appendRow
+ *
+ * Appends a new empty row at the end of the matrix. The following calls of
+ * the method append will fill such row.
+ */
+void SparseMatrix::appendRow()
+{
+  m_row_ptr.push_back(m_values.size());
+  return;
+} // method appendRow
+
+/**
+ * Method buildFrom
+ *
+ * Builds this matrix from the dense matrix passed, storing only its non-zero
+ * elements. Returns a reference to this object.
+ */
+SparseMatrix& SparseMatrix::buildFrom(const Matrix& dense)
+{
+  Uint no_non_zeros = 0;
+  for (Uint i = 0; i < dense.n_elem; ++i)
+    if (dense[i] != 0.0)
+      ++no_non_zeros;
+
+  clear(dense.n_cols);
+  reserve(dense.n_rows, no_non_zeros);
+  for (Uint r = 0; r < dense.n_rows; ++r)
+  {
+    appendRow();
+    for (Uint c = 0; c < dense.n_cols; ++c)
+      if (dense(r, c) != 0.0)
+        append(c, dense(r, c));
+  } // for r
+
+  return *this;
+} // method buildFrom
+
+/**
+ * Method clear
+ *
+ * Removes all rows and elements from the matrix and sets the number of
+ * columns.
+ */
+void SparseMatrix::clear(Uint no_columns)
+{
+  m_no_columns = no_columns;
+  m_row_ptr.assign(1, 0);
+  m_col_idx.clear();
+  m_values.clear();
+  return;
+} // method clear
+
+/**
+ * Method multiply
+ *
+ * Computes the dense product out = A * in, where A is this matrix. The number
+ * of rows of "in" must be equal to the number of columns of A, "out" is
+ * resized to A.n_rows x in.n_cols. See multiplyAdd.
+ */
+void SparseMatrix::multiply(const Matrix& in, Matrix& out) const
+{
+  out.set_size(getNoRows(), in.n_cols);
+  out.zeros();
+  multiplyAdd(in, out);
+  return;
+} // method multiply
+
+/**
+ * Method multiply
+ *
+ * Single precision version of multiply(const Matrix&, Matrix&).
+ */
+void SparseMatrix::multiply(const SingleMatrix& in, SingleMatrix& out) const
+{
+  out.set_size(getNoRows(), in.n_cols);
+  out.zeros();
+  multiplyAdd(in, out);
+  return;
+} // method multiply
+
+/**
+ * Method multiplyAdd
+ *
+ * Computes out = out + A * in, where A is this matrix, accessing only the
+ * stored elements of A (see multiplyAddImpl).
+ */
+void SparseMatrix::multiplyAdd(const Matrix& in, Matrix& out) const
+{
+  multiplyAddImpl(in, out);
+  return;
+} // method multiplyAdd
+
+/**
+ * Method multiplyAdd
+ *
+ * Single precision version of multiplyAdd(const Matrix&, Matrix&).
+ */
+void SparseMatrix::multiplyAdd(const SingleMatrix& in, SingleMatrix& out) const
+{
+  multiplyAddImpl(in, out);
+  return;
+} // method multiplyAdd
+
+/**
+ * Method multiplyAddImpl
+ *
+ * Computes out = out + A * in, where A is this matrix, accessing only the
+ * stored elements of A. The number of rows of "in" must be equal to the
+ * number of columns of A and "out" must be a A.n_rows x in.n_cols matrix
+ * (e.g. a vector of size A.n_rows if "in" is a vector).
+ * Implemented for both the dense matrix types (the products are computed in
+ * the precision of the matrices).
+ *
+ * A moka::GenericException will be thrown if dimensions do not match.
+ */
+template <typename MatrixType>
+void SparseMatrix::multiplyAddImpl(const MatrixType& in, MatrixType& out) const
+{
+  if (in.n_rows != m_no_columns ||
+      out.n_rows != getNoRows() ||
+      out.n_cols != in.n_cols)
+    throw moka::GenericException(
+        "SparseMatrix::multiplyAdd: incompatible matrix dimensions");
+
+  typedef typename MatrixType::elem_type Elem;
+  const Uint no_rows = getNoRows();
+
+  for (Uint c = 0; c < in.n_cols; ++c)
+  {
+    const Elem *in_col = in.colptr(c);
+    Elem *out_col = out.colptr(c);
+    for (Uint r = 0; r < no_rows; ++r)
+    {
+      Elem sum = 0.0;
+      for (Uint k = m_row_ptr[r]; k < m_row_ptr[r + 1]; ++k)
+        sum += Elem(m_values[k]) * in_col[m_col_idx[k]];
+      out_col[r] += sum;
+    } // for r
+  } // for c
+
+  return;
+} // method multiplyAddImpl
+
+/**
+ * Method multiplyTransposed
+ *
+ * Computes the dense product out = in * trans(A), where A is this matrix (see
+ * multiplyTransposedImpl).
+ */
+void SparseMatrix::multiplyTransposed(const Matrix& in, Matrix& out) const
+{
+  multiplyTransposedImpl(in, out);
+  return;
+} // method multiplyTransposed
+
+/**
+ * Method multiplyTransposed
+ *
+ * Single precision version of multiplyTransposed(const Matrix&, Matrix&).
+ */
+void SparseMatrix::multiplyTransposed
+(
+    const SingleMatrix& in,
+    SingleMatrix& out
+) const
+{
+  multiplyTransposedImpl(in, out);
+  return;
+} // method multiplyTransposed
+
+/**
+ * Method multiplyTransposedImpl
+ *
+ * Computes the dense product out = in * trans(A), where A is this matrix.
+ * The number of columns of "in" must be equal to the number of columns of A,
+ * "out" is resized to in.n_rows x A.n_rows.
+ *
+ * Since A is stored by rows, each column r of the result is the linear
+ * combination of the columns of "in" selected by the row r of A:
+ *   out(:, r) = Sum_{k in row r}( A(r, k) * in(:, k) )
+ * so the product is computed by column axpy, accessing "in" and "out" in
+ * their natural (column-major) order.
+ *
+ * A moka::GenericException will be thrown if dimensions do not match.
+ */
+template <typename MatrixType>
+void SparseMatrix::multiplyTransposedImpl
+(
+    const MatrixType& in,
+    MatrixType& out
+) const
+{
+  if (in.n_cols != m_no_columns)
+    throw moka::GenericException(
+        "SparseMatrix::multiplyTransposed: incompatible matrix dimensions");
+
+  typedef typename MatrixType::elem_type Elem;
+  const Uint no_rows = getNoRows();
+  const Uint m = in.n_rows;
+
+  out.set_size(m, no_rows);
+  out.zeros();
+
+  for (Uint r = 0; r < no_rows; ++r)
+  {
+    Elem *out_col = out.colptr(r);
+    for (Uint k = m_row_ptr[r]; k < m_row_ptr[r + 1]; ++k)
+    {
+      const Elem *in_col = in.colptr(m_col_idx[k]);
+      const Elem value = m_values[k];
+      for (Uint i = 0; i < m; ++i)
+        out_col[i] += value * in_col[i];
+    } // for k
+  } // for r
+
+  return;
+} // method multiplyTransposedImpl
+
+/**
+ * Method reserve
+ *
+ * Reserves memory for the given number of rows and stored elements, in order
+ * to avoid reallocations while the matrix is built.
+ */
+void SparseMatrix::reserve(Uint no_rows, Uint no_non_zeros)
+{
+  m_row_ptr.reserve(no_rows + 1);
+  m_col_idx.reserve(no_non_zeros);
+  m_values.reserve(no_non_zeros);
+  return;
+} // method reserve
+
+} // namespace util
+} // namespace moka
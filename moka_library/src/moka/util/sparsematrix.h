@@ -0,0 +1,107 @@
+#ifndef MOKA_UTIL_SPARSEMATRIX_H
+#define MOKA_UTIL_SPARSEMATRIX_H
+
+#include <vector>
+#include <moka/global.h>
+#include <moka/util/math.h>
+
+namespace moka {
+namespace util {
+
+/**
+ * Class SparseMatrix
+ *
+ * A real sparse matrix stored in the Compressed Sparse Row (CSR) format: the
+ * non-zero values are stored row by row, together with their column indices,
+ * and for each row is stored the position of its first element. Rows are
+ * built in order, by appending a new row (appendRow) and then its elements
+ * (append).
+ *
+ * The class provides only the products used by the library, computed against
+ * dense matrices (Math::Matrix, or Math::SingleMatrix for the single precision
+ * computations: the stored values are then rounded to single precision).
+ */
+class SparseMatrix
+{
+  public:
+    typedef Global::Real Real;
+    typedef Global::Uint Uint;
+    typedef Math::Matrix Matrix;
+    typedef Math::Vector Vector;
+    typedef Math::SingleMatrix SingleMatrix;
+
+    //! Default constructor (builds an empty matrix 0 x 0)
+    SparseMatrix();
+
+    //! Builds an empty matrix (without rows) having the given columns
+    SparseMatrix(Uint no_columns);
+
+    //! Appends an element (col, value) at the end of the last row
+    void append(Uint col, Real value);
+
+    //! Appends a new empty row at the end of the matrix
+    void appendRow();
+
+    //! Builds this matrix from a dense matrix (keeping its non-zero elements)
+    SparseMatrix& buildFrom(const Matrix& dense);
+
+    //! Clears the matrix and sets the number of columns
+    void clear(Uint no_columns = 0);
+
+    //! Number of columns
+    Uint getNoColumns() const
+    {
+      return m_no_columns;
+    }
+
+    //! Number of stored (non-zero) elements
+    Uint getNoNonZeros() const
+    {
+      return m_values.size();
+    }
+
+    //! Number of rows
+    Uint getNoRows() const
+    {
+      return m_row_ptr.size() - 1;
+    }
+
+    //! Computes out = this * in
+    void multiply(const Matrix& in, Matrix& out) const;
+
+    //! Computes out = this * in (single precision)
+    void multiply(const SingleMatrix& in, SingleMatrix& out) const;
+
+    //! Computes out += this * in
+    void multiplyAdd(const Matrix& in, Matrix& out) const;
+
+    //! Computes out += this * in (single precision)
+    void multiplyAdd(const SingleMatrix& in, SingleMatrix& out) const;
+
+    //! Computes out = in * trans(this)
+    void multiplyTransposed(const Matrix& in, Matrix& out) const;
+
+    //! Computes out = in * trans(this) (single precision)
+    void multiplyTransposed(const SingleMatrix& in, SingleMatrix& out) const;
+
+    //! Reserves memory for the given number of rows and elements
+    void reserve(Uint no_rows, Uint no_non_zeros);
+
+  private:
+    Uint m_no_columns;
+    std::vector<Uint> m_row_ptr;
+    std::vector<Uint> m_col_idx;
+    std::vector<Real> m_values;
+
+    template <typename MatrixType>
+    void multiplyAddImpl(const MatrixType& in, MatrixType& out) const;
+
+    template <typename MatrixType>
+    void multiplyTransposedImpl(const MatrixType& in, MatrixType& out) const;
+
+}; // class SparseMatrix
+
+} // namespace util
+} // namespace moka
+
+#endif // MOKA_UTIL_SPARSEMATRIX_H
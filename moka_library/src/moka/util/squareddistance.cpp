@@ -0,0 +1,216 @@
+#include "squareddistance.h"
+
+#if !defined(MOKA_NO_SIMD) && defined(__GNUC__) && !defined(__clang__) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define MOKA_SQUAREDDISTANCE_X86
+#include <immintrin.h>
+#endif
+
+namespace moka {
+namespace util {
+
+typedef SquaredDistance::Real Real;
+typedef SquaredDistance::SingleReal SingleReal;
+typedef SquaredDistance::Uint Uint;
+
+namespace {
+
+/**
+ * Function genericDistance
+ *
+ * Generic version of SquaredDistance::compute (4 independent partial sums).
+ * The elements of a are converted to the type of b before the difference.
+ */
+template <typename DataType, typename Type>
+Type genericDistance(const DataType *a, const Type *b, Uint size, Type bound)
+{
+  Type s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+
+  Uint i = 0;
+  for (; i + 4 <= size; i += 4)
+  {
+    const Type d0 = Type(a[i]) - b[i];
+    const Type d1 = Type(a[i + 1]) - b[i + 1];
+    const Type d2 = Type(a[i + 2]) - b[i + 2];
+    const Type d3 = Type(a[i + 3]) - b[i + 3];
+    s0 += d0 * d0;
+    s1 += d1 * d1;
+    s2 += d2 * d2;
+    s3 += d3 * d3;
+
+    if ((s0 + s1) + (s2 + s3) > bound)
+      return (s0 + s1) + (s2 + s3);
+  } // for i
+
+  Type sum = (s0 + s1) + (s2 + s3);
+  for (; i < size; ++i)
+  {
+    const Type d = Type(a[i]) - b[i];
+    sum += d * d;
+  }
+
+  return sum;
+} // function genericDistance
+
+#ifdef MOKA_SQUAREDDISTANCE_X86
+
+/**
+ * Function sse2Distance
+ *
+ * SSE2 version of SquaredDistance::compute (4 elements at a time, in 2
+ * partial sums of 2 elements).
+ */
+__attribute__((target("sse2")))
+Real sse2Distance(const Real *a, const Real *b, Uint size, Real bound)
+{
+  __m128d s0 = _mm_setzero_pd();
+  __m128d s1 = _mm_setzero_pd();
+  double lanes[2];
+
+  Uint i = 0;
+  for (; i + 4 <= size; i += 4)
+  {
+    __m128d d0 = _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i));
+    __m128d d1 = _mm_sub_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2));
+    s0 = _mm_add_pd(s0, _mm_mul_pd(d0, d0));
+    s1 = _mm_add_pd(s1, _mm_mul_pd(d1, d1));
+
+    // Partial sum (added in registers)
+    __m128d h = _mm_add_pd(s0, s1);
+    h = _mm_add_sd(h, _mm_unpackhi_pd(h, h));
+    if (_mm_cvtsd_f64(h) > bound)
+      return _mm_cvtsd_f64(h);
+  } // for i
+
+  _mm_storeu_pd(lanes, _mm_add_pd(s0, s1));
+  Real sum = lanes[0] + lanes[1];
+  for (; i < size; ++i)
+    sum += (a[i] - b[i]) * (a[i] - b[i]);
+
+  return sum;
+} // function sse2Distance
+
+/**
+ * Function avx2Distance
+ *
+ * AVX2 version of SquaredDistance::compute (8 elements at a time, in 2
+ * partial sums of 4 elements, with fused multiply-add).
+ */
+__attribute__((target("avx2,fma")))
+Real avx2Distance(const Real *a, const Real *b, Uint size, Real bound)
+{
+  __m256d s0 = _mm256_setzero_pd();
+  __m256d s1 = _mm256_setzero_pd();
+  double lanes[4];
+
+  Uint i = 0;
+  for (; i + 8 <= size; i += 8)
+  {
+    __m256d d0 =
+        _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+    __m256d d1 =
+        _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4));
+    s0 = _mm256_fmadd_pd(d0, d0, s0);
+    s1 = _mm256_fmadd_pd(d1, d1, s1);
+
+    // Partial sum (added in registers)
+    const __m256d s = _mm256_add_pd(s0, s1);
+    __m128d h = _mm_add_pd(
+        _mm256_castpd256_pd128(s), _mm256_extractf128_pd(s, 1));
+    h = _mm_add_sd(h, _mm_unpackhi_pd(h, h));
+    if (_mm_cvtsd_f64(h) > bound)
+      return _mm_cvtsd_f64(h);
+  } // for i
+
+  _mm256_storeu_pd(lanes, _mm256_add_pd(s0, s1));
+  Real sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  for (; i < size; ++i)
+    sum += (a[i] - b[i]) * (a[i] - b[i]);
+
+  return sum;
+} // function avx2Distance
+
+#endif // MOKA_SQUAREDDISTANCE_X86
+
+//! Double precision versions of SquaredDistance::compute
+typedef Real (*DistanceFunction)(const Real*, const Real*, Uint, Real);
+
+/**
+ * Function bestDistanceFunction
+ *
+ * Returns the version of SquaredDistance::compute (double precision) for the
+ * best instruction set supported by the CPU (and by this build).
+ */
+DistanceFunction bestDistanceFunction()
+{
+#ifdef MOKA_SQUAREDDISTANCE_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return avx2Distance;
+  if (__builtin_cpu_supports("sse2"))
+    return sse2Distance;
+#endif
+  return genericDistance<Real, Real>;
+} // function bestDistanceFunction
+
+// Version used by SquaredDistance::compute (selected when the library is
+// loaded)
+const DistanceFunction distance_function = bestDistanceFunction();
+
+} // namespace
+
+/**
+ * Method compute
+ *
+ * Returns the squared euclidean distance between the arrays a and b of
+ * length size, or a partial sum of it greater than bound (see the class doc).
+ */
+Real SquaredDistance::compute
+(
+    const Real *a,
+    const Real *b,
+    Uint size,
+    Real bound
+)
+{
+  return distance_function(a, b, size, bound);
+} // method compute
+
+/**
+ * Method compute
+ *
+ * Single precision version of the method above (generic implementation).
+ */
+SingleReal SquaredDistance::compute
+(
+    const SingleReal *a,
+    const SingleReal *b,
+    Uint size,
+    SingleReal bound
+)
+{
+  return genericDistance(a, b, size, bound);
+} // method compute
+
+/**
+ * Method compute
+ *
+ * Mixed precision version of the method above: the elements of a (in double
+ * precision) are converted to single precision one by one, so the result is
+ * the same of the single precision version on a converted copy of a, without
+ * such copy.
+ */
+SingleReal SquaredDistance::compute
+(
+    const Real *a,
+    const SingleReal *b,
+    Uint size,
+    SingleReal bound
+)
+{
+  return genericDistance(a, b, size, bound);
+} // method compute
+
+} // namespace util
+} // namespace moka
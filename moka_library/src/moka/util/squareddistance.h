@@ -0,0 +1,67 @@
+#ifndef MOKA_UTIL_SQUAREDDISTANCE_H
+#define MOKA_UTIL_SQUAREDDISTANCE_H
+
+#include <limits>
+#include <moka/global.h>
+
+namespace moka {
+namespace util {
+
+/**
+ * Class SquaredDistance
+ *
+ * Computes the squared euclidean distance between two arrays
+ *    d = sum_i (a_i - b_i)^2
+ * in a single pass and without temporaries, as required by the nearest unit
+ * searches of the SOM (where only the order of the distances matters, so the
+ * square root is not needed).
+ *
+ * The computation can be abandoned early: if the partial sum exceeds the
+ * passed bound (e.g. the smallest distance found so far) the partial sum is
+ * returned, that is a value greater than the bound but not the distance. The
+ * bound is checked after each step of the loop (4 elements, or 8 with AVX2),
+ * so the computation is abandoned early also on short arrays (e.g. the
+ * states of a small reservoir).
+ *
+ * The double precision version uses the vector instructions of the CPU (SSE2
+ * or AVX2, selected when the library is loaded as the best one supported by
+ * the CPU) otherwise a generic implementation with independent partial sums.
+ * The partial sums are added in a different order with different instruction
+ * sets, so the results may differ by few units in the last place. As for
+ * FastTanh, the vector instructions are used only with GCC (version 4.9 or
+ * later) on x86 processors, and can be disabled by defining MOKA_NO_SIMD.
+ */
+class SquaredDistance
+{
+  public:
+    typedef Global::Real Real;
+    typedef Global::Uint Uint;
+    typedef float SingleReal;
+
+    //! Squared distance between a and b (abandoned above bound)
+    static Real compute(
+        const Real *a,
+        const Real *b,
+        Uint size,
+        Real bound = std::numeric_limits<Real>::max());
+
+    //! Squared distance between a and b (abandoned above bound)
+    static SingleReal compute(
+        const SingleReal *a,
+        const SingleReal *b,
+        Uint size,
+        SingleReal bound = std::numeric_limits<SingleReal>::max());
+
+    //! As above, with a in double precision (converted while computing)
+    static SingleReal compute(
+        const Real *a,
+        const SingleReal *b,
+        Uint size,
+        SingleReal bound = std::numeric_limits<SingleReal>::max());
+
+}; // class SquaredDistance
+
+} // namespace util
+} // namespace moka
+
+#endif // MOKA_UTIL_SQUAREDDISTANCE_H
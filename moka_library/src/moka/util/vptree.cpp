@@ -0,0 +1,314 @@
+#include "vptree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <moka/exception.h>
+#include <moka/util/squareddistance.h>
+
+namespace moka {
+namespace util {
+
+typedef VpTree::Real Real;
+typedef VpTree::Uint Uint;
+
+namespace {
+
+// Maximum number of points in a leaf
+const Uint leaf_size = 8;
+
+// Relative slack of the bounds of the search, so the subtrees holding points
+// at the same distance of the farthest candidate are not skipped because of
+// the rounding errors (the points with the smallest index win the ties)
+const Real rounding_slack = 1e-12;
+
+} // namespace
+
+// ==============
+// PUBLIC METHODS
+// ==============
+
+/**
+ * Constructor
+ */
+VpTree::VpTree()
+{ }
+
+/**
+ * Method build
+ *
+ * Builds the tree over the columns of POINTS (the point i is the column i),
+ * that are copied in the tree.
+ */
+void VpTree::build(const Matrix& points)
+{
+  clear();
+  if (points.n_cols == 0)
+    return;
+
+  m_points = points;
+  m_order.resize(points.n_cols);
+  for (Uint i = 0; i < m_order.size(); ++i)
+    m_order[i] = i;
+
+  m_nodes.reserve(2 * (points.n_cols / leaf_size) + 1);
+  buildNode(0, points.n_cols);
+
+  return;
+} // method build
+
+/**
+ * Method clear
+ *
+ * Clears the tree (removing all the points).
+ */
+void VpTree::clear()
+{
+  m_points.clear();
+  m_order.clear();
+  m_nodes.clear();
+  return;
+} // method clear
+
+/**
+ * Method nearest
+ *
+ * Returns the index of the point nearest to X (an array of getDimension()
+ * elements). The tree must not be empty, otherwise an exception of type
+ * moka::GenericException will be thrown.
+ */
+Uint VpTree::nearest(const Real *x) const
+{
+  if (isEmpty())
+    throw moka::GenericException("VpTree::nearest: empty tree");
+
+  Candidates candidates;
+  candidates.reserve(1);
+  search(0, x, 1, candidates);
+
+  return candidates.front().second;
+} // method nearest
+
+/**
+ * Method nearest
+ *
+ * Fills the vector POINTS with the indexes of the K points nearest to X (an
+ * array of getDimension() elements), from the nearest to the farthest. If the
+ * tree has less than K points, all its points are returned.
+ */
+void VpTree::nearest
+(
+    const Real *x,
+    Uint k,
+    std::vector<Uint>& points
+) const
+{
+  points.clear();
+  if (isEmpty() || k == 0)
+    return;
+
+  Candidates candidates;
+  candidates.reserve(k + 1);
+  search(0, x, k, candidates);
+
+  std::sort_heap(candidates.begin(), candidates.end());
+  points.reserve(candidates.size());
+  for (size_t i = 0; i < candidates.size(); ++i)
+    points.push_back(candidates[i].second);
+
+  return;
+} // method nearest
+
+// ===============
+// PRIVATE METHODS
+// ===============
+
+/**
+ * Method addCandidate
+ *
+ * Adds the point (with its squared distance from the query) to the K nearest
+ * points found so far, if it is nearer than the farthest of them (or on ties
+ * if it has a smaller index).
+ */
+inline
+void VpTree::addCandidate
+(
+    Real sq_dist,
+    Uint point,
+    Uint k,
+    Candidates& candidates
+) const
+{
+  const std::pair<Real, Uint> candidate(sq_dist, point);
+
+  if (candidates.size() < k)
+  {
+    candidates.push_back(candidate);
+    std::push_heap(candidates.begin(), candidates.end());
+  }
+  else if (candidate < candidates.front())
+  {
+    std::pop_heap(candidates.begin(), candidates.end());
+    candidates.back() = candidate;
+    std::push_heap(candidates.begin(), candidates.end());
+  }
+
+  return;
+} // method addCandidate
+
+/**
+ * Method buildNode
+ *
+ * Builds the subtree of the points m_order[begin, end) and returns the index
+ * of its root. The vantage point is the farthest point from the first one of
+ * the subset (a point at the border of the subset splits it better).
+ */
+Uint VpTree::buildNode(Uint begin, Uint end)
+{
+  const Uint node = m_nodes.size();
+  m_nodes.push_back(Node());
+  m_nodes[node].begin = begin;
+  m_nodes[node].end = end;
+  m_nodes[node].radius = 0.0;
+  m_nodes[node].inside = 0;
+  m_nodes[node].outside = 0;
+  m_nodes[node].leaf = (end - begin <= leaf_size);
+
+  if (m_nodes[node].leaf)
+    return node;
+
+  // Vantage point
+  const Uint dim = m_points.n_rows;
+  Uint vantage = begin;
+  Real vantage_dist = -1.0;
+  for (Uint i = begin + 1; i < end; ++i)
+  {
+    const Real dist = SquaredDistance::compute(
+        m_points.colptr(m_order[begin]),
+        m_points.colptr(m_order[i]),
+        dim);
+    if (dist > vantage_dist)
+    {
+      vantage = i;
+      vantage_dist = dist;
+    }
+  } // for i
+  std::swap(m_order[begin], m_order[vantage]);
+
+  // Splits the other points by the median distance from the vantage point
+  std::vector< std::pair<Real, Uint> > dists;
+  dists.reserve(end - begin - 1);
+  for (Uint i = begin + 1; i < end; ++i)
+    dists.push_back(
+        std::make_pair(
+            std::sqrt(
+                SquaredDistance::compute(
+                    m_points.colptr(m_order[begin]),
+                    m_points.colptr(m_order[i]),
+                    dim)),
+            m_order[i]));
+
+  const Uint median = dists.size() / 2;
+  std::nth_element(dists.begin(), dists.begin() + median, dists.end());
+  for (Uint i = 0; i < dists.size(); ++i)
+    m_order[begin + 1 + i] = dists[i].second;
+
+  // Subtrees (m_nodes can be reallocated by the recursive calls)
+  const Uint inside = buildNode(begin + 1, begin + 1 + median);
+  const Uint outside = buildNode(begin + 1 + median, end);
+  m_nodes[node].radius = dists[median].first;
+  m_nodes[node].inside = inside;
+  m_nodes[node].outside = outside;
+
+  return node;
+} // method buildNode
+
+/**
+ * Method search
+ *
+ * Searches the K points nearest to X in the subtree of NODE, updating the
+ * candidates found so far. A subtree is visited only if the ball centered in
+ * X through the farthest candidate (of radius tau) intersects it: the inside
+ * subtree holds the points within the node radius r from the vantage point
+ * (at distance d from X), so it is visited if d - tau <= r, and the outside
+ * subtree if d + tau >= r. The nearer subtree is visited first, so tau
+ * shrinks sooner.
+ */
+void VpTree::search
+(
+    Uint node,
+    const Real *x,
+    Uint k,
+    Candidates& candidates
+) const
+{
+  const Node& n = m_nodes[node];
+  const Uint dim = m_points.n_rows;
+
+  // Squared distance of the farthest candidate
+  Real tau_sq = std::numeric_limits<Real>::max();
+  if (candidates.size() == k)
+    tau_sq = candidates.front().first;
+
+  if (n.leaf)
+  {
+    for (Uint i = n.begin; i < n.end; ++i)
+    {
+      const Real sq_dist = SquaredDistance::compute(
+          x,
+          m_points.colptr(m_order[i]),
+          dim,
+          tau_sq);
+      if (sq_dist <= tau_sq)
+      {
+        addCandidate(sq_dist, m_order[i], k, candidates);
+        if (candidates.size() == k)
+          tau_sq = candidates.front().first;
+      }
+    } // for i
+    return;
+  } // if
+
+  const Uint vantage = m_order[n.begin];
+  const Real sq_dist =
+      SquaredDistance::compute(x, m_points.colptr(vantage), dim);
+  addCandidate(sq_dist, vantage, k, candidates);
+  const Real dist = std::sqrt(sq_dist);
+
+  if (dist < n.radius)
+  {
+    search(n.inside, x, k, candidates);
+    if (candidates.size() < k || dist + tau(dist, n, candidates) >= n.radius)
+      search(n.outside, x, k, candidates);
+  }
+  else
+  {
+    search(n.outside, x, k, candidates);
+    if (candidates.size() < k || dist - tau(dist, n, candidates) <= n.radius)
+      search(n.inside, x, k, candidates);
+  }
+
+  return;
+} // method search
+
+/**
+ * Method tau
+ *
+ * Returns the distance of the farthest candidate (there must be k candidates)
+ * increased by a small slack, relative to the distances compared in the node
+ * (see rounding_slack).
+ */
+inline
+Real VpTree::tau
+(
+    Real dist,
+    const Node& node,
+    const Candidates& candidates
+) const
+{
+  const Real t = std::sqrt(candidates.front().first);
+  return t + rounding_slack * (dist + t + node.radius);
+} // method tau
+
+} // namespace util
+} // namespace moka
@@ -0,0 +1,121 @@
+#ifndef MOKA_UTIL_VPTREE_H
+#define MOKA_UTIL_VPTREE_H
+
+#include <utility>
+#include <vector>
+#include <moka/global.h>
+#include <moka/util/math.h>
+
+namespace moka {
+namespace util {
+
+/**
+ * Class VpTree
+ *
+ * A vantage point tree [1] over a set of points (the columns of a matrix),
+ * for the exact search of the nearest points (in euclidean distance) to a
+ * query point. Each node of the tree takes a point of its subset (the
+ * vantage point) and splits the other points by the median of their
+ * distances from it: the points within such radius go in the inside subtree,
+ * the others in the outside subtree. The search visits a subtree only if it
+ * can hold a point closer than the farthest one found so far (by the triangle
+ * inequality), so it visits a small part of the tree when the points are
+ * clustered (e.g. the codebooks of a trained SOM). Small subsets are stored
+ * in the leaves and scanned linearly (see SquaredDistance).
+ *
+ * On ties the point with the smallest index is returned, as in a linear scan
+ * of the columns.
+ *
+ * The tree keeps a copy of the points: it is built once (see build) and it
+ * must be built again when the points change.
+ *
+ * References
+ *   [1] P. N. Yianilos. Data structures and algorithms for nearest neighbor
+ *       search in general metric spaces. 1993.
+ */
+class VpTree
+{
+  public:
+    typedef Global::Real Real;
+    typedef Global::Uint Uint;
+    typedef Math::Matrix Matrix;
+
+    //! Default constructor (builds an empty tree)
+    VpTree();
+
+    //! Builds the tree over the columns of the passed matrix
+    void build(const Matrix& points);
+
+    //! Clears the tree
+    void clear();
+
+    //! Dimension of the points
+    Uint getDimension() const
+    {
+      return m_points.n_rows;
+    }
+
+    //! Number of points
+    Uint getSize() const
+    {
+      return m_points.n_cols;
+    }
+
+    //! True if the tree has no points
+    bool isEmpty() const
+    {
+      return m_nodes.empty();
+    }
+
+    //! Index of the point nearest to x
+    Uint nearest(const Real *x) const;
+
+    //! Indexes of the k points nearest to x (from the nearest)
+    void nearest(const Real *x, Uint k, std::vector<Uint>& points) const;
+
+  private:
+    //! Candidate nearest points (squared distance, index) as a max heap
+    typedef std::vector< std::pair<Real, Uint> > Candidates;
+
+    //! Node of the tree: a leaf holds the points m_order[begin, end), an
+    //! internal node has the vantage point m_order[begin] and the subtrees of
+    //! the points m_order[begin + 1, end)
+    struct Node
+    {
+      Uint begin;
+      Uint end;
+      Real radius;
+      Uint inside;
+      Uint outside;
+      bool leaf;
+    };
+
+    Matrix m_points;
+    std::vector<Uint> m_order;
+    std::vector<Node> m_nodes;
+
+    void addCandidate(
+        Real sq_dist,
+        Uint point,
+        Uint k,
+        Candidates& candidates) const;
+
+    Uint buildNode(Uint begin, Uint end);
+
+    void search(
+        Uint node,
+        const Real *x,
+        Uint k,
+        Candidates& candidates) const;
+
+    Real tau(
+        Real dist,
+        const Node& node,
+        const Candidates& candidates) const;
+
+}; // class VpTree
+
+} // namespace util
+} // namespace moka
+
+#endif // MOKA_UTIL_VPTREE_H
@@ -22,6 +22,7 @@ INCLUDEPATH += $$MLPACK_INCLUDES
 INCLUDEPATH += $$LIBXML2_INCLUDES
 
 SOURCES += \
+    moka/dataset/binarygraphfile.cpp \
     moka/dataset/csvdataset.cpp \
     moka/dataset/dataset.cpp \
     moka/dataset/datasetdispenser.cpp \
@@ -36,17 +37,23 @@ SOURCES += \
     moka/procedure/crossvalidation.cpp \
     moka/structure/graph.cpp \
     moka/structure/labeledgraph.cpp \
+    moka/structure/labelset.cpp \
     moka/structure/multilabeledgraph.cpp \
     moka/util/parameters.cpp \
+    moka/util/fasttanh.cpp \
     moka/util/info.cpp \
     moka/util/timer.cpp \
     moka/util/math.cpp \
+    moka/util/sparsematrix.cpp \
+    moka/util/squareddistance.cpp \
+    moka/util/vptree.cpp \
     moka/exception.cpp \
     moka/global.cpp \
     moka/log.cpp \
     moka/model/graphesnsom.cpp
 
 HEADERS += \
+    moka/dataset/binarygraphfile.h \
     moka/dataset/csvdataset.h \
     moka/dataset/dataset.h \
     moka/dataset/datasetdispenser.h \
@@ -64,13 +71,18 @@ HEADERS += \
     moka/structure/graph.h \
     moka/structure/graph_impl.h \
     moka/structure/labeledgraph.h \
+    moka/structure/labelset.h \
     moka/structure/multilabeledgraph.h \
+    moka/util/fasttanh.h \
     moka/util/info.h \
     moka/util/info_impl.h \
     moka/util/math.h \
     moka/util/math_impl.h \
     moka/util/parameters.h \
+    moka/util/sparsematrix.h \
+    moka/util/squareddistance.h \
     moka/util/timer.h \
+    moka/util/vptree.h \
     moka/exception.h \
     moka/global.h \
     moka/global_impl.h \
@@ -36,7 +36,7 @@ CONFIG(release, debug|release): \
 LIBS += -L$$OTHER_LIBRARIES_PATH
 LIBS += -llapack -lblas -lxml2 -lpthread -lgfortran
 LIBS += -L$$BOOST_LIBRARIES -lboost_filesystem -lboost_system \
-        -lboost_program_options
+        -lboost_program_options -lboost_thread -lboost_iostreams
 LIBS += -L$$ARMADILLO_LIBRARIES -larmadillo
 LIBS += -L$$OPENBABEL_LIBRARIES -lopenbabel
 LIBS += -L$$MLPACK_LIBRARIES -lmlpack
@@ -24,7 +24,8 @@ CONFIG(debug, debug|release): PRE_TARGETDEPS += ../../debug/libmoka.a
 # Shared libraries links
 LIBS += -lboost_program_options
 LIBS += -llapack -lblas -lxml2 -lpthread -lgfortran
-LIBS += -L$$BOOST_LIBRARIES -lboost_filesystem -lboost_system
+LIBS += -L$$BOOST_LIBRARIES -lboost_filesystem -lboost_system -lboost_thread
+LIBS += -lboost_iostreams
 LIBS += -L$$ARMADILLO_LIBRARIES -larmadillo
 LIBS += -L$$OPENBABEL_LIBRARIES -lopenbabel
 LIBS += -L$$MLPACK_LIBRARIES -lmlpack
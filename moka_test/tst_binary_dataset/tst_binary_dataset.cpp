@@ -0,0 +1,140 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <moka/dataset/multilabeledgraphdataset.h>
+#include <moka/log.h>
+#include <moka/structure/multilabeledgraph.h>
+#include <moka/util/parameters.h>
+
+using namespace moka;
+using namespace moka::dataset;
+using namespace moka::structure;
+using namespace moka::util;
+
+typedef Global::Uint Uint;
+
+/**
+ * Function sameGraph
+ *
+ * Returns true if the two graphs have the same verteces (labels, elements and
+ * neighbors) and the same label names.
+ */
+bool sameGraph(const MultiLabeledGraph& a, const MultiLabeledGraph& b)
+{
+  if (a.getSize() != b.getSize() ||
+      a.getElementsSize() != b.getElementsSize() ||
+      a.getLabelNameSize() != b.getLabelNameSize())
+    return false;
+
+  for (Uint i = 0; i < a.getLabelNameSize(); ++i)
+    if (a.getLabelName(i) != b.getLabelName(i))
+      return false;
+
+  for (Uint v = 0; v < a.getSize(); ++v)
+  {
+    if (a.getVertexItem(v).getLabels() != b.getVertexItem(v).getLabels() ||
+        a.getNeighbors(v) != b.getNeighbors(v))
+      return false;
+    for (Uint i = 0; i < a.getElementsSize(); ++i)
+      if (a.getVertexElement(v)[i] != b.getVertexElement(v)[i])
+        return false;
+  } // for v
+
+  return true;
+} // function sameGraph
+
+/**
+ * Function compareDatasets
+ *
+ * Compares the instances (ids, outputs and graphs) of a dataset read back
+ * from the binary file with the original one. Returns true if they are all
+ * the same.
+ */
+bool compareDatasets
+(
+    const std::string& name,
+    const MultiLabeledGraphDataset& expected,
+    const MultiLabeledGraphDataset& dataset
+)
+{
+  Uint failed = 0;
+  if (dataset.getSize() != expected.getSize())
+    failed++;
+  else
+    for (Uint i = 0; i < dataset.getSize(); ++i)
+      if (dataset.getId(i) != expected.getId(i) ||
+          dataset.getOutput(i) != expected.getOutput(i) ||
+          !sameGraph(dataset.getInput(i), expected.getInput(i)))
+        failed++;
+
+  Log::out << name << ": " << dataset.getSize() << " instances, " << failed
+           << " different: " << (failed == 0 ? "ok" : "FAILED") << Log::endl;
+
+  return failed == 0;
+} // function compareDatasets
+
+/**
+ * Function main
+ *
+ * Loads a dataset from a SDF file, writes it in the binary format (see
+ * BinaryGraphFile) and reads it back by all the ways (read of the file,
+ * mapped file), comparing each result with the original dataset. Returns 1
+ * if some dataset differs.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc < 4 + 1)
+  {
+    Log::out << "Usage: \n";
+    Log::out << "  argv[1] : sdf file \n";
+    Log::out << "  argv[2] : id name \n";
+    Log::out << "  argv[3] : output name \n";
+    Log::out << "  argv[4] : binary file to write \n";
+    Log::out << Log::endl;
+    return 1;
+  } // if (argc < ...)
+
+  // Original dataset (with labels on the verteces)
+  Parameters sdf_prm;
+  sdf_prm["load-from"] = "sdf-file";
+  sdf_prm["file-path"] = argv[1];
+  sdf_prm["id-name"] = argv[2];
+  sdf_prm["output-name"] = argv[3];
+  sdf_prm["no-outputs"] = "1";
+  sdf_prm["add-lbl-atom-symbol"] = "true";
+  sdf_prm["add-lbl-smile-round-k"] = "1";
+
+  MultiLabeledGraphDataset expected;
+  expected.load(sdf_prm);
+
+  // Binary file
+  {
+    std::ofstream ofs(argv[4], std::ofstream::out | std::ofstream::binary);
+    expected.writeBinary(ofs);
+  }
+
+  bool ok = true;
+
+  // Read of the file
+  Parameters read_prm;
+  read_prm["load-from"] = "dataset-file";
+  read_prm["file-path"] = argv[4];
+  MultiLabeledGraphDataset read_dataset;
+  read_dataset.load(read_prm);
+  ok = compareDatasets("read", expected, read_dataset) && ok;
+
+  // Mapped file (the graphs are built at their first access)
+  Parameters mapped_prm;
+  mapped_prm["load-from"] = "mapped-dataset-file";
+  mapped_prm["file-path"] = argv[4];
+  MultiLabeledGraphDataset mapped_dataset;
+  mapped_dataset.load(mapped_prm);
+  ok = compareDatasets("mapped", expected, mapped_dataset) && ok;
+  ok = compareDatasets("mapped (second access)", expected, mapped_dataset) &&
+      ok;
+
+  Log::out << (ok ? "All tests passed" : "Some tests FAILED") << Log::endl;
+
+  return ok ? 0 : 1;
+} // function main
@@ -0,0 +1,10 @@
+TARGET = ../../bin/tst_binary_dataset
+
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt
+
+include(../common_config.pro)
+
+SOURCES += \
+    tst_binary_dataset.cpp
@@ -0,0 +1,141 @@
+#include <set>
+#include <string>
+#include <moka/dataset/multilabeledgraphdataset.h>
+#include <moka/log.h>
+#include <moka/model/graphesnsom.h>
+#include <moka/util/parameters.h>
+
+using namespace moka;
+using namespace moka::dataset;
+using namespace moka::model;
+using namespace moka::util;
+
+typedef Global::Uint Uint;
+typedef Model::NumericResults NumericResults;
+
+/**
+ * Function modelParameters
+ *
+ * Returns the parameters of a small GraphEsnSom (with fixed seeds), with the
+ * reservoir states cache enabled or not.
+ */
+Parameters modelParameters(bool state_cache)
+{
+  Parameters prm;
+  prm["reservoir-size"] = "20";
+  prm["reservoir-connectivity"] = "0.5";
+  prm["reservoir-sigma"] = "0.9";
+  prm["reservoir-rseed"] = "1";
+  prm["reservoir-state-cache"] = state_cache ? "true" : "false";
+  prm["som-no-rows"] = "5";
+  prm["som-no-cols"] = "5";
+  prm["som-rseed"] = "1";
+  prm["regularization"] = "ridge-regression";
+  prm["ridge-regression-lambda"] = "1e-02";
+  return prm;
+} // function modelParameters
+
+/**
+ * Function compareResults
+ *
+ * Compares the passed entries of two sets of results, that must be equal.
+ * Returns true if they are.
+ */
+bool compareResults
+(
+    const std::string& name,
+    NumericResults expected,
+    NumericResults results,
+    const std::set<std::string>& keys
+)
+{
+  bool ok = true;
+  std::set<std::string>::const_iterator it;
+  for (it = keys.begin(); it != keys.end(); ++it)
+    ok = ok && results[*it].value == expected[*it].value;
+
+  Log::out << name << ": " << (ok ? "ok" : "FAILED") << Log::endl;
+
+  return ok;
+} // function compareResults
+
+/**
+ * Function main
+ *
+ * Loads a dataset from a SDF file taking the instance ids from a data field
+ * with repeated values (e.g. the class of the molecules), then trains and
+ * tests a GraphEsnSom with the reservoir states cache and the same model
+ * without it: the results must be the same, also when all the states are
+ * taken from the cache (test after the training, training after a reset), so
+ * the cache must not mix up the instances with the same id. Returns 1 if
+ * some result differs.
+ */
+int main(int argc, char *argv[])
+{
+  if (argc < 3 + 1)
+  {
+    Log::out << "Usage: \n";
+    Log::out << "  argv[1] : sdf file \n";
+    Log::out << "  argv[2] : id name (a data field with repeated values) \n";
+    Log::out << "  argv[3] : output name \n";
+    Log::out << Log::endl;
+    return 1;
+  } // if (argc < ...)
+
+  Parameters sdf_prm;
+  sdf_prm["load-from"] = "sdf-file";
+  sdf_prm["file-path"] = argv[1];
+  sdf_prm["id-name"] = argv[2];
+  sdf_prm["output-name"] = argv[3];
+  sdf_prm["no-outputs"] = "1";
+
+  MultiLabeledGraphDataset dataset;
+  dataset.load(sdf_prm);
+
+  std::set<std::string> ids;
+  for (Uint i = 0; i < dataset.getSize(); ++i)
+    ids.insert(dataset.getId(i));
+  const bool repeated_ids = ids.size() < dataset.getSize();
+  Log::out << "dataset: " << dataset.getSize() << " instances, " << ids.size()
+           << " different ids: " << (repeated_ids ? "ok" : "FAILED")
+           << Log::endl;
+
+  std::set<std::string> training_keys, test_keys;
+  training_keys.insert("res_avg_iters");
+  training_keys.insert("rout_fnorm");
+  training_keys.insert("rout_bias");
+  test_keys.insert("mse");
+  test_keys.insert("acc");
+
+  // Without the cache
+  GraphEsnSom expected;
+  expected.setParameters(modelParameters(false));
+  expected.bindTrainingSet(&dataset);
+  expected.init();
+  const NumericResults expected_training = expected.train();
+  const NumericResults expected_test = expected.testOn(dataset);
+
+  // With the cache (filled by the first training)
+  GraphEsnSom cached;
+  cached.setParameters(modelParameters(true));
+  cached.bindTrainingSet(&dataset);
+  cached.init();
+
+  bool ok = repeated_ids;
+  ok = compareResults(
+      "training", expected_training, cached.train(), training_keys) && ok;
+  ok = compareResults(
+      "test (cached states)", expected_test, cached.testOn(dataset),
+      test_keys) && ok;
+  cached.reset();
+  ok = compareResults(
+      "training after reset (cached states)", expected_training,
+      cached.train(), training_keys) && ok;
+  ok = compareResults(
+      "test after reset (cached states)", expected_test,
+      cached.testOn(dataset), test_keys) && ok;
+
+  Log::out << (ok ? "All tests passed" : "Some tests FAILED") << Log::endl;
+
+  return ok ? 0 : 1;
+} // function main
@@ -0,0 +1,10 @@
+TARGET = ../../bin/tst_graphesnsom_state_cache
+
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt
+
+include(../common_config.pro)
+
+SOURCES += \
+    tst_graphesnsom_state_cache.cpp
@@ -0,0 +1,427 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <moka/global.h>
+#include <moka/ml/graphreservoir.h>
+#include <moka/structure/multilabeledgraph.h>
+
+using namespace moka;
+using namespace moka::ml;
+using namespace moka::structure;
+using namespace moka::util;
+
+typedef Global::Uint Uint;
+typedef Global::Real Real;
+typedef GraphReservoir<MultiLabeledGraph> Reservoir;
+
+namespace {
+
+const Uint input_size = 4;
+const Real sigma = 0.9;
+const Real epsilon = 1e-6;
+
+// Each encoding stops within sigma / (1 - sigma) * epsilon from the fixed
+// point, so two encodings can differ by twice such distance
+const Real tolerance = 2 * sigma / (1 - sigma) * epsilon;
+
+} // namespace
+
+/**
+ * Function chainGraph
+ *
+ * Builds a chain of "size" vertices: the first tenth of the vertices have
+ * random inputs, the other ones the same input, so the regions of the chain
+ * reach the fixed point at different iterations.
+ */
+MultiLabeledGraph chainGraph(Uint size)
+{
+  MultiLabeledGraph graph;
+  for (Uint n = 0; n < size; ++n)
+  {
+    Math::Vector *element = new Math::Vector(input_size);
+    for (Uint j = 0; j < input_size; ++j)
+      (*element)[j] =
+          (n < size / 10) ? Global::getRandInt(0, 1) : (j == 0 ? 1 : 0);
+
+    std::vector<Uint> *neighbors = new std::vector<Uint>();
+    if (n > 0)
+      neighbors->push_back(n - 1);
+    if (n + 1 < size)
+      neighbors->push_back(n + 1);
+
+    graph.pushBack(std::vector<std::string>(1, "C"), element, neighbors);
+  } // for n
+
+  return graph;
+} // function chainGraph
+
+/**
+ * Function randomGraph
+ *
+ * Builds a random connected graph of "size" vertices (a random tree with
+ * size / 3 more random edges) with random binary inputs.
+ */
+MultiLabeledGraph randomGraph(Uint size)
+{
+  std::vector< std::vector<Uint> > neighbors(size);
+  for (Uint n = 1; n < size; ++n)
+  {
+    Uint m = Global::getRandInt(0, n - 1);
+    neighbors[n].push_back(m);
+    neighbors[m].push_back(n);
+  } // for n
+  for (Uint e = 0; e < size / 3; ++e)
+  {
+    Uint n = Global::getRandInt(0, size - 1);
+    Uint m = Global::getRandInt(0, size - 1);
+    if (n != m &&
+        std::find(neighbors[n].begin(), neighbors[n].end(), m) ==
+          neighbors[n].end())
+    {
+      neighbors[n].push_back(m);
+      neighbors[m].push_back(n);
+    }
+  } // for e
+
+  MultiLabeledGraph graph;
+  for (Uint n = 0; n < size; ++n)
+  {
+    Math::Vector *element = new Math::Vector(input_size);
+    for (Uint j = 0; j < input_size; ++j)
+      (*element)[j] = Global::getRandInt(0, 1);
+    graph.pushBack(
+        std::vector<std::string>(1, "C"),
+        element,
+        new std::vector<Uint>(neighbors[n]));
+  } // for n
+
+  return graph;
+} // function randomGraph
+
+/**
+ * Function maxDistance
+ *
+ * Returns the maximum distance between the states of the same vertex in two
+ * state graphs.
+ */
+Real maxDistance(const MultiLabeledGraph& a, const MultiLabeledGraph& b)
+{
+  Real max_distance = 0;
+  for (Uint n = 0; n < a.getSize(); ++n)
+    max_distance =
+        std::max<Real>(
+          max_distance,
+          arma::norm(a.getVertexElement(n) - b.getVertexElement(n), 2));
+  return max_distance;
+} // function maxDistance
+
+/**
+ * Function referenceEncoding
+ *
+ * Computes the encoding of the graph through the plain Picard iteration
+ *    x_{t}(n) = tanh(W_in * [1; u(n)] + Sum_{n'} W_hat * x_{t-1}(n'))
+ * on the matrices of the reservoir, with the same operations of the vertex
+ * encoding, but checking the fixed point reaching through arma::norm as the
+ * vertex encoding did before the change of the states was computed together
+ * with the states. Stores the resulting states in "states" and returns the
+ * number of iterations.
+ */
+Uint referenceEncoding
+(
+    const Reservoir& reservoir,
+    const MultiLabeledGraph& graph,
+    std::vector<Math::Vector>& states
+)
+{
+  const Math::Matrix& W_in = reservoir.getInputMatrix();
+  const Math::Matrix& W_hat = reservoir.getReservoirMatrix();
+
+  Math::Matrix inputs(input_size + 1, graph.getSize());
+  for (Uint n = 0; n < graph.getSize(); ++n)
+  {
+    inputs(0, n) = 1;
+    for (Uint j = 0; j < input_size; ++j)
+      inputs(j + 1, n) = graph.getVertexElement(n)[j];
+  } // for n
+  const Math::Matrix drives = W_in * inputs;
+
+  states.assign(graph.getSize(), Math::Vector(W_hat.n_rows));
+  for (Uint n = 0; n < states.size(); ++n)
+    states[n].zeros();
+
+  Uint iterations = 0;
+  while (iterations < reservoir.getMaxIterations())
+  {
+    const std::vector<Math::Vector> previous = states;
+    Real max_n_norm = 0;
+    for (Uint n = 0; n < graph.getSize(); ++n)
+    {
+      Math::Vector vsum(W_hat.n_rows);
+      vsum.zeros();
+      for (Uint i = 0; i < graph.getNeighbors(n).size(); ++i)
+        vsum += W_hat * previous[graph.getNeighbors(n)[i]];
+      for (Uint k = 0; k < vsum.n_elem; ++k)
+        states[n][k] = std::tanh(drives(k, n) + vsum[k]);
+      max_n_norm =
+          std::max<Real>(max_n_norm, arma::norm(states[n] - previous[n], 2));
+    } // for n
+
+    iterations++;
+    if (max_n_norm <= reservoir.getEpsilon())
+      break;
+  } // while iterations
+
+  return iterations;
+} // function referenceEncoding
+
+/**
+ * Function testConvergenceCheck
+ *
+ * Compares the vertex encoding (with the change of the states computed
+ * together with the states) with the reference encoding: the iterations and
+ * the states must be the same, bit for bit.
+ */
+bool testConvergenceCheck
+(
+    Reservoir& reservoir,
+    const MultiLabeledGraph& graph
+)
+{
+  std::vector<Math::Vector> states;
+  Uint iterations = referenceEncoding(reservoir, graph, states);
+
+  bool converged = reservoir.encoding(graph);
+  Uint different = 0;
+  for (Uint n = 0; n < graph.getSize(); ++n)
+  {
+    const Math::Vector& state =
+        reservoir.getLastStateGraph().getVertexElement(n);
+    for (Uint k = 0; k < state.n_elem; ++k)
+      if (state[k] != states[n][k])
+        different++;
+  } // for n
+  Uint last_iterations = reservoir.getLastNumberOfIterations();
+  bool ok = converged && different == 0 && last_iterations == iterations;
+
+  std::cout << "  convergence check: " << last_iterations << " iterations ("
+            << iterations << " with arma::norm), " << different
+            << " different state components: " << (ok ? "ok" : "FAILED")
+            << std::endl;
+
+  return ok;
+} // function testConvergenceCheck
+
+/**
+ * Function compareEncoding
+ *
+ * Encodes the graph with the current settings of the reservoir and compares
+ * the result with the expected state graph. Returns true if the two state
+ * graphs are within the tolerance.
+ */
+bool compareEncoding
+(
+    const std::string& name,
+    Reservoir& reservoir,
+    const MultiLabeledGraph& graph,
+    const MultiLabeledGraph& expected
+)
+{
+  bool converged = reservoir.encoding(graph);
+  Real distance = maxDistance(reservoir.getLastStateGraph(), expected);
+  bool ok = converged && distance <= tolerance;
+
+  std::cout << "  " << name << ": "
+            << reservoir.getLastNumberOfIterations() << " iterations, "
+            << "max distance " << distance << " (tolerance " << tolerance
+            << "): " << (ok ? "ok" : "FAILED") << std::endl;
+
+  return ok;
+} // function compareEncoding
+
+/**
+ * Function testGraph
+ *
+ * Compares the encodings of the graph (with all the encoding modes and
+ * solvers, and with the sparse W_hat) with the vertex encoding on the dense
+ * W_hat, returns the number of failed comparisons.
+ */
+Uint testGraph
+(
+    const std::string& name,
+    const MultiLabeledGraph& graph,
+    Uint reservoir_size,
+    Real connectivity = 1.0
+)
+{
+  Reservoir reservoir;
+  reservoir.setInputSize(input_size);
+  reservoir.setReservoirSize(reservoir_size);
+  reservoir.setReservoirConnectivity(connectivity);
+  reservoir.setSparseThreshold(0.0);
+  reservoir.setMaxDegree(graph.maxDegree());
+  reservoir.setSigma(sigma);
+  reservoir.setEpsilon(epsilon);
+  reservoir.setMaxIterations(10000);
+  reservoir.setRandomSeed(1);
+  reservoir.init();
+
+  std::cout << name << " (" << graph.getSize() << " vertices, N_r "
+            << reservoir_size << ", connectivity " << connectivity << ")"
+            << std::endl;
+
+  // Expected states (vertex encoding)
+  reservoir.encoding(graph);
+  const MultiLabeledGraph expected = reservoir.getLastStateGraph();
+
+  Uint failed = 0;
+
+  failed += !testConvergenceCheck(reservoir, graph);
+
+  // Encoding modes
+  reservoir.setEncodingMode(Reservoir::batched_encoding);
+  failed += !compareEncoding("batched", reservoir, graph, expected);
+  reservoir.setEncodingMode(Reservoir::active_set_encoding);
+  failed += !compareEncoding("active set", reservoir, graph, expected);
+  reservoir.setEncodingMode(Reservoir::fixed_size_encoding);
+  failed += !compareEncoding("fixed size", reservoir, graph, expected);
+  reservoir.setEncodingMode(Reservoir::vertex_encoding);
+
+  // Solvers
+  reservoir.setSolver(Reservoir::anderson_solver);
+  failed += !compareEncoding("anderson", reservoir, graph, expected);
+  reservoir.setSolver(Reservoir::gauss_seidel_solver);
+  failed += !compareEncoding("gauss-seidel", reservoir, graph, expected);
+  reservoir.setSolver(Reservoir::picard_solver);
+
+  // Sparse W_hat (the same matrix, so the same fixed point)
+  reservoir.setSparseThreshold(2.0);
+  if (!reservoir.isReservoirMatrixSparse())
+  {
+    std::cout << "  sparse: W_hat not sparse: FAILED" << std::endl;
+    failed++;
+  }
+  failed += !compareEncoding("sparse vertex", reservoir, graph, expected);
+  reservoir.setEncodingMode(Reservoir::batched_encoding);
+  failed += !compareEncoding("sparse batched", reservoir, graph, expected);
+  reservoir.setEncodingMode(Reservoir::active_set_encoding);
+  failed += !compareEncoding("sparse active set", reservoir, graph, expected);
+  reservoir.setEncodingMode(Reservoir::vertex_encoding);
+
+  return failed;
+} // function testGraph
+
+/**
+ * Function testEnsemble
+ *
+ * Encodes the graph with an ensemble of reservoirs and compares each member
+ * with a single reservoir built with the member seed: the matrices must be
+ * the same blocks of the ensemble matrices, and the member state graph (see
+ * splitStateGraph) must be within the tolerance from the state graph of the
+ * single reservoir. Returns the number of failed comparisons.
+ */
+Uint testEnsemble
+(
+    const std::string& name,
+    const MultiLabeledGraph& graph,
+    Uint reservoir_size,
+    Uint ensemble_size
+)
+{
+  const Uint seed = 1;
+
+  Reservoir ensemble;
+  ensemble.setInputSize(input_size);
+  ensemble.setReservoirSize(reservoir_size);
+  ensemble.setEnsembleSize(ensemble_size);
+  ensemble.setMaxDegree(graph.maxDegree());
+  ensemble.setSigma(sigma);
+  ensemble.setEpsilon(epsilon);
+  ensemble.setMaxIterations(10000);
+  ensemble.setRandomSeed(seed);
+  ensemble.init();
+
+  std::cout << name << " (" << graph.getSize() << " vertices, N_r "
+            << reservoir_size << ", " << ensemble_size << " members)"
+            << std::endl;
+
+  const bool converged = ensemble.encoding(graph);
+  const MultiLabeledGraph states = ensemble.getLastStateGraph();
+  const Math::Matrix& W_in = ensemble.getInputMatrix();
+  const Math::Matrix& W_hat = ensemble.getReservoirMatrix();
+
+  Uint failed = 0;
+  for (Uint m = 0; m < ensemble_size; ++m)
+  {
+    Reservoir single;
+    single.setInputSize(input_size);
+    single.setReservoirSize(reservoir_size);
+    single.setMaxDegree(graph.maxDegree());
+    single.setSigma(sigma);
+    single.setEpsilon(epsilon);
+    single.setMaxIterations(10000);
+    single.setRandomSeed(seed + m);
+    single.init();
+
+    // The member blocks of the ensemble matrices (W_hat is block diagonal)
+    const Uint first = m * reservoir_size;
+    Uint different = 0;
+    for (Uint i = 0; i < reservoir_size; ++i)
+    {
+      for (Uint j = 0; j < input_size + 1; ++j)
+        different += W_in(first + i, j) != single.getInputMatrix()(i, j);
+      for (Uint j = 0; j < W_hat.n_cols; ++j)
+      {
+        const bool in_block = j >= first && j < first + reservoir_size;
+        different +=
+            W_hat(first + i, j) !=
+              (in_block ? single.getReservoirMatrix()(i, j - first) : 0);
+      } // for j
+    } // for i
+
+    const bool single_converged = single.encoding(graph);
+    MultiLabeledGraph member;
+    ensemble.splitStateGraph(states, m, member);
+    const Real distance = maxDistance(member, single.getLastStateGraph());
+
+    const bool ok =
+        converged && single_converged && different == 0 &&
+        member.getElementsSize() == reservoir_size &&
+        distance <= tolerance;
+    std::cout << "  member " << m << ": " << different
+              << " different matrix elements, max distance " << distance
+              << " (tolerance " << tolerance << "): "
+              << (ok ? "ok" : "FAILED") << std::endl;
+    failed += !ok;
+  } // for m
+
+  return failed;
+} // function testEnsemble
+
+/**
+ * Function main
+ *
+ * Compares the results of the encoding modes and solvers of GraphReservoir
+ * with the vertex encoding, on long chains and random graphs, and the members
+ * of the reservoir ensembles with single reservoirs. Returns 1 if some result
+ * is not within the tolerance.
+ */
+int main()
+{
+  Global::setRandSeed(1);
+
+  Uint failed = 0;
+  failed += testGraph("chain", chainGraph(400), 30);
+  failed += testGraph("chain", chainGraph(1000), 50);
+  failed += testGraph("random graph", randomGraph(60), 30);
+  failed += testGraph("random graph", randomGraph(200), 64);
+  failed += testGraph("random graph", randomGraph(200), 100, 0.1);
+  failed += testEnsemble("ensemble", randomGraph(60), 20, 3);
+  failed += testEnsemble("ensemble", chainGraph(400), 16, 4);
+
+  std::cout << (failed == 0 ? "All tests passed" : "Some tests FAILED")
+            << std::endl;
+
+  return failed == 0 ? 0 : 1;
+} // function main
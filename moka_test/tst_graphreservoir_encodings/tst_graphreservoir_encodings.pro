@@ -0,0 +1,10 @@
+TARGET = ../../bin/tst_graphreservoir_encodings
+
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt
+
+include(../common_config.pro)
+
+SOURCES += \
+    tst_graphreservoir_encodings.cpp
@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <moka/exception.h>
+#include <moka/global.h>
+#include <moka/structure/labelset.h>
+
+using namespace moka;
+using namespace moka::structure;
+
+typedef Global::Uint Uint;
+typedef LabelSet::Labels Labels;
+
+/**
+ * Function check
+ *
+ * Prints the result of a check and returns 1 if it failed.
+ */
+Uint check(const std::string& name, bool passed)
+{
+  std::cout << name << ": " << (passed ? "ok" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+} // function check
+
+/**
+ * Function makeLabels
+ *
+ * Returns the labels a, b (if not empty) and c (if not empty).
+ */
+Labels makeLabels
+(
+    const std::string& a,
+    const std::string& b = "",
+    const std::string& c = ""
+)
+{
+  Labels labels(1, a);
+  if (!b.empty())
+    labels.push_back(b);
+  if (!c.empty())
+    labels.push_back(c);
+  return labels;
+} // function makeLabels
+
+/**
+ * Function testInterning
+ *
+ * Checks that equal label sets of a pool share the same entry (and id), that
+ * different label sets have different ids, and that the pool grows only
+ * with new label sets and new labels.
+ */
+Uint testInterning()
+{
+  Uint failed = 0;
+
+  const boost::shared_ptr<LabelSet::Pool> pool(new LabelSet::Pool());
+  failed += check("new pool",
+                  pool->getSize() == 1 && pool->getLabelSize() == 0);
+
+  const LabelSet empty;
+  failed += check("empty label set", empty.empty() && empty.size() == 0 &&
+                  empty.getId() == 0 && empty.getPool() == NULL &&
+                  LabelSet(Labels()).getId() == 0 &&
+                  LabelSet(Labels(), pool).getId() == 0 &&
+                  empty == LabelSet(Labels(), pool));
+
+  const LabelSet a(makeLabels("C", "ring", "aromatic"), pool);
+  failed += check("pool of the label set",
+                  a.getPool() == pool.get() && pool->getSize() == 2 &&
+                  pool->getLabelSize() == 3);
+
+  // Equal label sets
+  const LabelSet b(makeLabels("C", "ring", "aromatic"), pool);
+  failed += check("equal labels, same id", a.getId() == b.getId() && a == b);
+  failed += check("equal labels, same entry",
+                  &a.getLabels() == &b.getLabels());
+  failed += check("equal labels, pool unchanged",
+                  pool->getSize() == 2 && pool->getLabelSize() == 3);
+
+  // Different label sets (same labels in a different order, or a subset)
+  const LabelSet c(makeLabels("C", "aromatic", "ring"), pool);
+  const LabelSet d(makeLabels("C", "ring"), pool);
+  failed += check("different labels, different ids",
+                  c.getId() != a.getId() && d.getId() != a.getId() &&
+                  d.getId() != c.getId() && d.getId() != empty.getId() &&
+                  c != a && d != a);
+  failed += check("different labels, labels unchanged",
+                  pool->getSize() == 4 && pool->getLabelSize() == 3);
+
+  // New label
+  const LabelSet e(makeLabels("N", "ring"), pool);
+  failed += check("new label, pool grown",
+                  pool->getSize() == 5 && pool->getLabelSize() == 4);
+
+  // Copies
+  LabelSet f;
+  f = a;
+  const LabelSet g(a);
+  failed += check("copies, same id",
+                  f.getId() == a.getId() && g.getId() == a.getId() &&
+                  &f.getLabels() == &a.getLabels() &&
+                  f.getPool() == pool.get() && pool->getSize() == 5);
+
+  return failed;
+} // function testInterning
+
+/**
+ * Function testPools
+ *
+ * Checks that the pools are independent (the ids of a pool are not affected
+ * by the other pools), that label sets of different pools are compared by
+ * their labels, and that a pool lives as long as its label sets.
+ */
+Uint testPools()
+{
+  Uint failed = 0;
+
+  boost::shared_ptr<LabelSet::Pool> pool(new LabelSet::Pool());
+  boost::shared_ptr<LabelSet::Pool> other(new LabelSet::Pool());
+
+  const LabelSet a(makeLabels("C", "ring"), pool);
+  const LabelSet b(makeLabels("N"), other);
+  const LabelSet c(makeLabels("C", "ring"), other);
+  failed += check("independent pools",
+                  a.getId() == 1 && b.getId() == 1 && c.getId() == 2 &&
+                  pool->getSize() == 2 && other->getSize() == 3);
+  failed += check("different pools, compared by labels",
+                  a == c && !(a != c) && a != b && !(a < c) && !(c < a));
+
+  // Label set without a pool, in a pool of its own
+  const LabelSet d(makeLabels("C", "ring"));
+  failed += check("label set without a pool",
+                  d.getPool() != NULL && d.getPool() != pool.get() &&
+                  d.getPool() != LabelSet(makeLabels("C", "ring")).getPool() &&
+                  d == a && d.getPool()->getSize() == 2);
+
+  // The pool is kept by its label sets, and released with the last of them
+  boost::weak_ptr<LabelSet::Pool> weak_pool;
+  {
+    boost::shared_ptr<LabelSet::Pool> scoped(new LabelSet::Pool());
+    weak_pool = scoped;
+    const LabelSet e(makeLabels("S"), scoped);
+    scoped.reset();
+    failed += check("pool kept by its label sets",
+                    !weak_pool.expired() && e[0] == "S" &&
+                    e.getPool()->getLabel(e.getLabelId(0)) == "S");
+  }
+  failed += check("pool released with its label sets", weak_pool.expired());
+
+  return failed;
+} // function testPools
+
+/**
+ * Function testOrdering
+ *
+ * Checks that operator< orders the label sets lexicographically by their
+ * labels, whatever the order in which they were built and their pools.
+ */
+Uint testOrdering()
+{
+  const boost::shared_ptr<LabelSet::Pool> pool(new LabelSet::Pool());
+
+  std::vector<LabelSet> sets;
+  sets.push_back(LabelSet(makeLabels("O"), pool));
+  sets.push_back(LabelSet(makeLabels("C", "ring"), pool));
+  sets.push_back(LabelSet(makeLabels("C"), pool));
+  sets.push_back(LabelSet(Labels(), pool));
+  sets.push_back(LabelSet(makeLabels("N", "chain")));
+  sets.push_back(LabelSet(makeLabels("C", "chain"), pool));
+  std::sort(sets.begin(), sets.end());
+
+  std::vector<Labels> expected;
+  expected.push_back(Labels());
+  expected.push_back(makeLabels("C"));
+  expected.push_back(makeLabels("C", "chain"));
+  expected.push_back(makeLabels("C", "ring"));
+  expected.push_back(makeLabels("N", "chain"));
+  expected.push_back(makeLabels("O"));
+
+  bool sorted = sets.size() == expected.size();
+  for (Uint i = 0; sorted && i < sets.size(); ++i)
+    sorted = sets[i].getLabels() == expected[i];
+
+  const LabelSet a(makeLabels("C", "ring"), pool);
+  const bool strict = !(a < a) && !(a < sets[3]) && !(sets[3] < a);
+
+  return check("lexicographic order", sorted && strict);
+} // function testOrdering
+
+/**
+ * Function testLabels
+ *
+ * Checks that the labels are returned as passed, and that the label ids are
+ * shared by equal labels of a pool and map back to the labels.
+ */
+Uint testLabels()
+{
+  Uint failed = 0;
+
+  const boost::shared_ptr<LabelSet::Pool> pool(new LabelSet::Pool());
+  const Labels labels = makeLabels("O", "chain", "O");
+  const LabelSet a(labels, pool);
+  const LabelSet b(makeLabels("chain", "S"), pool);
+
+  bool same_labels = (a.size() == labels.size() && a.getLabels() == labels &&
+                      static_cast<const Labels&>(a) == labels);
+  for (Uint i = 0; i < labels.size(); ++i)
+    same_labels = same_labels && a[i] == labels[i] && a.at(i) == labels[i];
+  Uint n = 0;
+  for (LabelSet::const_iterator it = a.begin(); it != a.end(); ++it, ++n)
+    same_labels = same_labels && *it == labels[n];
+  failed += check("labels", same_labels && n == labels.size());
+
+  bool out_of_range = false;
+  try
+  {
+    a.at(labels.size());
+  }
+  catch (std::out_of_range&)
+  {
+    out_of_range = true;
+  }
+  failed += check("label out of range", out_of_range);
+
+  failed += check("equal labels, same label ids",
+                  a.getLabelId(0) == a.getLabelId(2) &&
+                  a.getLabelId(1) == b.getLabelId(0) &&
+                  a.getLabelId(0) != a.getLabelId(1) &&
+                  b.getLabelId(1) != a.getLabelId(0));
+
+  bool same_label = true;
+  for (Uint i = 0; i < a.size(); ++i)
+    same_label = same_label && pool->getLabel(a.getLabelId(i)) == a[i];
+  for (Uint i = 0; i < b.size(); ++i)
+    same_label = same_label && pool->getLabel(b.getLabelId(i)) == b[i];
+  failed += check("labels of the label ids", same_label);
+
+  bool id_out_of_range = false;
+  try
+  {
+    pool->getLabel(pool->getLabelSize());
+  }
+  catch (moka::GenericException&)
+  {
+    id_out_of_range = true;
+  }
+  failed += check("label id out of range", id_out_of_range);
+
+  return failed;
+} // function testLabels
+
+/**
+ * Function main
+ *
+ * Checks the interning of the label sets of structure::LabelSet in their
+ * pools. Returns 1 if some check fails.
+ */
+int main()
+{
+  Uint failed = 0;
+  failed += testInterning();
+  failed += testPools();
+  failed += testOrdering();
+  failed += testLabels();
+
+  std::cout << (failed == 0 ? "All tests passed" : "Some tests FAILED")
+            << std::endl;
+
+  return failed == 0 ? 0 : 1;
+} // function main
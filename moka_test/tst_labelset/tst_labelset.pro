@@ -0,0 +1,10 @@
+TARGET = ../../bin/tst_labelset
+
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt
+
+include(../common_config.pro)
+
+SOURCES += \
+    tst_labelset.cpp
@@ -0,0 +1,151 @@
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include <moka/global.h>
+#include <moka/util/math.h>
+#include <moka/util/squareddistance.h>
+
+using namespace moka;
+using namespace moka::util;
+
+typedef Global::Uint Uint;
+typedef Global::Real Real;
+typedef SquaredDistance::SingleReal SingleReal;
+
+namespace {
+
+// Largest array size tested (all the sizes up to it are tested, so all the
+// remainders of the vector loops are covered)
+const Uint max_size = 70;
+
+// Relative tolerances (the partial sums are added in a different order)
+const Real double_tolerance = 1e-13;
+const Real single_tolerance = 1e-5;
+
+} // namespace
+
+/**
+ * Function randomVector
+ *
+ * Returns a random vector of the passed size.
+ */
+Math::Vector randomVector(Uint size)
+{
+  Math::Vector v(size);
+  for (Uint i = 0; i < size; ++i)
+    v[i] = Global::getRandReal(-1.0, 1.0);
+  return v;
+} // function randomVector
+
+/**
+ * Function isClose
+ *
+ * True if the value is within the relative tolerance from the expected one.
+ */
+bool isClose(Real value, Real expected, Real tolerance)
+{
+  return std::abs(value - expected) <= tolerance * expected + 1e-300;
+} // function isClose
+
+/**
+ * Function testSize
+ *
+ * Compares the double, single and mixed precision versions of
+ * SquaredDistance::compute with the squared arma::norm on random arrays of
+ * the passed size, without bound, with a bound above the distance (the
+ * distance must be returned) and with a bound below it (a value greater than
+ * the bound must be returned). Returns the number of failed checks.
+ */
+Uint testSize(Uint size)
+{
+  const Math::Vector a = randomVector(size);
+  const Math::Vector b = randomVector(size);
+  const Real expected = std::pow(arma::norm(a - b, 2), 2);
+
+  // Single precision copies
+  std::vector<SingleReal> a_single(a.begin(), a.end());
+  std::vector<SingleReal> b_single(b.begin(), b.end());
+  Real expected_single = 0;
+  for (Uint i = 0; i < size; ++i)
+    expected_single +=
+        (Real(a_single[i]) - b_single[i]) * (Real(a_single[i]) - b_single[i]);
+
+  const SingleReal *a_s = a_single.empty() ? 0 : &a_single[0];
+  const SingleReal *b_s = b_single.empty() ? 0 : &b_single[0];
+  const Real above = 2 * expected + 1;
+  const Real below = expected / 2;
+
+  Uint failed = 0;
+
+  // Double precision
+  const Real d = SquaredDistance::compute(a.memptr(), b.memptr(), size);
+  const Real d_above =
+      SquaredDistance::compute(a.memptr(), b.memptr(), size, above);
+  const Real d_below =
+      SquaredDistance::compute(a.memptr(), b.memptr(), size, below);
+  const bool d_abandoned =
+      size == 0 || (d_below > below && d_below <= d * (1 + double_tolerance));
+  if (!isClose(d, expected, double_tolerance) || d_above != d || !d_abandoned)
+  {
+    std::cout << "size " << size << ", double precision: " << d << " ("
+              << d_above << ", " << d_below << " with bounds " << above
+              << ", " << below << "), expected " << expected << ": FAILED"
+              << std::endl;
+    failed++;
+  }
+
+  // Single precision
+  const SingleReal s = SquaredDistance::compute(a_s, b_s, size);
+  const SingleReal s_above =
+      SquaredDistance::compute(a_s, b_s, size, SingleReal(above));
+  const SingleReal s_below =
+      SquaredDistance::compute(a_s, b_s, size, SingleReal(below));
+  const bool s_abandoned = size == 0 ||
+      (s_below > SingleReal(below) && s_below <= s * (1 + single_tolerance));
+  if (!isClose(s, expected_single, single_tolerance) || s_above != s ||
+      !s_abandoned)
+  {
+    std::cout << "size " << size << ", single precision: " << s << " ("
+              << s_above << ", " << s_below << " with bounds " << above
+              << ", " << below << "), expected " << expected_single
+              << ": FAILED" << std::endl;
+    failed++;
+  }
+
+  // Mixed precision (the same result of the single precision on a copy)
+  const SingleReal m = SquaredDistance::compute(a.memptr(), b_s, size);
+  const SingleReal m_below =
+      SquaredDistance::compute(a.memptr(), b_s, size, SingleReal(below));
+  if (m != s || m_below != s_below)
+  {
+    std::cout << "size " << size << ", mixed precision: " << m << " ("
+              << m_below << " with bound " << below << "), expected " << s
+              << " (" << s_below << "): FAILED" << std::endl;
+    failed++;
+  }
+
+  return failed;
+} // function testSize
+
+/**
+ * Function main
+ *
+ * Compares the versions of util::SquaredDistance with the squared norm of
+ * the difference computed by arma::norm, on random arrays of all the sizes
+ * up to max_size. Returns 1 if some result differs.
+ */
+int main()
+{
+  Global::setRandSeed(1);
+
+  Uint failed = 0;
+  for (Uint t = 0; t < 20; ++t)
+    for (Uint size = 0; size <= max_size; ++size)
+      failed += testSize(size);
+
+  std::cout << failed << " failed checks" << std::endl;
+  std::cout << (failed == 0 ? "All tests passed" : "Some tests FAILED")
+            << std::endl;
+
+  return failed == 0 ? 0 : 1;
+} // function main
@@ -0,0 +1,10 @@
+TARGET = ../../bin/tst_squared_distance
+
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt
+
+include(../common_config.pro)
+
+SOURCES += \
+    tst_squared_distance.cpp
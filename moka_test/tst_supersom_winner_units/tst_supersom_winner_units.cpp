@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <moka/global.h>
+#include <moka/ml/supersom.h>
+#include <moka/util/math.h>
+
+using namespace moka;
+using namespace moka::ml;
+using namespace moka::util;
+
+typedef Global::Uint Uint;
+typedef Global::Real Real;
+
+namespace {
+
+const Uint data_size = 2000;
+const Uint dim = 20;
+
+// Relative tolerance on the distances of the winner units (the batch search
+// computes them in a different way, so it can take the other unit of a
+// near tie)
+const Real double_tolerance = 1e-10;
+const Real single_tolerance = 1e-4;
+
+} // namespace
+
+/**
+ * Function clusteredData
+ *
+ * Returns random data clustered around 20 centers (as the states of a
+ * reservoir).
+ */
+SuperSOM::DataContainer clusteredData()
+{
+  const Uint n_clusters = 20;
+
+  Math::Matrix centers(dim, n_clusters);
+  for (Uint i = 0; i < centers.n_elem; ++i)
+    centers[i] = Global::getRandReal(-1.0, 1.0);
+
+  SuperSOM::DataContainer data(data_size);
+  for (Uint i = 0; i < data_size; ++i)
+  {
+    data[i].set_size(dim);
+    for (Uint j = 0; j < dim; ++j)
+      data[i][j] =
+          std::tanh(
+            centers(j, i % n_clusters) + Global::getRandReal(-0.2, 0.2));
+  } // for i
+
+  return data;
+} // function clusteredData
+
+/**
+ * Function trainedMap
+ *
+ * Returns a SOM of rows x cols units trained on the data, with the passed
+ * local search radius.
+ */
+SuperSOM trainedMap
+(
+    const SuperSOM::DataContainer& data,
+    Uint rows,
+    Uint cols,
+    Uint local_search_radius
+)
+{
+  SuperSOM som;
+  som.setNoRows(rows);
+  som.setNoColumns(cols);
+  som.setRandomSeed(1);
+  som.setDefaultParameters(data.size());
+  som.setLocalSearchRadius(local_search_radius);
+  som.init(data);
+  som.unsupervisedTraining(data);
+  return som;
+} // function trainedMap
+
+/**
+ * Function squaredDistance
+ *
+ * Squared distance between the data and the codebook of the unit.
+ */
+Real squaredDistance
+(
+    const SuperSOM& som,
+    const SuperSOM::Data& data,
+    const SuperSOM::UnitIndex& unit
+)
+{
+  return std::pow(arma::norm(data - som.getCodebook(unit), 2), 2);
+} // function squaredDistance
+
+/**
+ * Function quantizationError
+ *
+ * Mean distance of the data from the codebooks of their winner units.
+ */
+Real quantizationError
+(
+    const SuperSOM& som,
+    const SuperSOM::DataContainer& data
+)
+{
+  Real error = 0;
+  for (Uint i = 0; i < data.size(); ++i)
+    error += std::sqrt(squaredDistance(som, data[i], som.winnerUnit(data[i])));
+  return error / data.size();
+} // function quantizationError
+
+/**
+ * Function compareWinnerUnits
+ *
+ * Compares the winner units found by a search with the ones of the exact
+ * search: a different unit is accepted only if its distance from the data is
+ * within the relative tolerance from the exact one. Returns the number of
+ * wrong winner units.
+ */
+Uint compareWinnerUnits
+(
+    const std::string& name,
+    const SuperSOM& som,
+    const SuperSOM::DataContainer& data,
+    const std::vector<SuperSOM::UnitIndex>& expected,
+    const std::vector<SuperSOM::UnitIndex>& winners,
+    Real tolerance
+)
+{
+  Uint failed = 0, ties = 0;
+  if (winners.size() != expected.size())
+    failed = data.size();
+  else
+    for (Uint i = 0; i < data.size(); ++i)
+    {
+      if (winners[i] == expected[i])
+        continue;
+      const Real expected_distance =
+          squaredDistance(som, data[i], expected[i]);
+      if (squaredDistance(som, data[i], winners[i]) <=
+          expected_distance * (1 + tolerance))
+        ties++;
+      else
+        failed++;
+    } // for i
+
+  std::cout << "  " << name << ": " << failed << " wrong winner units ("
+            << ties << " near ties)" << std::endl;
+
+  return failed;
+} // function compareWinnerUnits
+
+/**
+ * Function testBatchSearch
+ *
+ * Compares the batch winner unit searches (on double and single precision
+ * data, with the double and single precision SOM) with the exact search of
+ * winnerUnit on each data. Returns the number of wrong winner units.
+ */
+Uint testBatchSearch
+(
+    SuperSOM& som,
+    const SuperSOM::DataContainer& data
+)
+{
+  std::cout << "batch search (" << som.getNoRows() << "x"
+            << som.getNoColumns() << " map)" << std::endl;
+
+  std::vector<SuperSOM::UnitIndex> expected(data.size()), winners;
+  for (Uint i = 0; i < data.size(); ++i)
+    expected[i] = som.winnerUnit(data[i]);
+
+  Math::Matrix matrix(dim, data.size());
+  Math::SingleMatrix single_matrix(dim, data.size());
+  for (Uint i = 0; i < data.size(); ++i)
+    for (Uint j = 0; j < dim; ++j)
+    {
+      matrix(j, i) = data[i][j];
+      single_matrix(j, i) = data[i][j];
+    }
+
+  Uint failed = 0;
+
+  som.winnerUnits(matrix, winners);
+  failed += compareWinnerUnits(
+      "double precision", som, data, expected, winners, double_tolerance);
+  som.winnerUnits(single_matrix, winners);
+  failed += compareWinnerUnits(
+      "double precision (single data)", som, data, expected, winners,
+      single_tolerance);
+
+  som.setPrecision(Math::single_precision);
+  som.winnerUnits(matrix, winners);
+  failed += compareWinnerUnits(
+      "single precision", som, data, expected, winners, single_tolerance);
+  som.winnerUnits(single_matrix, winners);
+  failed += compareWinnerUnits(
+      "single precision (single data)", som, data, expected, winners,
+      single_tolerance);
+  for (Uint i = 0; i < data.size(); ++i)
+    winners[i] = som.winnerUnit(data[i]);
+  failed += compareWinnerUnits(
+      "single precision (winnerUnit)", som, data, expected, winners,
+      single_tolerance);
+  som.setPrecision(Math::double_precision);
+
+  som.setIndexedSearch(true);
+  som.winnerUnits(matrix, winners);
+  failed += compareWinnerUnits(
+      "indexed", som, data, expected, winners, 0);
+  som.setIndexedSearch(false);
+
+  return failed;
+} // function testBatchSearch
+
+/**
+ * Function testLocalSearch
+ *
+ * Compares the training with the local winner unit search with the one with
+ * the exact search: with a radius covering the whole map the local search
+ * must find the exact winner units (and so the same codebooks), with a small
+ * radius the quantization error must be close to the exact one. Returns the
+ * number of failed checks.
+ */
+Uint testLocalSearch
+(
+    const SuperSOM& som,
+    const SuperSOM::DataContainer& data
+)
+{
+  const Uint rows = som.getNoRows(), cols = som.getNoColumns();
+  std::cout << "local search (" << rows << "x" << cols << " map)"
+            << std::endl;
+
+  Uint failed = 0;
+
+  const SuperSOM whole = trainedMap(data, rows, cols, rows + cols);
+  Real distance = 0;
+  for (Uint r = 0; r < rows; ++r)
+    for (Uint c = 0; c < cols; ++c)
+      distance = std::max<Real>(
+          distance,
+          arma::norm(whole.getCodebook(r, c) - som.getCodebook(r, c), 2));
+  std::cout << "  radius " << rows + cols << ": max codebook distance "
+            << distance << ": " << (distance == 0 ? "ok" : "FAILED")
+            << std::endl;
+  failed += (distance != 0);
+
+  const Real error = quantizationError(som, data);
+  for (Uint radius = 1; radius <= 3; ++radius)
+  {
+    const SuperSOM local = trainedMap(data, rows, cols, radius);
+    const Real local_error = quantizationError(local, data);
+    const bool ok = local_error <= error * 1.05;
+    std::cout << "  radius " << radius << ": quantization error "
+              << local_error << " (exact search " << error << "): "
+              << (ok ? "ok" : "FAILED") << std::endl;
+    failed += !ok;
+  } // for radius
+
+  return failed;
+} // function testLocalSearch
+
+/**
+ * Function main
+ *
+ * Compares the batch and the local winner unit searches of SuperSOM with
+ * the exact search on trained maps. Returns 1 if some result differs.
+ */
+int main()
+{
+  Global::setRandSeed(1);
+
+  const SuperSOM::DataContainer data = clusteredData();
+
+  Uint failed = 0;
+  for (Uint size = 5; size <= 20; size *= 2)
+  {
+    SuperSOM som = trainedMap(data, size, size, 0);
+    failed += testBatchSearch(som, data);
+    failed += testLocalSearch(som, data);
+  } // for size
+
+  std::cout << (failed == 0 ? "All tests passed" : "Some tests FAILED")
+            << std::endl;
+
+  return failed == 0 ? 0 : 1;
+} // function main
@@ -0,0 +1,10 @@
+TARGET = ../../bin/tst_supersom_winner_units
+
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt
+
+include(../common_config.pro)
+
+SOURCES += \
+    tst_supersom_winner_units.cpp
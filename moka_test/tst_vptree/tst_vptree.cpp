@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include <moka/global.h>
+#include <moka/ml/supersom.h>
+#include <moka/util/math.h>
+#include <moka/util/timer.h>
+#include <moka/util/vptree.h>
+
+using namespace moka;
+using namespace moka::ml;
+using namespace moka::util;
+
+typedef Global::Uint Uint;
+typedef Global::Real Real;
+
+/**
+ * Function squaredDistance
+ *
+ * Plain squared euclidean distance between the column of the points and x.
+ */
+Real squaredDistance(const Math::Matrix& points, Uint point, const Real *x)
+{
+  Real distance = 0;
+  for (Uint i = 0; i < points.n_rows; ++i)
+    distance += (points(i, point) - x[i]) * (points(i, point) - x[i]);
+  return distance;
+} // function squaredDistance
+
+/**
+ * Function linearScan
+ *
+ * Fills the vector "nearest" with the indexes of all the points sorted by
+ * their distance from x (and by index on ties), as expected from the tree.
+ */
+void linearScan
+(
+    const Math::Matrix& points,
+    const Real *x,
+    std::vector<Uint>& nearest
+)
+{
+  std::vector< std::pair<Real, Uint> > distances(points.n_cols);
+  for (Uint p = 0; p < points.n_cols; ++p)
+    distances[p] = std::make_pair(squaredDistance(points, p, x), p);
+  std::sort(distances.begin(), distances.end());
+
+  nearest.resize(points.n_cols);
+  for (Uint p = 0; p < points.n_cols; ++p)
+    nearest[p] = distances[p].second;
+
+  return;
+} // function linearScan
+
+/**
+ * Function testRandomPoints
+ *
+ * Compares the nearest points found by the tree with the linear scan, on
+ * random points of several dimensions and sizes (with many ties when the
+ * coordinates take few values). Returns the number of wrong results.
+ */
+Uint testRandomPoints()
+{
+  Uint failed = 0, queries = 0;
+
+  for (Uint t = 0; t < 40; ++t)
+  {
+    const Uint dim = 1 + t % 12;
+    const Uint size = Global::getRandInt(1, 400);
+    const Uint values = (t % 3 == 0) ? 4 : 1000;
+
+    Math::Matrix points(dim, size);
+    for (Uint i = 0; i < points.n_elem; ++i)
+      points[i] = Global::getRandInt(0, values - 1) / 100.0;
+
+    VpTree tree;
+    tree.build(points);
+
+    std::vector<Uint> expected, nearest;
+    for (Uint q = 0; q < 100; ++q, ++queries)
+    {
+      Math::Vector x(dim);
+      for (Uint j = 0; j < dim; ++j)
+        x[j] = Global::getRandInt(0, 999) / 100.0;
+      linearScan(points, x.memptr(), expected);
+
+      // Nearest point
+      if (tree.nearest(x.memptr()) != expected[0])
+        failed++;
+
+      // k nearest points
+      const Uint k = Global::getRandInt(1, 6);
+      tree.nearest(x.memptr(), k, nearest);
+      if (nearest.size() != std::min(k, size) ||
+          !std::equal(nearest.begin(), nearest.end(), expected.begin()))
+        failed++;
+    } // for q
+  } // for t
+
+  std::cout << "random points: " << queries << " queries, " << failed
+            << " wrong results" << std::endl;
+
+  return failed;
+} // function testRandomPoints
+
+/**
+ * Function testTrainedMap
+ *
+ * Trains a SOM of rows x cols units on clustered data of size dim (as the
+ * states of a reservoir), then compares the winner units found through the
+ * nearest neighbor index with the ones of the linear scan of the map, and
+ * prints the time of both searches. Returns the number of different winner
+ * units.
+ */
+Uint testTrainedMap(Uint rows, Uint cols, Uint dim)
+{
+  const Uint n_clusters = 20;
+  const Uint size = 4000;
+
+  Math::Matrix centers(dim, n_clusters);
+  for (Uint i = 0; i < centers.n_elem; ++i)
+    centers[i] = Global::getRandReal(-1.0, 1.0);
+
+  SuperSOM::DataContainer data(size);
+  for (Uint i = 0; i < size; ++i)
+  {
+    data[i].set_size(dim);
+    for (Uint j = 0; j < dim; ++j)
+      data[i][j] =
+          std::tanh(
+            centers(j, i % n_clusters) + Global::getRandReal(-0.2, 0.2));
+  } // for i
+
+  SuperSOM som;
+  som.setNoRows(rows);
+  som.setNoColumns(cols);
+  som.setRandomSeed(1);
+  som.setDefaultParameters(size);
+  som.init(data);
+  som.unsupervisedTraining(data);
+
+  Timer timer;
+  std::vector<SuperSOM::UnitIndex> scan(size), indexed(size);
+
+  som.setIndexedSearch(false);
+  timer.start();
+  for (Uint r = 0; r < 10; ++r)
+    for (Uint i = 0; i < size; ++i)
+      scan[i] = som.winnerUnit(data[i]);
+  timer.stop();
+  const Real scan_time = timer.getWallTime();
+
+  som.setIndexedSearch(true);
+  timer.start();
+  for (Uint r = 0; r < 10; ++r)
+    for (Uint i = 0; i < size; ++i)
+      indexed[i] = som.winnerUnit(data[i]);
+  timer.stop();
+  const Real indexed_time = timer.getWallTime();
+
+  Uint failed = 0;
+  for (Uint i = 0; i < size; ++i)
+    if (indexed[i] != scan[i])
+      failed++;
+
+  std::cout << "trained map " << rows << "x" << cols << ", dim " << dim
+            << ": " << failed << " wrong winner units, linear scan "
+            << scan_time << "s, index " << indexed_time << "s (speedup "
+            << scan_time / indexed_time << ")" << std::endl;
+
+  return failed;
+} // function testTrainedMap
+
+/**
+ * Function main
+ *
+ * Compares the searches of util::VpTree with the linear scan of the points,
+ * and the winner units of a trained SOM with and without the index (printing
+ * the search times). Returns 1 if some result differs.
+ */
+int main()
+{
+  Global::setRandSeed(1);
+
+  Uint failed = 0;
+  failed += testRandomPoints();
+  failed += testTrainedMap(10, 10, 30);
+  failed += testTrainedMap(20, 20, 30);
+  failed += testTrainedMap(40, 40, 30);
+
+  std::cout << (failed == 0 ? "All tests passed" : "Some tests FAILED")
+            << std::endl;
+
+  return failed == 0 ? 0 : 1;
+} // function main
@@ -0,0 +1,10 @@
+TARGET = ../../bin/tst_vptree
+
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt
+
+include(../common_config.pro)
+
+SOURCES += \
+    tst_vptree.cpp